@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "atom.h"
+
+#include "tv_grab_dvb.h"
+
+/* A per-service feed */
+struct atom_feed_struct
+{
+	char *name;
+	int fd;
+	sink_t out;
+	atom_feed_t *next;
+};
+
+static void
+atom_write_header(atom_options_t *options, sink_t *out, const char *id, service_t *service)
+{
+	const char *s;
+
+	sink_puts(out,
+			  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			  "<feed xmlns=\"http://www.w3.org/2005/Atom\" xmlns:ev=\"http://purl.org/rss/1.0/modules/event/\">\n");
+	if(service && (s = service_name(service)))
+	{
+		sink_puts(out, "\t<title>");
+		sink_xmlify(out, s, strlen(s));
+		sink_puts(out, "</title>\n");
+	}
+	else
+	{
+		sink_puts(out, "\t<title>Event Information Table</title>\n");
+	}
+	if(id)
+	{
+		sink_printf(out, "\t<id>%s</id>\n", id);
+	}
+	sink_printf(out, "\t<updated>%s</updated>\n", options->updated);
+}
+
+/* Write the start of the feed (if there's a single one) */
+void
+atom_preamble(atom_options_t *options)
+{
+	time_t now;
+
+	time(&now);
+	strftime(options->updated, sizeof(options->updated), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+	if(options->out)
+	{
+		atom_write_header(options, options->out, NULL, NULL);
+	}
+}
+
+/* Finish the feed, or every per-service feed; returns -1 if any of them
+ * couldn't be written
+ */
+int
+atom_postamble(atom_options_t *options)
+{
+	atom_feed_t *feed;
+	int r;
+
+	r = 0;
+	if(options->out)
+	{
+		sink_puts(options->out, "</feed>\n");
+	}
+	while((feed = options->feeds))
+	{
+		options->feeds = feed->next;
+		sink_puts(&(feed->out), "</feed>\n");
+		if(sink_close(&(feed->out)))
+		{
+			perror(feed->name);
+			r = -1;
+		}
+		close(feed->fd);
+		free(feed->name);
+		free(feed);
+	}
+	options->last = NULL;
+	return r;
+}
+
+/* Locate the feed for an event's service (or, if it has none, for the
+ * channel named by the first part of its identifier), creating it if needed.
+ * Events tend to arrive a service at a time, so the last feed used is tried
+ * first.
+ */
+static atom_feed_t *
+atom_feed(atom_options_t *options, event_t *event)
+{
+	atom_feed_t *feed;
+	service_t *service;
+	char name[128], path[512], *p;
+	const char *s;
+	size_t len;
+	int fd;
+
+	service = event_service(event);
+	if(service)
+	{
+		s = service_uri(service);
+		if((p = strstr(s, "://")))
+		{
+			s = p + 3;
+		}
+		len = strlen(s);
+	}
+	else
+	{
+		s = event_identifier(event);
+		len = ((p = strchr(s, '/')) ? (size_t) (p - s) : strlen(s));
+	}
+	if(len >= sizeof(name))
+	{
+		len = sizeof(name) - 1;
+	}
+	memcpy(name, s, len);
+	name[len] = 0;
+	for(p = name; *p; p++)
+	{
+		if(!isalnum((unsigned char) *p) && *p != '.' && *p != '-')
+		{
+			*p = '_';
+		}
+	}
+	if(options->last && !strcmp(options->last->name, name))
+	{
+		return options->last;
+	}
+	for(feed = options->feeds; feed; feed = feed->next)
+	{
+		if(!strcmp(feed->name, name))
+		{
+			options->last = feed;
+			return feed;
+		}
+	}
+	snprintf(path, sizeof(path), "%s/%s.atom", (options->dir ? options->dir : "."), name);
+	if(-1 == (fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0666)))
+	{
+		perror(path);
+		return NULL;
+	}
+	if(NULL == (feed = calloc(1, sizeof(atom_feed_t))) ||
+	   NULL == (feed->name = strdup(name)) ||
+	   sink_init(&(feed->out), fd, 64 * 1024))
+	{
+		if(feed)
+		{
+			free(feed->name);
+		}
+		free(feed);
+		close(fd);
+		return NULL;
+	}
+	feed->fd = fd;
+	feed->next = options->feeds;
+	options->feeds = feed;
+	options->last = feed;
+	atom_write_header(options, &(feed->out), (service ? service_uri(service) : NULL), service);
+	return feed;
+}
+
+static void
+atom_write_langstr(sink_t *out, const char *element, const char *attrs, const event_langstr_t *ls)
+{
+	sink_printf(out, "\t\t<%s%s xml:lang=\"%s\">", element, attrs, ls->lang);
+	sink_xmlify(out, ls->str, strlen(ls->str));
+	sink_printf(out, "</%s>\n", element);
+}
+
+/* Write an event as an entry: its programme CRID (or, failing that, its
+ * transport URI) is the entry's id, and its schedule is given using the RSS
+ * event module.
+ */
+int
+atom_write_event(event_t *event, void *data)
+{
+	atom_options_t *options = data;
+	atom_feed_t *feed;
+	sink_t *out;
+	const event_langstr_t **ll;
+	char crid[256], startbuf[32], endbuf[32];
+	const char *uri;
+	size_t count, i;
+	time_t t;
+
+	if(options->out)
+	{
+		out = options->out;
+	}
+	else if((feed = atom_feed(options, event)))
+	{
+		out = &(feed->out);
+	}
+	else
+	{
+		return -1;
+	}
+	t = event_start(event);
+	strftime(startbuf, sizeof(startbuf), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+	t += event_duration(event);
+	strftime(endbuf, sizeof(endbuf), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+	uri = event_transport_uri(event);
+	sink_puts(out, "\t<entry>\n");
+	if(event_pcrid(event) && event_qual_pcrid(event, crid, sizeof(crid)))
+	{
+		sink_puts(out, "\t\t<id>");
+		sink_xmlify(out, crid, strlen(crid));
+		sink_puts(out, "</id>\n");
+	}
+	else
+	{
+		sink_printf(out, "\t\t<id>%s</id>\n", (uri ? uri : event_identifier(event)));
+	}
+	if((ll = event_titles(event, &count)))
+	{
+		for(i = 0; i < count; i++)
+		{
+			atom_write_langstr(out, "title", "", ll[i]);
+		}
+	}
+	else
+	{
+		sink_puts(out, "\t\t<title/>\n");
+	}
+	sink_printf(out, "\t\t<updated>%s</updated>\n", options->updated);
+	if(uri)
+	{
+		sink_printf(out, "\t\t<link rel=\"alternate\" href=\"%s\"/>\n", uri);
+	}
+	if((ll = event_subtitles(event, &count)))
+	{
+		for(i = 0; i < count; i++)
+		{
+			atom_write_langstr(out, "summary", "", ll[i]);
+		}
+	}
+	if((ll = event_descriptions(event, &count)))
+	{
+		for(i = 0; i < count; i++)
+		{
+			if(ll[i])
+			{
+				atom_write_langstr(out, "content", " type=\"text\"", ll[i]);
+			}
+		}
+	}
+	sink_printf(out, "\t\t<ev:startdate>%s</ev:startdate>\n"
+				"\t\t<ev:enddate>%s</ev:enddate>\n"
+				"\t</entry>\n",
+				startbuf, endbuf);
+	return 0;
+}
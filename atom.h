@@ -0,0 +1,27 @@
+#ifndef ATOM_H_
+# define ATOM_H_                        1
+
+# include "dvb/dvb.h"
+# include "sink.h"
+
+typedef struct atom_options_struct atom_options_t;
+typedef struct atom_feed_struct atom_feed_t;
+
+struct atom_options_struct
+{
+	/* The feed to write to; if NULL, a feed is written for each service
+	 * into dir instead
+	 */
+	sink_t *out;
+	const char *dir;
+	/* The time of generation, as an RFC 3339 date-time */
+	char updated[32];
+	atom_feed_t *feeds;
+	atom_feed_t *last;
+};
+
+void atom_preamble(atom_options_t *options);
+int atom_postamble(atom_options_t *options);
+int atom_write_event(event_t *event, void *data);
+
+#endif /*!ATOM_H_ */
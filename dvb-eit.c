@@ -25,6 +25,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <sys/types.h>
 #include <sys/time.h>
@@ -33,24 +34,58 @@
 #include <unistd.h>
 #include <assert.h>
 
-#include "si_tables.h"
 #include "tv_grab_dvb.h"
-#include "events.h"
-#include "xmltv.h"
-#include "callbacks.h"
-
-enum ER { TITLE, SUB_TITLE };
-enum CR { LANGUAGE, VIDEO, AUDIO, SUBTITLES };
 
+enum SEEN { SEEN_NEW, SEEN_BEFORE, SEEN_UPDATED };
+
+#define MAX_LANGS 4
+
+/* An extended event description in one language, as up to 16 parts */
+struct longdesc {
+	u_char *lang;
+	int last;
+	struct descr_extended_event *parts[16];
+	/* The reassembled text (DVB text, in UTF-8), once the descriptor loop has
+	 * been walked */
+	char *text;
+	size_t len, size;
+};
+
+/* The extended event descriptions of a programme, one per language, which
+ * are collected from a single pass over its descriptor loop and reassembled
+ * once it has been walked. */
+struct description {
+	struct longdesc descs[MAX_LANGS];
+	int ndescs;
+};
+
+/* The version of each event output so far, hashed by
+ * (service_id << 16 | event_id). The entries are carved from blocks of
+ * SEEN_BLOCK, as they're never freed. */
+#define SEEN_BLOCK 4096
+
+typedef struct eventver {
+	uint32_t key;
+	uint8_t version;
+} eventver_t;
+
+static dvb_hash_t seen;
+static eventver_t *seenblock;
+static size_t seenleft;
+
+static enum SEEN seenEvent(int sid, int eid, int version);
 static inline void set_bit(int *bf, int b);
 static inline bool get_bit(int *bf, int b);
 static char *xmllang(u_char *l);
 static void parseMJD(long int mjd, struct tm *t);
 static void parseDescription(event_t *ev, void *data, size_t len);
 static bool validateDescription(void *data, size_t len);
-static void parseEventDescription(event_t *ev, void *data, enum ER round);
-static void parseLongEventDescription(event_t *ev, void *data);
-static void parseComponentDescription(event_t *ev, void *data, enum CR round, int *seen);
+static const char *decodeText(const u_char *s, int len, char *out, size_t size);
+static void parseEventDescription(event_t *ev, void *data);
+static void parseLongEventDescription(event_t *ev, void *data, struct description *d);
+static void appendText(struct longdesc *l, const u_char *s, int len);
+static char *assembleLongEventDescription(struct longdesc *l);
+static void parseComponentDescription(event_t *ev, void *data);
 static void parseContentDescription(event_t *ev, void *data);
 static void parseRatingDescription(event_t *ev, void *data);
 static int parsePrivateDataSpecifier(event_t *ev, void *data);
@@ -71,21 +106,16 @@ int parseEIT(void *data, size_t len, dvb_callbacks_t *callbacks) {
 	// For each event listing
 	for (p = &e->data; p < data + len; p += EIT_EVENT_LEN + GetEITDescriptorsLoopLength(p)) {
 		struct eit_event *evt = p;
-		struct chninfo *c;
-		// find existing information?
-		for (c = channels; c != NULL; c = c->next) {
-			// found it
-			if (c->sid == HILO(e->service_id) && (c->eid == HILO(evt->event_id))) {
-				if (c->ver <= e->version_number) // seen it before or its older FIXME: wrap-around to 0
-					return 0;
-				else {
-					c->ver = e->version_number; // update outputted version
-					update_count++;
-					if (ignore_updates)
-						return 0;
-					break;
-				}
-			}
+		switch (seenEvent(HILO(e->service_id), HILO(evt->event_id), e->version_number)) {
+		case SEEN_BEFORE: // this version or a later one has been output already
+			continue;
+		case SEEN_UPDATED:
+			update_count++;
+			if (ignore_updates)
+				continue;
+			break;
+		case SEEN_NEW:
+			break;
 		}
 
 		// its a new program
@@ -97,22 +127,13 @@ int parseEIT(void *data, size_t len, dvb_callbacks_t *callbacks) {
 			return -1;
 		}
 		event_set_service(ev, service);
-
-		if (c == NULL) {
-			chninfo_t *nc = malloc(sizeof(struct chninfo));
-			nc->sid = HILO(e->service_id);
-			nc->eid = HILO(evt->event_id);
-			nc->ver = e->version_number;
-			nc->next = channels;
-			channels = nc;
-		}
-
-		/* we have more data, refresh alarm */
-		if (timeout) alarm(timeout);
+		event_set_channel(ev, get_channelident(HILO(e->service_id)));
 
 		// No program info at end! Just skip it
-		if (GetEITDescriptorsLoopLength(evt) == 0)
-			return 0;
+		if (GetEITDescriptorsLoopLength(evt) == 0) {
+			event_free(ev);
+			continue;
+		}
 
 		parseMJD(HILO(evt->mjd), &dvb_time);
 
@@ -135,14 +156,14 @@ int parseEIT(void *data, size_t len, dvb_callbacks_t *callbacks) {
 			if (ignore_bad_dates)
 			{
 				event_free(ev);
-				return 0;
+				continue;
 			}
 		}
 
 		// a program must have a title that isn't empty
 		if (!validateDescription(&evt->data, GetEITDescriptorsLoopLength(evt))) {
 			event_free(ev);
-			return 0;
+			continue;
 		}
 
 		programme_count++;
@@ -160,32 +181,63 @@ int parseEIT(void *data, size_t len, dvb_callbacks_t *callbacks) {
 				BcdCharToInt(evt->duration_s));
 		event_set_transport_uri(ev, idbuf);
 
-		printf("<programme channel=\"%s\" ", get_channelident(HILO(e->service_id)));
-		strftime(date_strbuf, sizeof(date_strbuf), "start=\"%Y%m%d%H%M%S %z\"", localtime(&start_time) );
-		printf("%s ", date_strbuf);
-		strftime(date_strbuf, sizeof(date_strbuf), "stop=\"%Y%m%d%H%M%S %z\"", localtime(&stop_time));
-		printf("%s>\n ", date_strbuf);
-
 		//printf("\t<EventID>%i</EventID>\n", HILO(evt->event_id));
 		//printf("\t<RunningStatus>%i</RunningStatus>\n", evt->running_status);
 		//1 Airing, 2 Starts in a few seconds, 3 Pausing, 4 About to air
 
 		parseDescription(ev, &evt->data, GetEITDescriptorsLoopLength(evt));
-		printf("</programme>\n");
 		event_debug(ev);		
 		if(!event_pcrid(ev))
 		{
 			fprintf(stderr, "Event with no crid\n");
 		}
-		if(callbacks->event)
-		{
-			callbacks->event(ev, callbacks->event_data);
-		}
+		dvb_callbacks_event(callbacks, ev);
 		event_free(ev);
 	}
 	return 0;
 } /*}}}*/
 
+static size_t eventverHash(const void *entry) {
+	return dvb_hash_mix(((const eventver_t *)entry)->key);
+}
+
+static int eventverMatch(const void *entry, const void *key) {
+	return ((const eventver_t *)entry)->key == *(const uint32_t *)key;
+}
+
+/* Record that a version of an event has been seen. {{{
+ * version_number is only five bits wide, so a version is taken to be newer
+ * than the one recorded if it is up to 15 steps ahead of it (modulo 32). */
+static enum SEEN seenEvent(int sid, int eid, int version) {
+	uint32_t key = (uint32_t) sid << 16 | eid;
+	eventver_t *ev;
+	int delta;
+
+	if ((ev = dvb_hash_find(&seen, dvb_hash_mix(key), eventverMatch, &key))) {
+		delta = (version - ev->version) & 0x1f;
+		if (delta == 0 || delta > 15)
+			return SEEN_BEFORE;
+		ev->version = version;
+		return SEEN_UPDATED;
+	}
+	if (seenleft == 0) {
+		if ((seenblock = malloc(SEEN_BLOCK * sizeof(eventver_t))) == NULL) {
+			perror("malloc");
+			exit(1);
+		}
+		seenleft = SEEN_BLOCK;
+	}
+	ev = seenblock++;
+	seenleft--;
+	ev->key = key;
+	ev->version = version;
+	if (dvb_hash_insert(&seen, ev, eventverHash)) {
+		perror("dvb_hash_insert");
+		exit(1);
+	}
+	return SEEN_NEW;
+} /*}}}*/
+
 static inline void set_bit(int *bf, int b) {
 	int i = b / 8 / sizeof(int);
 	int s = b % (8 * sizeof(int));
@@ -229,88 +281,72 @@ static void parseMJD(long int mjd, struct tm *t) {
 } /*}}}*/
 
 /* Parse Descriptor. {{{
- * Tags should be output in this order:
-
-'title', 'sub-title', 'desc', 'credits', 'date', 'category', 'language',
-'orig-language', 'length', 'icon', 'url', 'country', 'episode-num',
-'video', 'audio', 'previously-shown', 'premiere', 'last-chance',
-'new', 'subtitles', 'rating', 'star-rating'
-*/
+ * Every descriptor is decoded once, onto the event, for the writers. */
 static void parseDescription(event_t *ev, void *data, size_t len) {
-	int round, pds = 0;
-
-	for (round = 0; round < 8; round++) {
-		int seen = 0; // no title/language/video/audio/subtitles seen in this round
-		void *p;
-		for (p = data; p < data + len; p += DESCR_GEN_LEN + GetDescriptorLength(p)) {
-			struct descr_gen *desc = p;
-			switch (GetDescriptorTag(desc)) {
-				case 0:
-					break;
-				case 0x4D: //short evt desc, [title] [sub-title]
-					// there can be multiple language versions of these
-					if (round == 0) {
-						parseEventDescription(ev, desc, TITLE);
-					}
-					else if (round == 1)
-						parseEventDescription(ev, desc, SUB_TITLE);
-					break;
-				case 0x4E: //long evt descriptor [desc]
-					if (round == 2)
-						parseLongEventDescription(ev, desc);
-					break;
-				case 0x50: //component desc [language] [video] [audio] [subtitles]
-					if (round == 4)
-						parseComponentDescription(ev, desc, LANGUAGE, &seen);
-					else if (round == 5)
-						parseComponentDescription(ev, desc, VIDEO, &seen);
-					else if (round == 6)
-						parseComponentDescription(ev, desc, AUDIO, &seen);
-					else if (round == 7)
-						parseComponentDescription(ev, desc, SUBTITLES, &seen);
-					break;
-				case 0x53: // CA Identifier Descriptor
-					break;
-				case 0x54: // content desc [category]
-					if (round == 3)
-						parseContentDescription(ev, desc);
-					break;
-				case 0x55: // Parental Rating Descriptor [rating]
-					if (round == 7)
-						parseRatingDescription(ev, desc);
-					break;
-				case 0x5f: // Private Data Specifier
-					pds = parsePrivateDataSpecifier(ev, desc);
-					break;
-				case 0x64: // Data broadcast desc - Text Desc for Data components
-					break;
-				case 0x69: // Programm Identification Label
-					break;
-				case 0x81: // TODO ???
-					if (pds == 5) // ARD_ZDF_ORF
-						break;
-				case 0x82: // VPS (ARD, ZDF, ORF)
-					if (pds == 5) // ARD_ZDF_ORF
-						// TODO: <programme @vps-start="???">
-						break;
-				case 0x4F: // Time Shifted Event
-				case 0x52: // Stream Identifier Descriptor
-				case 0x5E: // Multi Lingual Component Descriptor
-				case 0x83: // Logical Channel Descriptor (some kind of news-ticker on ARD-MHP-Data?)
-				case 0x84: // Preferred Name List Descriptor
-				case 0x85: // Preferred Name Identifier Descriptor
-				case 0x86: // Eacem Stream Identifier Descriptor
+	struct description d;
+	int i, pds = 0;
+	void *p;
+
+	memset(&d, 0, sizeof(d));
+	for (p = data; p < data + len; p += DESCR_GEN_LEN + GetDescriptorLength(p)) {
+		struct descr_gen *desc = p;
+		switch (GetDescriptorTag(desc)) {
+			case 0:
+				break;
+			case 0x4D: //short evt desc, [title] [sub-title]
+				// there can be multiple language versions of these
+				parseEventDescription(ev, desc);
+				break;
+			case 0x4E: //long evt descriptor [desc]
+				parseLongEventDescription(ev, desc, &d);
+				break;
+			case 0x50: //component desc [language] [video] [audio] [subtitles]
+				parseComponentDescription(ev, desc);
+				break;
+			case 0x53: // CA Identifier Descriptor
+				break;
+			case 0x54: // content desc [category]
+				parseContentDescription(ev, desc);
+				break;
+			case 0x55: // Parental Rating Descriptor [rating]
+				parseRatingDescription(ev, desc);
+				break;
+			case 0x5f: // Private Data Specifier
+				pds = parsePrivateDataSpecifier(ev, desc);
+				break;
+			case 0x64: // Data broadcast desc - Text Desc for Data components
+				break;
+			case 0x69: // Programm Identification Label
+				break;
+			case 0x81: // TODO ???
+				if (pds == 5) // ARD_ZDF_ORF
 					break;
-				case 0x76: // Content identifier descriptor
-					if (round == 5)
-						parseContentIdentifierDescription(ev, desc);
+			case 0x82: // VPS (ARD, ZDF, ORF)
+				if (pds == 5) // ARD_ZDF_ORF
+					// TODO: <programme @vps-start="???">
 					break;
-				default:
-					if (round == 0)
-						printf("\t<!--Unknown_Please_Report ID=\"%x\" Len=\"%d\" -->\n", GetDescriptorTag(desc), GetDescriptorLength(desc));
-			}
+			case 0x4F: // Time Shifted Event
+			case 0x52: // Stream Identifier Descriptor
+			case 0x5E: // Multi Lingual Component Descriptor
+			case 0x83: // Logical Channel Descriptor (some kind of news-ticker on ARD-MHP-Data?)
+			case 0x84: // Preferred Name List Descriptor
+			case 0x85: // Preferred Name Identifier Descriptor
+			case 0x86: // Eacem Stream Identifier Descriptor
+				break;
+			case 0x76: // Content identifier descriptor
+				parseContentIdentifierDescription(ev, desc);
+				break;
+			default:
+				event_add_unknown(ev, GetDescriptorTag(desc), GetDescriptorLength(desc));
 		}
 	}
+	for (i = 0; i < d.ndescs; i++) {
+		char *text = assembleLongEventDescription(&d.descs[i]);
+		if (text)
+			event_set_description(ev, text, xmllang(d.descs[i].lang));
+	}
+	for (i = 0; i < d.ndescs; i++)
+		free(d.descs[i].text);
 } /*}}}*/
 
 /* Check that program has at least a title as is required by xmltv.dtd. {{{ */
@@ -327,94 +363,146 @@ static bool validateDescription(void *data, size_t len) {
 	return false;
 } /*}}}*/
 
+/* Decode DVB text for the event store. {{{
+ * The result is still DVB text, but in UTF-8 after the 0x15 selector, so
+ * that it no longer depends on its original table; NULL is returned if it
+ * decodes to nothing. */
+static const char *decodeText(const u_char *s, int len, char *out, size_t size) {
+	size_t n;
+
+	n = dvb_text_decode((const char *)s, len, out + 1, size - 1);
+	if (n == 0 || n == (size_t)-1)
+		return NULL;
+	out[0] = 0x15;
+	return out;
+} /*}}}*/
+
 /* Parse 0x4D Short Event Descriptor. {{{ */
-static void parseEventDescription(event_t *ev, void *data, enum ER round) {
+static void parseEventDescription(event_t *ev, void *data) {
 	assert(GetDescriptorTag(data) == 0x4D);
 	struct descr_short_event *evtdesc = data;
-	char evt[256];
-	char dsc[256];
+	char buf[UINT8_MAX * 4 + 2];
+	const char *text;
 
 	int evtlen = evtdesc->event_name_length;
-	if (round == TITLE) {
-		if (!evtlen)
-			return;
-		assert(evtlen < sizeof(evt));
-		memcpy(evt, (char *)&evtdesc->data, evtlen);
-		evt[evtlen] = '\0';
-		/* XXX FIXME: UTF-8 */
-		event_set_title(ev, evt, xmllang(&evtdesc->lang_code1));
-		printf("\t<title lang=\"%s\">%s</title>\n", xmllang(&evtdesc->lang_code1), xmlify(evt));
-		return;
-	}
+	if ((text = decodeText((u_char *)&evtdesc->data, evtlen, buf, sizeof(buf))))
+		event_set_title(ev, text, xmllang(&evtdesc->lang_code1));
 
-	if (round == SUB_TITLE) {
-		int dsclen = evtdesc->data[evtlen];
-		assert(dsclen < sizeof(dsc));
-		memcpy(dsc, (char *)&evtdesc->data[evtlen+1], dsclen);
-		dsc[dsclen] = '\0';
-		if (*dsc) {
-			/* XXX FIXME: UTF-8 */
-			event_set_subtitle(ev, dsc, xmllang(&evtdesc->lang_code1));
-			char *d = xmlify(dsc);
-			if (d && *d)
-				printf("\t<sub-title lang=\"%s\">%s</sub-title>\n", xmllang(&evtdesc->lang_code1), d);
-		}
-	}
+	int dsclen = evtdesc->data[evtlen];
+	if ((text = decodeText((u_char *)&evtdesc->data[evtlen+1], dsclen, buf, sizeof(buf))))
+		event_set_subtitle(ev, text, xmllang(&evtdesc->lang_code1));
 } /*}}}*/
 
-/* Parse 0x4E Extended Event Descriptor. {{{ */
-static void parseLongEventDescription(event_t *ev, void *data) {
+/* Parse 0x4E Extended Event Descriptor. {{{
+ * A description may be spread over up to 16 of these per language: each
+ * is filed by its descriptor_number, and the whole is put back together by
+ * assembleLongEventDescription() once every descriptor has been seen. */
+static void parseLongEventDescription(event_t *ev, void *data, struct description *d) {
 	assert(GetDescriptorTag(data) == 0x4E);
 	struct descr_extended_event *levt = data;
-	char dsc[256];
-	bool non_empty = (levt->descriptor_number || levt->last_descriptor_number || levt->length_of_items || levt->data[0]);
-
-	if (non_empty && levt->descriptor_number == 0)
-		printf("\t<desc lang=\"%s\">", xmllang(&levt->lang_code1));
-
-	void *p = &levt->data;
-	void *data_end = data + DESCR_GEN_LEN + GetDescriptorLength(data);
-	while (p < (void *)levt->data + levt->length_of_items) {
-		struct item_extended_event *name = p;
-		int name_len = name->item_description_length;
-		assert(p + ITEM_EXTENDED_EVENT_LEN + name_len < data_end);
-		assert(name_len < sizeof(dsc));
-		memcpy(dsc, (char *)&name->data, name_len);
-		dsc[name_len] = '\0';
-		printf("%s: ", xmlify(dsc));
-
-		p += ITEM_EXTENDED_EVENT_LEN + name_len;
-
-		struct item_extended_event *value = p;
-		int value_len = value->item_description_length;
-		assert(p + ITEM_EXTENDED_EVENT_LEN + value_len < data_end);
-		assert(value_len < sizeof(dsc));
-		memcpy(dsc, (char *)&value->data, value_len);
-		dsc[value_len] = '\0';
-		printf("%s; ", xmlify(dsc));
-
-		p += ITEM_EXTENDED_EVENT_LEN + value_len;
+	struct longdesc *l = NULL;
+	int i;
+
+	for (i = 0; i < d->ndescs; i++) {
+		if (!memcmp(d->descs[i].lang, &levt->lang_code1, 3)) {
+			l = &d->descs[i];
+			break;
+		}
 	}
-	struct item_extended_event *text = p;
-	int len = text->item_description_length;
-	if (non_empty && len) {
-		assert(len < sizeof(dsc));
-		memcpy(dsc, (char *)&text->data, len);
-		dsc[len] = '\0';
-		printf("%s", xmlify(dsc));
+	if (l == NULL) {
+		if (d->ndescs >= MAX_LANGS)
+			return;
+		l = &d->descs[d->ndescs++];
+		l->lang = &levt->lang_code1;
+	}
+	l->last = levt->last_descriptor_number;
+	l->parts[levt->descriptor_number] = levt;
+} /*}}}*/
+
+/* Append bytes to a description being reassembled. {{{
+ * The description is held as DVB text in UTF-8, so it starts with the 0x15
+ * character table selector. */
+static void appendBytes(struct longdesc *l, const char *s, size_t len) {
+	size_t need = len + (l->len ? 0 : 1);
+	char *p;
+
+	if (l->len + need + 1 > l->size) {
+		p = realloc(l->text, l->len + need + 256);
+		if (p == NULL) {
+			perror("realloc");
+			exit(1);
+		}
+		l->text = p;
+		l->size = l->len + need + 256;
 	}
+	if (!l->len)
+		l->text[l->len++] = 0x15;
+	memcpy(l->text + l->len, s, len);
+	l->len += len;
+	l->text[l->len] = '\0';
+} /*}}}*/
+
+/* Append a text item to a description being reassembled. {{{
+ * Each item may have a character table selector of its own (of any length),
+ * so each is decoded to UTF-8 separately rather than being joined as it is. */
+static void appendText(struct longdesc *l, const u_char *s, int len) {
+	char buf[UINT8_MAX * 4 + 1];
+	size_t n;
+
+	if (len <= 0)
+		return;
+	n = dvb_text_decode((const char *)s, len, buf, sizeof(buf));
+	if (n && n != (size_t)-1)
+		appendBytes(l, buf, n);
+} /*}}}*/
+
+/* Join the parts of an extended event description, in order. {{{
+ * Returns NULL if there's no text. */
+static char *assembleLongEventDescription(struct longdesc *l) {
+	int i;
+
+	l->len = 0;
+	for (i = 0; i <= l->last; i++) {
+		struct descr_extended_event *levt = l->parts[i];
+		if (levt == NULL)
+			continue;
+		void *p = &levt->data;
+		void *data_end = (void *)levt + DESCR_GEN_LEN + GetDescriptorLength(levt);
+		void *items_end = (void *)levt->data + levt->length_of_items;
+		if (items_end >= data_end)
+			continue;
+		while (p < items_end) {
+			struct item_extended_event *name = p;
+			int name_len = name->item_description_length;
+			if (p + ITEM_EXTENDED_EVENT_LEN + name_len >= items_end)
+				break;
+			p += ITEM_EXTENDED_EVENT_LEN + name_len;
+
+			struct item_extended_event *value = p;
+			int value_len = value->item_description_length;
+			if (p + ITEM_EXTENDED_EVENT_LEN + value_len > items_end)
+				break;
+			p += ITEM_EXTENDED_EVENT_LEN + value_len;
 
-	//printf("/%d/%d/%s", levt->descriptor_number, levt->last_descriptor_number, xmlify(dsc));
-	if (non_empty && levt->descriptor_number == levt->last_descriptor_number)
-		printf("</desc>\n");
+			appendText(l, (u_char *)&name->data, name_len);
+			appendBytes(l, ": ", 2);
+			appendText(l, (u_char *)&value->data, value_len);
+			appendBytes(l, "; ", 2);
+		}
+		struct item_extended_event *text = items_end;
+		int len = text->item_description_length;
+		if (items_end + ITEM_EXTENDED_EVENT_LEN + len > data_end)
+			len = data_end - items_end - ITEM_EXTENDED_EVENT_LEN;
+		appendText(l, (u_char *)&text->data, len);
+	}
+	return l->len ? l->text : NULL;
 } /*}}}*/
 
 /* Parse 0x50 Component Descriptor.  {{{
-   video is a flag, 1=> output the video information, 0=> output the
-   audio information.  seen is a pointer to a counter to ensure we
-   only output the first one of each (XMLTV can't cope with more than
-   one) */
-static void parseComponentDescription(event_t *ev, void *data, enum CR round, int *seen) {
+   Only the first video and the first audio component are output
+   (XMLTV can't cope with more than one); the language of every audio
+   component is kept, but only the first is output as such. */
+static void parseComponentDescription(event_t *ev, void *data) {
 	assert(GetDescriptorTag(data) == 0x50);
 	struct descr_component *dc = data;
 	char buf[256];
@@ -426,42 +514,22 @@ static void parseComponentDescription(event_t *ev, void *data, enum CR round, in
 
 	switch (dc->stream_content) {
 		case 0x01: // Video Info
-			if (round == VIDEO && !*seen) {
+			if (event_aspect(ev) == EA_INVALID) {
 				event_set_aspect(ev, (dc->component_type - 1) & 0x03);
 				//if ((dc->component_type-1)&0x08) //HD TV
 				//if ((dc->component_type-1)&0x04) //30Hz else 25
-				printf("\t<video>\n");
-				printf("\t\t<aspect>%s</aspect>\n", lookup(aspect_table, (dc->component_type-1) & 0x03));
-				printf("\t</video>\n");
-				(*seen)++;
 			}
 			break;
 		case 0x02: // Audio Info
-			if (round == AUDIO && !*seen) {
+			if (event_audio(ev) == EA_INVALID)
 				event_set_audio(ev, dc->component_type);
-				printf("\t<audio>\n");
-				printf("\t\t<stereo>%s</stereo>\n", lookup(audio_table, (dc->component_type)));
-				printf("\t</audio>\n");
-				(*seen)++;
-			}
-			if (round == LANGUAGE) {
-				event_set_lang(ev, xmllang(&dc->lang_code1));
-				if (!*seen)
-					printf("\t<language>%s</language>\n", xmllang(&dc->lang_code1));
-				else
-					printf("\t<!--language>%s</language-->\n", xmllang(&dc->lang_code1));
-				(*seen)++;
-			}
+			event_set_lang(ev, xmllang(&dc->lang_code1));
+			event_add_language(ev, xmllang(&dc->lang_code1));
 			break;
 		case 0x03: // Teletext Info
-			if (round == SUBTITLES) {
-			// FIXME: is there a suitable XMLTV output for this?
 			// if ((dc->component_type)&0x10) //subtitles
 			// if ((dc->component_type)&0x20) //subtitles for hard of hearing
-				printf("\t<subtitles type=\"teletext\">\n");
-				printf("\t\t<language>%s</language>\n", xmllang(&dc->lang_code1));
-				printf("\t</subtitles>\n");
-			}
+			event_add_subtitling(ev, xmllang(&dc->lang_code1));
 			break;
 			// case 0x04: // AC3 info
 	}
@@ -486,21 +554,9 @@ static void parseContentDescription(event_t *ev, void *data) {
 	for (p = &dc->data; p < data + dc->descriptor_length; p += NIBBLE_CONTENT_LEN) {
 		struct nibble_content *nc = p;
 		int c1 = (nc->content_nibble_level_1 << 4) + nc->content_nibble_level_2;
-#ifdef CATEGORY_UNKNOWN
-		int c2 = (nc->user_nibble_1 << 4) + nc->user_nibble_2;
-#endif
 		if (c1 > 0 && !get_bit(once, c1)) {
 			set_bit(once, c1);
-			char *c = lookup(description_table, c1);
-			if (c)
-				if (c[0])
-					printf("\t<category>%s</category>\n", c);
-#ifdef CATEGORY_UNKNOWN
-				else
-					printf("\t<!--category>%s %02X %02X</category-->\n", c+1, c1, c2);
-			else
-				printf("\t<!--category>%02X %02X</category-->\n", c1, c2);
-#endif
+			event_add_category(ev, c1);
 		}
 		// This is weird in the uk, they use user but not content, and almost the same values
 	}
@@ -517,9 +573,7 @@ static void parseRatingDescription(event_t *ev, void *data) {
 			case 0x00: /*undefined*/
 				break;
 			case 0x01 ... 0x0F:
-				printf("\t<rating system=\"dvb\">\n");
-				printf("\t\t<value>%d</value>\n", pr->rating + 3);
-				printf("\t</rating>\n");
+				event_add_rating(ev, pr->rating);
 				break;
 			case 0x10 ... 0xFF: /*broadcaster defined*/
 				break;
@@ -545,17 +599,8 @@ static void parseContentIdentifierDescription(event_t *ev, void *data) {
 
 		int crid_length = 3;
 
-		char type_buf[32];
-		char *type;
 		char buf[256];
 
-		type = lookup(crid_type_table, crid->crid_type);
-		if (type == NULL)
-		{
-			type = type_buf;
-			sprintf(type_buf, "0x%2x", crid->crid_type);
-		}
-
 		switch (crid->crid_location)
 		{
 		case 0x00: /* Carried explicitly within descriptor */
@@ -572,7 +617,7 @@ static void parseContentIdentifierDescription(event_t *ev, void *data) {
 			{
 				event_set_scrid(ev, buf);
 			}
-			printf("\t<crid type='%s'>%s</crid>\n", type, xmlify(buf));
+			event_add_crid(ev, crid->crid_type, buf);
 			crid_length = 2 + crid_data->crid_length;
 			break;
 		case 0x01: /* Carried in Content Identifier Table (CIT) */
@@ -0,0 +1,288 @@
+/*
+ * Copyright 2010 Mo McRoberts.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Concurrent acquisition of several SI tables from a single source: each
+ * section filter added is serviced by the same reactor, so that (for
+ * example) the NIT, SDT and EIT can all be collected in one pass rather than
+ * one after another.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "p_dvb.h"
+
+static int dvb_acquire_table(dvb_demux_t *context, dvb_table_t *table, void *data);
+
+dvb_acquire_t *
+dvb_acquire_open(int adapter, int demux)
+{
+	char path[64];
+
+	snprintf(path, 64, "/dev/dvb/adapter%d/demux%d", adapter, demux);
+	return dvb_acquire_open_path(path);
+}
+
+/* Prepare to acquire tables from path, which may be either a demux device
+ * (in which case a separate demux context is opened for each filter) or a
+ * raw MPEG transport stream (in which case PID filtering is performed in
+ * userspace).
+ */
+dvb_acquire_t *
+dvb_acquire_open_path(const char *path)
+{
+	struct stat sbuf;
+	dvb_acquire_t *p;
+	dvb_demux_t *ctx;
+
+	if(-1 == stat(path, &sbuf))
+	{
+		return NULL;
+	}
+	if(NULL == (p = calloc(1, sizeof(dvb_acquire_t))))
+	{
+		return NULL;
+	}
+	if(NULL == (p->path = strdup(path)))
+	{
+		free(p);
+		return NULL;
+	}
+	if(S_ISCHR(sbuf.st_mode))
+	{
+		return p;
+	}
+	if(NULL == (p->contexts = calloc(1, sizeof(dvb_demux_t *))))
+	{
+		dvb_acquire_close(p);
+		return NULL;
+	}
+	if(NULL == (ctx = dvb_demux_open_path(path, NULL, NULL, 0)))
+	{
+		dvb_acquire_close(p);
+		return NULL;
+	}
+	p->contexts[0] = ctx;
+	p->ncontexts = 1;
+	p->ts = 1;
+	return p;
+}
+
+void
+dvb_acquire_close(dvb_acquire_t *acq)
+{
+	size_t i;
+
+	for(i = 0; i < acq->ncontexts; i++)
+	{
+		dvb_demux_close(acq->contexts[i]);
+	}
+	free(acq->contexts);
+	free(acq->filters);
+	free(acq->pids);
+	free(acq->path);
+	free(acq);
+}
+
+/* Add a section filter to the set being acquired. Where the source is a
+ * demux device, the filter is started immediately.
+ */
+int
+dvb_acquire_add(dvb_acquire_t *acq, struct dmx_sct_filter_params *filter)
+{
+	struct dmx_sct_filter_params *f;
+	dvb_demux_t **c, *ctx;
+	int *p;
+	size_t i;
+
+	if(NULL == (f = realloc(acq->filters, sizeof(struct dmx_sct_filter_params) * (acq->nfilters + 1))))
+	{
+		return -1;
+	}
+	acq->filters = f;
+	if(acq->ts)
+	{
+		/* Transport stream: add the PID to the set being reassembled */
+		for(i = 0; i < acq->npids; i++)
+		{
+			if(acq->pids[i] == filter->pid)
+			{
+				break;
+			}
+		}
+		if(i == acq->npids)
+		{
+			if(NULL == (p = realloc(acq->pids, sizeof(int) * (acq->npids + 1))))
+			{
+				return -1;
+			}
+			acq->pids = p;
+			p[acq->npids] = filter->pid;
+			if(dvb_demux_set_ts(acq->contexts[0], p, acq->npids + 1))
+			{
+				return -1;
+			}
+			acq->npids++;
+		}
+		acq->filters[acq->nfilters] = *filter;
+		acq->nfilters++;
+		return 0;
+	}
+	if(NULL == (c = realloc(acq->contexts, sizeof(dvb_demux_t *) * (acq->ncontexts + 1))))
+	{
+		return -1;
+	}
+	acq->contexts = c;
+	if(NULL == (ctx = dvb_demux_open_path(acq->path, filter, NULL, 0)))
+	{
+		return -1;
+	}
+	if(!(filter->flags & DMX_IMMEDIATE_START) && -1 == dvb_demux_start(ctx))
+	{
+		dvb_demux_close(ctx);
+		return -1;
+	}
+	c[acq->ncontexts] = ctx;
+	acq->ncontexts++;
+	acq->filters[acq->nfilters] = *filter;
+	acq->nfilters++;
+	return 0;
+}
+
+/* Stop reading from any filter which has received no data in timeout
+ * seconds.
+ */
+void
+dvb_acquire_set_timeout(dvb_acquire_t *acq, time_t timeout)
+{
+	acq->timeout = timeout;
+}
+
+/* Attach the filters to a reactor, so that several acquisitions (for example,
+ * one per adapter) can be serviced by a single dvb_reactor_run(). Each
+ * complete table is passed to dvb_parse_si() and then to the table callback,
+ * if one is supplied; once the callback returns non-zero, all of the filters
+ * are detached and dvb_acquire_complete() will return 1. Each filter is
+ * otherwise read until 'until' (if non-zero), its idle timeout, or the end of
+ * the input.
+ */
+int
+dvb_acquire_attach(dvb_acquire_t *acq, dvb_reactor_t *reactor, time_t until, dvb_callbacks_t *callbacks)
+{
+	size_t i;
+
+	acq->reactor = reactor;
+	acq->callbacks = callbacks;
+	acq->complete = 0;
+	for(i = 0; i < acq->ncontexts; i++)
+	{
+		dvb_demux_set_timeout(acq->contexts[i], acq->timeout);
+		if(dvb_reactor_add(reactor, acq->contexts[i], until, dvb_acquire_table, acq))
+		{
+			while(i > 0)
+			{
+				i--;
+				dvb_reactor_remove(reactor, acq->contexts[i]);
+			}
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int
+dvb_acquire_complete(dvb_acquire_t *acq)
+{
+	return acq->complete;
+}
+
+/* Service the filters with a private reactor until the acquisition completes
+ * or every filter has expired. Returns 1 if the table callback ended the
+ * acquisition, 0 otherwise, or -1 on error.
+ */
+int
+dvb_acquire_run(dvb_acquire_t *acq, time_t until, dvb_callbacks_t *callbacks)
+{
+	dvb_reactor_t *reactor;
+	int r;
+
+	if(NULL == (reactor = dvb_reactor_new()))
+	{
+		return -1;
+	}
+	if(dvb_acquire_attach(acq, reactor, until, callbacks))
+	{
+		dvb_reactor_delete(reactor);
+		return -1;
+	}
+	r = dvb_reactor_run(reactor);
+	dvb_reactor_delete(reactor);
+	acq->reactor = NULL;
+	if(r)
+	{
+		return r;
+	}
+	return acq->complete;
+}
+
+static int
+dvb_acquire_table(dvb_demux_t *context, dvb_table_t *table, void *data)
+{
+	dvb_acquire_t *acq = data;
+	dvb_callbacks_t *callbacks = acq->callbacks;
+	size_t i;
+
+	if(!table)
+	{
+		DBG(5, fprintf(stderr, "[dvb_acquire_table: input %d has expired]\n", dvb_demux_fd(context)));
+		return 0;
+	}
+	if(acq->ts)
+	{
+		/* The kernel hasn't filtered by table_id for us */
+		for(i = 0; i < acq->nfilters; i++)
+		{
+			if((table->table_id & acq->filters[i].filter.mask[0]) == (acq->filters[i].filter.filter[0] & acq->filters[i].filter.mask[0]))
+			{
+				break;
+			}
+		}
+		if(i == acq->nfilters)
+		{
+			return 0;
+		}
+	}
+	dvb_parse_si(table, callbacks);
+	if(callbacks && callbacks->table && callbacks->table(table, callbacks->table_data))
+	{
+		/* Complete: stop reading from all of the filters */
+		acq->complete = 1;
+		for(i = 0; i < acq->ncontexts; i++)
+		{
+			if(acq->contexts[i] != context)
+			{
+				dvb_reactor_remove(acq->reactor, acq->contexts[i]);
+			}
+		}
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2010 Mo McRoberts.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Storage for captured sections: each demux context carves sections out of
+ * its own slabs, in power-of-two size classes from 256 bytes up to the 4096
+ * byte section maximum. Freed sections go onto a per-class free list for
+ * reuse, and the slabs themselves are only returned to the system in bulk
+ * when the context is destroyed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "p_dvb.h"
+
+struct dvb_arena_slab_struct
+{
+	dvb_arena_slab_t *next;
+	uint8_t data[DVB_ARENA_SLAB];
+};
+
+static int
+dvb_arena_class(size_t size)
+{
+	int c;
+
+	for(c = 0; c < DVB_ARENA_CLASSES; c++)
+	{
+		if(size <= ((size_t) DVB_ARENA_MIN << c))
+		{
+			return c;
+		}
+	}
+	return -1;
+}
+
+/* Allocate size bytes (uninitialised), or return NULL if size is larger than
+ * a section can be or the arena has reached its limit.
+ */
+void *
+dvb_arena_alloc(dvb_arena_t *arena, size_t size)
+{
+	dvb_arena_slab_t *slab;
+	void *p;
+	int c;
+
+	if(-1 == (c = dvb_arena_class(size)))
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+	if((p = arena->free[c]))
+	{
+		arena->free[c] = *(void **) p;
+		return p;
+	}
+	if(arena->left[c] < ((size_t) DVB_ARENA_MIN << c))
+	{
+		if(arena->limit && arena->used + sizeof(dvb_arena_slab_t) > arena->limit)
+		{
+			DBG(5, fprintf(stderr, "Warning: dvb_arena_alloc: memory limit of %lu bytes reached\n", (unsigned long) arena->limit));
+			errno = ENOMEM;
+			return NULL;
+		}
+		if(NULL == (slab = malloc(sizeof(dvb_arena_slab_t))))
+		{
+			return NULL;
+		}
+		slab->next = arena->slabs;
+		arena->slabs = slab;
+		arena->used += sizeof(dvb_arena_slab_t);
+		arena->cur[c] = slab->data;
+		arena->left[c] = DVB_ARENA_SLAB;
+	}
+	p = arena->cur[c];
+	arena->cur[c] += ((size_t) DVB_ARENA_MIN << c);
+	arena->left[c] -= ((size_t) DVB_ARENA_MIN << c);
+	return p;
+}
+
+/* Return a block obtained from dvb_arena_alloc() with the same size */
+void
+dvb_arena_free(dvb_arena_t *arena, void *p, size_t size)
+{
+	int c;
+
+	if(!p || -1 == (c = dvb_arena_class(size)))
+	{
+		return;
+	}
+	*(void **) p = arena->free[c];
+	arena->free[c] = p;
+}
+
+/* Release all of the slabs at once; anything allocated from the arena is
+ * invalid afterwards.
+ */
+void
+dvb_arena_release(dvb_arena_t *arena)
+{
+	dvb_arena_slab_t *slab;
+	size_t limit;
+
+	while((slab = arena->slabs))
+	{
+		arena->slabs = slab->next;
+		free(slab);
+	}
+	limit = arena->limit;
+	memset(arena, 0, sizeof(dvb_arena_t));
+	arena->limit = limit;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2010 Mo McRoberts.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "callbacks.h"
+
+/* Attach a writer to the end of the list; a writer can only be attached to
+ * one set of callbacks at a time.
+ */
+void
+dvb_callbacks_add_writer(dvb_callbacks_t *callbacks, dvb_writer_t *writer)
+{
+	dvb_writer_t **p;
+
+	for(p = &(callbacks->writers); *p; p = &((*p)->next));
+	writer->next = NULL;
+	*p = writer;
+}
+
+/* Pass a service to the service callback and then to each writer. Every one
+ * is invoked regardless; the result is that of the first to return non-zero.
+ */
+int
+dvb_callbacks_service(dvb_callbacks_t *callbacks, service_t *svc)
+{
+	dvb_writer_t *w;
+	int r, result;
+
+	result = 0;
+	if(!callbacks)
+	{
+		return 0;
+	}
+	if(callbacks->service)
+	{
+		result = callbacks->service(svc, callbacks->service_data);
+	}
+	for(w = callbacks->writers; w; w = w->next)
+	{
+		if(w->service && (r = w->service(svc, w->data)) && !result)
+		{
+			result = r;
+		}
+	}
+	return result;
+}
+
+/* As dvb_callbacks_service(), for an event */
+int
+dvb_callbacks_event(dvb_callbacks_t *callbacks, event_t *event)
+{
+	dvb_writer_t *w;
+	int r, result;
+
+	result = 0;
+	if(!callbacks)
+	{
+		return 0;
+	}
+	if(callbacks->event)
+	{
+		result = callbacks->event(event, callbacks->event_data);
+	}
+	for(w = callbacks->writers; w; w = w->next)
+	{
+		if(w->event && (r = w->event(event, w->data)) && !result)
+		{
+			result = r;
+		}
+	}
+	return result;
+}
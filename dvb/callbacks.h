@@ -6,6 +6,22 @@
 # include "networks.h"
 
 typedef struct dvb_callbacks_struct dvb_callbacks_t;
+typedef struct dvb_writer_struct dvb_writer_t;
+
+struct dvb_table_struct;
+
+/* An output format: every writer attached to a set of callbacks is passed
+ * each service and event in turn, so that any number of formats can be
+ * produced from a single acquisition. Either callback may be NULL.
+ */
+struct dvb_writer_struct
+{
+	const char *name;
+	int (*service)(service_t *svc, void *data);
+	int (*event)(event_t *event, void *data);
+	void *data;
+	dvb_writer_t *next;
+};
 
 struct dvb_callbacks_struct
 {
@@ -17,6 +33,19 @@ struct dvb_callbacks_struct
 
 	int (*network)(network_t *network, void *data);
 	void *network_data;
+
+	/* Invoked by dvb_acquire_run() for each complete table once it has been
+	 * parsed; returning non-zero ends the acquisition.
+	 */
+	int (*table)(struct dvb_table_struct *table, void *data);
+	void *table_data;
+
+	/* Invoked after service and event, in the order they were added */
+	dvb_writer_t *writers;
 };
 
+void dvb_callbacks_add_writer(dvb_callbacks_t *callbacks, dvb_writer_t *writer);
+int dvb_callbacks_service(dvb_callbacks_t *callbacks, service_t *svc);
+int dvb_callbacks_event(dvb_callbacks_t *callbacks, event_t *event);
+
 #endif /*!CALLBACKS_H_*/
@@ -1,10 +1,33 @@
 /* crc32.c: CRC32 routine
+ *
+ * CRC-32/MPEG-2 (polynomial 0x04C11DB7, initial value 0xFFFFFFFF, MSB-first,
+ * no final XOR), as used by PSI/SI sections. Three implementations are
+ * provided: the byte-at-a-time table, slicing-by-8, and (on x86-64 CPUs which
+ * support it) PCLMULQDQ folding. dvb_crc32() uses the fastest available,
+ * which is selected once, at startup.
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+# define DVB_CRC32_CLMUL                1
+# include <immintrin.h>
+#endif
 
 #include "p_dvb.h"
 
+#ifdef DVB_CRC32_CLMUL
+static uint32_t dvb_crc32_clmul(const uint8_t *data, size_t len);
+#endif
+
+static uint32_t (*dvb_crc32_impl)(const uint8_t *data, size_t len) = dvb_crc32_slice8;
+
+/* Slicing tables: crc_slice[k][b] is the CRC of byte b followed by k zero
+ * bytes; crc_slice[0] is crc_table.
+ */
+static uint32_t crc_slice[8][256];
+
 static const uint32_t crc_table[256] = 
 {
 	0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9, 0x130476dc, 0x17c56b6b,
@@ -52,12 +75,27 @@ static const uint32_t crc_table[256] =
 	0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
 };
 
-uint32_t 
-dvb_crc32(const uint8_t *data, size_t len)
+static void
+dvb_crc32_init_slices(void)
+{
+	int k, b;
+
+	memcpy(crc_slice[0], crc_table, sizeof(crc_table));
+	for(k = 1; k < 8; k++)
+	{
+		for(b = 0; b < 256; b++)
+		{
+			crc_slice[k][b] = (crc_slice[k - 1][b] << 8) ^ crc_table[crc_slice[k - 1][b] >> 24];
+		}
+	}
+}
+
+/* Continue a CRC over further data a byte at a time */
+static uint32_t
+dvb_crc32_bytes(uint32_t crc, const uint8_t *data, size_t len)
 {
 	size_t i;
-	uint32_t crc = 0xffffffff;
-	
+
 	for (i = 0; i < len; i++)
 	{
 		crc = (crc << 8) ^ crc_table[((crc >> 24) ^ *data++) & 0xff];
@@ -65,3 +103,148 @@ dvb_crc32(const uint8_t *data, size_t len)
 	return crc;
 }
 
+uint32_t 
+dvb_crc32_table(const uint8_t *data, size_t len)
+{
+	return dvb_crc32_bytes(0xffffffff, data, len);
+}
+
+uint32_t
+dvb_crc32_slice8(const uint8_t *data, size_t len)
+{
+	uint32_t crc = 0xffffffff;
+
+	while(len >= 8)
+	{
+		crc ^= ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) | ((uint32_t) data[2] << 8) | data[3];
+		crc = crc_slice[7][crc >> 24] ^ crc_slice[6][(crc >> 16) & 0xff] ^
+			crc_slice[5][(crc >> 8) & 0xff] ^ crc_slice[4][crc & 0xff] ^
+			crc_slice[3][data[4]] ^ crc_slice[2][data[5]] ^
+			crc_slice[1][data[6]] ^ crc_slice[0][data[7]];
+		data += 8;
+		len -= 8;
+	}
+	return dvb_crc32_bytes(crc, data, len);
+}
+
+#ifdef DVB_CRC32_CLMUL
+
+/* Folding constants, x^n mod P for the values of n below */
+static uint64_t crc_k128, crc_k192, crc_k256, crc_k320, crc_k384, crc_k448, crc_k512, crc_k576;
+
+static uint64_t
+dvb_crc32_xpow(int n)
+{
+	uint32_t r;
+
+	/* r = x^32 mod P, then multiply by x (n - 32) more times */
+	r = 0x04c11db7;
+	for(n -= 32; n > 0; n--)
+	{
+		r = (r << 1) ^ ((r & 0x80000000) ? 0x04c11db7 : 0);
+	}
+	return r;
+}
+
+/* Multiply the 128-bit polynomial a by x^n, where k is (x^(n+64) mod P,
+ * x^n mod P), yielding a congruent value of at most 96 bits.
+ */
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i
+dvb_crc32_fold(__m128i a, __m128i k)
+{
+	return _mm_xor_si128(_mm_clmulepi64_si128(a, k, 0x11), _mm_clmulepi64_si128(a, k, 0x00));
+}
+
+/* Because the CRC isn't bit-reflected, the polynomial's most significant
+ * coefficient is the top bit of the first byte; each 16-byte block is
+ * byte-swapped so that it's also the top bit of the 128-bit integer.
+ */
+__attribute__((target("pclmul,ssse3")))
+static uint32_t
+dvb_crc32_clmul(const uint8_t *data, size_t len)
+{
+	__m128i swap, k, a0, a1, a2, a3;
+	uint8_t buf[16];
+	uint32_t crc;
+
+	if(len < 64)
+	{
+		return dvb_crc32_slice8(data, len);
+	}
+	swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	a0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (const void *) data), swap);
+	a1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (const void *) (data + 16)), swap);
+	a2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (const void *) (data + 32)), swap);
+	a3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (const void *) (data + 48)), swap);
+	/* The initial value inverts the first 32 bits of the message */
+	a0 = _mm_xor_si128(a0, _mm_set_epi32(0xffffffff, 0, 0, 0));
+	data += 64;
+	len -= 64;
+	/* Fold four blocks at a time */
+	k = _mm_set_epi64x(crc_k576, crc_k512);
+	while(len >= 64)
+	{
+		a0 = _mm_xor_si128(dvb_crc32_fold(a0, k), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (const void *) data), swap));
+		a1 = _mm_xor_si128(dvb_crc32_fold(a1, k), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (const void *) (data + 16)), swap));
+		a2 = _mm_xor_si128(dvb_crc32_fold(a2, k), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (const void *) (data + 32)), swap));
+		a3 = _mm_xor_si128(dvb_crc32_fold(a3, k), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (const void *) (data + 48)), swap));
+		data += 64;
+		len -= 64;
+	}
+	/* Combine the four accumulators into one */
+	a0 = dvb_crc32_fold(a0, _mm_set_epi64x(crc_k448, crc_k384));
+	a1 = dvb_crc32_fold(a1, _mm_set_epi64x(crc_k320, crc_k256));
+	a2 = dvb_crc32_fold(a2, _mm_set_epi64x(crc_k192, crc_k128));
+	a0 = _mm_xor_si128(_mm_xor_si128(a0, a1), _mm_xor_si128(a2, a3));
+	/* Then fold single blocks */
+	k = _mm_set_epi64x(crc_k192, crc_k128);
+	while(len >= 16)
+	{
+		a0 = _mm_xor_si128(dvb_crc32_fold(a0, k), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (const void *) data), swap));
+		data += 16;
+		len -= 16;
+	}
+	/* The accumulator is congruent to the (inverted) message so far; the
+	 * table yields its remainder, and continues over the tail.
+	 */
+	_mm_storeu_si128((__m128i *) (void *) buf, _mm_shuffle_epi8(a0, swap));
+	crc = dvb_crc32_bytes(0, buf, 16);
+	return dvb_crc32_bytes(crc, data, len);
+}
+
+#endif /*DVB_CRC32_CLMUL*/
+
+/* Build the tables and pick an implementation once, at startup, before any
+ * thread can be computing a CRC: nothing here is changed afterwards.
+ */
+__attribute__((constructor))
+static void
+dvb_crc32_select(void)
+{
+	dvb_crc32_init_slices();
+#ifdef DVB_CRC32_CLMUL
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3"))
+	{
+		crc_k128 = dvb_crc32_xpow(128);
+		crc_k192 = dvb_crc32_xpow(192);
+		crc_k256 = dvb_crc32_xpow(256);
+		crc_k320 = dvb_crc32_xpow(320);
+		crc_k384 = dvb_crc32_xpow(384);
+		crc_k448 = dvb_crc32_xpow(448);
+		crc_k512 = dvb_crc32_xpow(512);
+		crc_k576 = dvb_crc32_xpow(576);
+		dvb_crc32_impl = dvb_crc32_clmul;
+	}
+#endif
+}
+
+/* Return the CRC-32/MPEG-2 of len bytes of data; for a complete section
+ * including its CRC_32 field, this is zero if the section is intact.
+ */
+uint32_t
+dvb_crc32(const uint8_t *data, size_t len)
+{
+	return dvb_crc32_impl(data, len);
+}
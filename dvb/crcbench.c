@@ -0,0 +1,202 @@
+/*
+ * Copyright 2010 Mo McRoberts.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Compare the CRC implementations over a set of sections: either those in a
+ * capture file (a sequence of sections, as read from a section filter), or a
+ * synthetic set whose sizes follow a typical SI distribution.
+ *
+ * Usage: crcbench [SECTIONS-FILE]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "p_dvb.h"
+
+int debug_level = 0;
+
+typedef struct
+{
+	const char *name;
+	uint32_t (*fn)(const uint8_t *data, size_t len);
+} crcbench_impl_t;
+
+static uint8_t *data;
+static size_t datalen;
+static size_t *offsets;
+static size_t nsections;
+
+static int
+add_section(size_t off, size_t len)
+{
+	size_t *p;
+
+	if(NULL == (p = realloc(offsets, sizeof(size_t) * 2 * (nsections + 1))))
+	{
+		return -1;
+	}
+	offsets = p;
+	offsets[nsections * 2] = off;
+	offsets[nsections * 2 + 1] = len;
+	nsections++;
+	return 0;
+}
+
+static int
+load_file(const char *path)
+{
+	FILE *f;
+	size_t off, len;
+	uint8_t *p;
+	size_t n;
+
+	if(NULL == (f = fopen(path, "rb")))
+	{
+		perror(path);
+		return -1;
+	}
+	while(1)
+	{
+		if(NULL == (p = realloc(data, datalen + 65536)))
+		{
+			fclose(f);
+			return -1;
+		}
+		data = p;
+		if(!(n = fread(&(data[datalen]), 1, 65536, f)))
+		{
+			break;
+		}
+		datalen += n;
+	}
+	fclose(f);
+	for(off = 0; off + sizeof(si_tab_t) <= datalen; off += len)
+	{
+		len = GetSectionLength(&(data[off])) + sizeof(si_tab_t);
+		if(off + len > datalen)
+		{
+			break;
+		}
+		add_section(off, len);
+	}
+	return 0;
+}
+
+/* Roughly the mix seen on a busy multiplex: many short p/f and SDT
+ * sections, mostly mid-sized schedule sections, and some at the 4KiB limit.
+ */
+static int
+generate(void)
+{
+	size_t i, len, off;
+
+	datalen = 16 * 1024 * 1024;
+	if(NULL == (data = malloc(datalen)))
+	{
+		return -1;
+	}
+	srand(1);
+	for(i = 0; i < datalen; i++)
+	{
+		data[i] = rand();
+	}
+	for(off = 0; ; off += len)
+	{
+		i = rand() % 100;
+		if(i < 30)
+		{
+			len = 16 + rand() % 240;
+		}
+		else if(i < 85)
+		{
+			len = 256 + rand() % 768;
+		}
+		else
+		{
+			len = 1024 + rand() % 3072;
+		}
+		if(off + len > datalen)
+		{
+			break;
+		}
+		add_section(off, len);
+	}
+	return 0;
+}
+
+static void
+bench(const crcbench_impl_t *impl)
+{
+	struct timespec start, end;
+	uint32_t acc;
+	size_t i, bytes;
+	int pass;
+	double secs;
+
+	acc = 0;
+	bytes = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(pass = 0; pass < 10; pass++)
+	{
+		for(i = 0; i < nsections; i++)
+		{
+			acc += impl->fn(&(data[offsets[i * 2]]), offsets[i * 2 + 1]);
+			bytes += offsets[i * 2 + 1];
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("%-14s %9.1f MB/s %9.2f Msections/s (%08x)\n", impl->name,
+		   bytes / secs / 1e6, nsections * 10 / secs / 1e6, acc);
+}
+
+int
+main(int argc, char **argv)
+{
+	static const crcbench_impl_t impls[] = {
+		{ "table", dvb_crc32_table },
+		{ "slicing-by-8", dvb_crc32_slice8 },
+		{ "dvb_crc32", dvb_crc32 },
+		{ NULL, NULL }
+	};
+	size_t i;
+
+	if(argc > 1)
+	{
+		if(load_file(argv[1]))
+		{
+			return 1;
+		}
+	}
+	else if(generate())
+	{
+		return 1;
+	}
+	if(!nsections)
+	{
+		fprintf(stderr, "%s: no sections to process\n", argv[0]);
+		return 1;
+	}
+	printf("%lu sections, %lu bytes\n", (unsigned long) nsections, (unsigned long) datalen);
+	for(i = 0; impls[i].name; i++)
+	{
+		bench(&(impls[i]));
+	}
+	return 0;
+}
@@ -65,6 +65,11 @@ dvb_demux_open_fd(int fd, struct dmx_sct_filter_params *filter, struct dmx_pes_f
 	{
 		return NULL;
 	}
+	if(filter && S_ISCHR(sbuf.st_mode))
+	{
+		p->filter = *filter;
+		p->filtered = 1;
+	}
 	return p;
 }
 
@@ -106,6 +111,73 @@ dvb_demux_close(dvb_demux_t *context)
 	dvb_demux_delete(context);
 }
 
+/* Initialise a section filter to match the tables from first_table_id to
+ * last_table_id inclusive on the given PID, and to have the kernel discard
+ * sections whose CRC is bad. The range is widened to the smallest one which
+ * can be expressed as a mask on the table_id; the remainder are discarded by
+ * the caller (dvb_acquire_run() does this).
+ */
+void
+dvb_filter_tables(struct dmx_sct_filter_params *filter, int pid, int first_table_id, int last_table_id)
+{
+	int mask;
+
+	memset(filter, 0, sizeof(struct dmx_sct_filter_params));
+	filter->pid = pid;
+	filter->flags = DMX_CHECK_CRC;
+	for(mask = 0xFF; mask && (first_table_id & mask) != (last_table_id & mask); mask = (mask << 1) & 0xFF);
+	filter->filter.filter[0] = first_table_id & mask;
+	filter->filter.mask[0] = mask;
+}
+
+/* Invoked when a sub-table read from a context has been completed. If the
+ * context's section filter can only match that one sub-table, reprogram it so
+ * that the kernel discards further sections until version_number changes:
+ * byte 5 of the section is the fourth byte of the filter (section_length isn't
+ * included), and a mode bit of 1 requests a negative match.
+ *
+ * dvb_filter_tables() matches on the table_id alone, so only the actual NIT
+ * and SDT, each of which is the single sub-table of its kind on its PID, can
+ * be filtered this way. The EIT carries a sub-table for each service (and
+ * several for each service's schedule) on the one PID, so its sections are
+ * never filtered by version: they are discarded by the EIT parser instead.
+ */
+void
+dvb_demux_filter_complete(dvb_demux_t *context, dvb_table_t *table)
+{
+	struct dmx_sct_filter_params *f;
+
+	if(!context->filtered)
+	{
+		return;
+	}
+	f = &(context->filter);
+	if(f->filter.mask[0] != 0xFF)
+	{
+		return;
+	}
+	if(!(f->pid == 0x0010 && table->table_id == 0x40) &&
+	   !(f->pid == 0x0011 && table->table_id == 0x42))
+	{
+		/* Several sub-tables may match */
+		return;
+	}
+	if(f->filter.mode[3] == 0x3E && f->filter.filter[3] == ((table->version_number << 1) & 0x3E))
+	{
+		return;
+	}
+	f->filter.filter[3] = (table->version_number << 1) & 0x3E;
+	f->filter.mask[3] = 0x3E;
+	f->filter.mode[3] = 0x3E;
+	f->flags |= DMX_IMMEDIATE_START;
+	DBG(5, fprintf(stderr, "[dvb_demux_filter_complete: table 0x%02x on PID 0x%04x complete; skipping version %d]\n", table->table_id, f->pid, table->version_number));
+	if(-1 == ioctl(context->fd, DMX_SET_FILTER, f))
+	{
+		fprintf(stderr, "Warning: dvb_demux_filter_complete: DMX_SET_FILTER failed: %s\n", strerror(errno));
+		context->filtered = 0;
+	}
+}
+
 int
 dvb_demux_start(dvb_demux_t *context)
 {
@@ -128,9 +200,41 @@ dvb_demux_new(int fd)
 void
 dvb_demux_delete(dvb_demux_t *context)
 {
+	dvb_ts_delete(context->ts);
+	dvb_demux_tables_free(context);
+	dvb_arena_release(&(context->arena));
 	free(context);
 }
 
+/* Treat the input as a raw MPEG transport stream rather than a sequence of
+ * sections, performing PID filtering and section reassembly in userspace.
+ * If pids is NULL, the standard DVB SI PIDs (NIT, SDT/BAT, EIT, TDT/TOT) are
+ * used.
+ */
+int
+dvb_demux_set_ts(dvb_demux_t *context, const int *pids, size_t npids)
+{
+	dvb_ts_t *ts;
+
+	if(NULL == (ts = dvb_ts_new(pids, npids)))
+	{
+		return -1;
+	}
+	dvb_ts_delete(context->ts);
+	context->ts = ts;
+	return 0;
+}
+
+/* Limit the memory used to hold sections of partially-assembled tables to
+ * (approximately) limit bytes; sections which arrive once the limit has been
+ * reached are discarded. A limit of zero means no limit.
+ */
+void
+dvb_demux_set_memory_limit(dvb_demux_t *context, size_t limit)
+{
+	context->arena.limit = limit;
+}
+
 void
 dvb_demux_set_fd(dvb_demux_t *context, int fd)
 {
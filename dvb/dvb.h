@@ -20,8 +20,15 @@
 # include "services.h"
 # include "events.h"
 # include "networks.h"
+/* Multiplexes and platforms are never freed. Before a rescan,
+ * mux_reset_all() and platform_reset_all() forget all of them at once: none
+ * is visible to the mux_locate*(), platform_locate*() or mux_foreach()
+ * functions until it is added again, when it is reset and re-used in place.
+ */
 # include "multiplexes.h"
 # include "platforms.h"
+# include "intern.h"
+# include "hash.h"
 
 # include "callbacks.h"
 
@@ -34,6 +41,12 @@
 typedef struct dvb_table_struct dvb_table_t;
 typedef union dvb_section_union dvb_section_t;
 typedef struct dvb_demux_struct dvb_demux_t;
+typedef struct dvb_ts_struct dvb_ts_t;
+typedef struct dvb_acquire_struct dvb_acquire_t;
+typedef struct dvb_reactor_struct dvb_reactor_t;
+typedef struct dvb_schedule_struct dvb_schedule_t;
+
+# define DVB_TS_PACKET_SIZE             188
 
 struct dvb_table_struct
 {
@@ -41,8 +54,22 @@ struct dvb_table_struct
 	int version_number;
 	int current_next_indicator;
 	uint32_t identifier;
+	/* The full identity of the sub-table; transport_stream_id and
+	 * original_network_id are zero where the table doesn't carry them
+	 */
+	int table_id_extension;
+	int transport_stream_id;
+	int original_network_id;
+	/* For EITs, the last table_id carrying the service's schedule */
+	int last_table_id;
 	size_t nsections;
+	/* Sections absent from a segmented EIT schedule are NULL */
 	dvb_section_t **sections;
+	/* The sections accounted for so far (received, or known to be absent)
+	 * and the number still outstanding
+	 */
+	uint32_t received[8];
+	size_t remaining;
 };
 
 union dvb_section_union
@@ -72,15 +99,52 @@ extern "C" {
 	void dvb_demux_set_timeout(dvb_demux_t *context, time_t timeout);
 	time_t dvb_demux_timeout(dvb_demux_t *context);
 
+	int dvb_demux_set_ts(dvb_demux_t *context, const int *pids, size_t npids);
+
+	void dvb_demux_set_memory_limit(dvb_demux_t *context, size_t limit);
+
 	int dvb_demux_start(dvb_demux_t *context);
 
+	void dvb_filter_tables(struct dmx_sct_filter_params *filter, int pid, int first_table_id, int last_table_id);
+
 	dvb_table_t *dvb_demux_read(dvb_demux_t *context, time_t until);
+	dvb_table_t *dvb_demux_read_nowait(dvb_demux_t *context);
+	int dvb_demux_eof(dvb_demux_t *context);
+
+	dvb_reactor_t *dvb_reactor_new(void);
+	void dvb_reactor_delete(dvb_reactor_t *reactor);
+	int dvb_reactor_add(dvb_reactor_t *reactor, dvb_demux_t *context, time_t deadline, int (*fn)(dvb_demux_t *context, dvb_table_t *table, void *data), void *data);
+	int dvb_reactor_remove(dvb_reactor_t *reactor, dvb_demux_t *context);
+	int dvb_reactor_run(dvb_reactor_t *reactor);
+
+	dvb_acquire_t *dvb_acquire_open(int adapter, int demux);
+	dvb_acquire_t *dvb_acquire_open_path(const char *path);
+	void dvb_acquire_close(dvb_acquire_t *acq);
+	int dvb_acquire_add(dvb_acquire_t *acq, struct dmx_sct_filter_params *filter);
+	void dvb_acquire_set_timeout(dvb_acquire_t *acq, time_t timeout);
+	int dvb_acquire_attach(dvb_acquire_t *acq, dvb_reactor_t *reactor, time_t until, dvb_callbacks_t *callbacks);
+	int dvb_acquire_complete(dvb_acquire_t *acq);
+	int dvb_acquire_run(dvb_acquire_t *acq, time_t until, dvb_callbacks_t *callbacks);
+
+	dvb_schedule_t *dvb_schedule_new(void);
+	void dvb_schedule_delete(dvb_schedule_t *schedule);
+	int dvb_schedule_expect(dvb_schedule_t *schedule, int onid, int tsid, int sid);
+	int dvb_schedule_add(dvb_schedule_t *schedule, dvb_section_t *section);
+	int dvb_schedule_complete(dvb_schedule_t *schedule);
+
+	dvb_ts_t *dvb_ts_new(const int *pids, size_t npids);
+	void dvb_ts_delete(dvb_ts_t *ts);
+	int dvb_ts_packet(dvb_ts_t *ts, const uint8_t *packet);
+	const uint8_t *dvb_ts_section(dvb_ts_t *ts, size_t *len);
+
+	uint32_t dvb_crc32(const uint8_t *data, size_t len);
 
 	int dvb_parse_si(dvb_table_t *table, dvb_callbacks_t *callbacks);
 
 	int dvb_parse_pat(dvb_table_t *table, dvb_callbacks_t *callbacks);
 	int dvb_parse_nit(dvb_table_t *table, dvb_callbacks_t *callbacks);
 	int dvb_parse_sdt(dvb_table_t *table, dvb_callbacks_t *callbacks);
+	int dvb_parse_eit(dvb_table_t *table, dvb_callbacks_t *callbacks);
 
 # ifdef __cplusplus
 };
@@ -1,3 +1,19 @@
+/*
+ * Copyright 2010 Mo McRoberts.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
 /* DVB Event Information Table */
 
 #include <stdio.h>
@@ -9,222 +25,167 @@
 #include <string.h>
 #include <unistd.h>
 
-#include "dvb.h"
+#include "p_dvb.h"
+
+static int parse_eit_event(service_t *svc, eit_t *eit, eit_event_t *evt, dvb_callbacks_t *callbacks);
+static int parse_eit_short_event_descriptor(event_t *event, struct descr_gen *descr);
 
-/* Parse an Event Information Table; invoked by parse_dvb_si() */
+/* Parse an Event Information Table (present/following or schedule), adding
+ * its events to the event store. An event already stored is only replaced
+ * by a newer version of the same kind of sub-table; the first sighting of an
+ * event in the other kind only records that sub-table's version.
+ */
 int
-parse_dvb_eit(void *data, size_t len, dvb_callbacks_t *callbacks)
+dvb_parse_eit(dvb_table_t *table, dvb_callbacks_t *callbacks)
 {
-	eit_t *e = data;
-	void *p;
-	struct tm dvb_time;
-	char date_strbuf[64], idbuf[256];
-	service_t *service;
-	event_t *ev;	
+	eit_t *eit;
+	service_t *svc;
+	unsigned char *p, *end;
+	size_t i;
 
-	/* Find the service this event is being broadcast on */
-	service = service_locate_dvb(HILO(e->original_network_id), HILO(e->transport_stream_id), HILO(e->service_id));
-	for (p = &e->data; p < data + len; p += EIT_EVENT_LEN + GetEITDescriptorsLoopLength(p))
+	for(i = 0; i < table->nsections; i++)
 	{
-		eit_event_t *evt = (void *) p;
-		parse_eit_event(service, evt, callbacks);
-	}
-		struct chninfo *c;
-		// find existing information?
-		for (c = channels; c != NULL; c = c->next) {
-			// found it
-			if (c->sid == HILO(e->service_id) && (c->eid == HILO(evt->event_id))) {
-				if (c->ver <= e->version_number) // seen it before or its older FIXME: wrap-around to 0
-					return 0;
-				else {
-					c->ver = e->version_number; // update outputted version
-					update_count++;
-					if (ignore_updates)
-						return 0;
-					break;
-				}
-			}
-		}
-
-		// its a new program
-		
-		sprintf(date_strbuf, "%s/%04x", get_channelident(HILO(e->service_id)), HILO(evt->event_id));
-		if(NULL == (ev = event_alloc(date_strbuf)))
+		if(!table->sections[i])
 		{
-			perror("error allocating new event");
-			return -1;
+			/* Absent from a segmented schedule */
+			continue;
 		}
-		event_set_service(ev, service);
-
-		if (c == NULL) {
-			chninfo_t *nc = malloc(sizeof(struct chninfo));
-			nc->sid = HILO(e->service_id);
-			nc->eid = HILO(evt->event_id);
-			nc->ver = e->version_number;
-			nc->next = channels;
-			channels = nc;
-		}
-
-		/* we have more data, refresh alarm */
-		if (timeout) alarm(timeout);
-
-		// No program info at end! Just skip it
-		if (GetEITDescriptorsLoopLength(evt) == 0)
-			return 0;
-
-		parseMJD(HILO(evt->mjd), &dvb_time);
-
-		dvb_time.tm_sec =  BcdCharToInt(evt->start_time_s);
-		dvb_time.tm_min =  BcdCharToInt(evt->start_time_m);
-		dvb_time.tm_hour = BcdCharToInt(evt->start_time_h) + time_offset;
-		time_t start_time = timegm(&dvb_time);
-
-		event_set_start(ev, start_time);
-		dvb_time.tm_sec  += BcdCharToInt(evt->duration_s);
-		dvb_time.tm_min  += BcdCharToInt(evt->duration_m);
-		dvb_time.tm_hour += BcdCharToInt(evt->duration_h);
-		time_t stop_time = timegm(&dvb_time);
-		event_set_duration(ev, stop_time - start_time);
-		time_t now;
-		time(&now);
-		// basic bad date check. if the program ends before this time yesterday, or two weeks from today, forget it.
-		if ((difftime(stop_time, now) < -24*60*60) || (difftime(now, stop_time) > 14*24*60*60) ) {
-			invalid_date_count++;
-			if (ignore_bad_dates)
-			{
-				event_free(ev);
-				return 0;
-			}
-		}
-
-		// a program must have a title that isn't empty
-		if (!validateDescription(&evt->data, GetEITDescriptorsLoopLength(evt))) {
-			event_free(ev);
+		eit = &(table->sections[i]->eit);
+		DBG(5, fprintf(stderr, "[dvb_parse_eit:%d: table_id=0x%02x, current_version=%02d]\n", (int) i, GetTableId(eit), eit->version_number));
+		if(!eit->current_next_indicator)
+		{
 			return 0;
 		}
-
-		programme_count++;
-		
-		strftime(date_strbuf, sizeof(date_strbuf), "%Y-%m-%dT%H:%M:%SZ", gmtime(&start_time));
-		
-		sprintf(idbuf, "dvb://%04x.%04x.%04x;%04x@%s--PT%02dH%02dM%02dS",
-				HILO(e->original_network_id),
-				HILO(e->transport_stream_id),
-				HILO(e->service_id),
-				HILO(evt->event_id),
-				date_strbuf,
-				BcdCharToInt(evt->duration_h),
-				BcdCharToInt(evt->duration_m),
-				BcdCharToInt(evt->duration_s));
-		event_set_transport_uri(ev, idbuf);
-
-		printf("<programme channel=\"%s\" ", get_channelident(HILO(e->service_id)));
-		strftime(date_strbuf, sizeof(date_strbuf), "start=\"%Y%m%d%H%M%S %z\"", localtime(&start_time) );
-		printf("%s ", date_strbuf);
-		strftime(date_strbuf, sizeof(date_strbuf), "stop=\"%Y%m%d%H%M%S %z\"", localtime(&stop_time));
-		printf("%s>\n ", date_strbuf);
-
-		//printf("\t<EventID>%i</EventID>\n", HILO(evt->event_id));
-		//printf("\t<RunningStatus>%i</RunningStatus>\n", evt->running_status);
-		//1 Airing, 2 Starts in a few seconds, 3 Pausing, 4 About to air
-
-		parseDescription(ev, &evt->data, GetEITDescriptorsLoopLength(evt));
-		printf("</programme>\n");
-		event_debug(ev);		
-		if(!event_pcrid(ev))
+		if(NULL == (svc = service_locate_add_dvb(HILO(eit->original_network_id), HILO(eit->transport_stream_id), HILO(eit->service_id))))
 		{
-			fprintf(stderr, "Event with no crid\n");
+			return -1;
 		}
-		if(callbacks->event)
+		p = (void *) eit;
+		end = p + GetSectionLength(p) + sizeof(si_tab_t) - 4;
+		for(p += EIT_LEN; p + EIT_EVENT_LEN <= end; p += EIT_EVENT_LEN + GetEITDescriptorsLoopLength(p))
 		{
-			callbacks->event(ev, callbacks->event_data);
+			if(p + EIT_EVENT_LEN + GetEITDescriptorsLoopLength(p) > end)
+			{
+				fprintf(stderr, "Warning: dvb_parse_eit: Event descriptors overrun the section\n");
+				break;
+			}
+			parse_eit_event(svc, eit, (void *) p, callbacks);
 		}
-		event_free(ev);
 	}
 	return 0;
 }
 
+/* Convert a Modified Julian Date and BCD-encoded time to a time_t */
+static time_t
+parse_eit_time(int mjd, int h, int m, int s)
+{
+	return ((time_t) mjd - 40587) * 86400 + BcdCharToInt(h) * 3600 + BcdCharToInt(m) * 60 + BcdCharToInt(s);
+}
+
 static int
-parse_eit_event(service_t *svc, eit_t *eit, eit_event_t *evt, size_t len, dvb_callbacks_t *callbacks)
+parse_eit_event(service_t *svc, eit_t *eit, eit_event_t *evt, dvb_callbacks_t *callbacks)
 {
-	char identifier[64];
+	char uri[128], date[32];
 	event_t *event;
-	char *p, *d;
-
-	if(!GetEITDescriptorsLoopLength(evt))
+	time_t start, duration;
+	struct tm tm;
+	unsigned char *p, *end;
+	struct descr_gen *descr;
+	int table_id, version, delta;
+
+	table_id = GetTableId(eit);
+	if((event = event_locate_dvb(svc, HILO(evt->event_id))))
 	{
-		/* No descriptors, ignore this entry */
-		return 0;
-	}
-	if(validate_eit_event(&evt->data, GetEITDescriptorsLoopLength(evt)) == -1)
-	{
-		/* We can't (or have decided not to) deal with this entry */
-		return 0;
-	}
-	/* Determine the start and end times of the event */
-	parseMJD(HILO(evt->mjd), &dvb_time);
-	
-	dvb_time.tm_sec =  BcdCharToInt(evt->start_time_s);
-	dvb_time.tm_min =  BcdCharToInt(evt->start_time_m);
-	dvb_time.tm_hour = BcdCharToInt(evt->start_time_h) + time_offset;
-	time_t start_time = timegm(&dvb_time);
-	
-	event_set_start(ev, start_time);
-	dvb_time.tm_sec  += BcdCharToInt(evt->duration_s);
-	dvb_time.tm_min  += BcdCharToInt(evt->duration_m);
-	dvb_time.tm_hour += BcdCharToInt(evt->duration_h);
-	time_t stop_time = timegm(&dvb_time);
-	event_set_duration(ev, stop_time - start_time);
-	time_t now;
-	time(&now);
-	if((difftime(stop_time, now) < -24*60*60) || (difftime(now, stop_time) > 14*24*60*60))
-	{
-		/* Event ends before this time yesterday, or more than two weeks in the future */
-		return 0;
-	}
-	snprintf(identifier, sizeof(identifier), "%04x.%04x.%04x;%04x",
-			 HILO(eit->original_network_id),
-			 HILO(eit->transport_stream_id),
-			 HILO(eit->service_id),
-			 HILO(eit->event_id));
-	if((event = event_locate(identifier)))
-	{
-		if(event_version(event) >= evt->version_number)
+		if(-1 == (version = event_version(event, table_id)))
+		{
+			/* Already described by the other kind of sub-table */
+			event_set_version(event, table_id, eit->version_number);
+			return 0;
+		}
+		/* version_number is five bits wide: a version is newer if it is up
+		 * to 15 steps ahead (modulo 32)
+		 */
+		delta = (eit->version_number - version) & 0x1f;
+		if(delta == 0 || delta > 15)
 		{
+			/* Already up to date, or stale */
 			return 0;
 		}
+	}
+	start = parse_eit_time(HILO(evt->mjd), evt->start_time_h, evt->start_time_m, evt->start_time_s);
+	duration = parse_eit_time(40587, evt->duration_h, evt->duration_m, evt->duration_s);
+	if(event)
+	{
+		DBG(7, fprintf(stderr, "[parse_eit_event: %s is now version %d]\n", event_identifier(event), eit->version_number));
 		event_reset(event);
 	}
-	else
+	else if(NULL == (event = event_add_dvb(svc, HILO(evt->event_id))))
 	{
-		event = event_add(identifier);
+		return -1;
 	}
-	/* Set the associated service */
-	event_set_service(event, service);
-	/* Set the event version */
-	event_set_version(event, evt->version_number);
-	/* Set the dvb: URI for the event */
-	strftime(date_strbuf, sizeof(date_strbuf), "%Y-%m-%dT%H:%M:%SZ", gmtime(&start_time));	
-	snprintf(identifier, sizeof(identifier), "dvb://%04x.%04x.%04x;%04x@%s--PT%02dH%02dM%02dS",
-			HILO(eit->original_network_id),
-			HILO(eit->transport_stream_id),
-			HILO(eit->service_id),
-			HILO(evt->event_id),
-			date_strbuf,
-			BcdCharToInt(evt->duration_h),
-			BcdCharToInt(evt->duration_m),
-			BcdCharToInt(evt->duration_s));
-	event_set_transport_uri(ev, idbuf);
-	/* Parse the event descriptors */
-	p = (void *) evt;
-	for(d = p; d < p + len; d += DESCR_GEN_LEN + GetDescriptorLength(d))
+	event_set_version(event, table_id, eit->version_number);
+	event_set_start(event, start);
+	event_set_duration(event, duration);
+	gmtime_r(&start, &tm);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &tm);
+	snprintf(uri, sizeof(uri), "%s;%04x@%s--PT%02dH%02dM%02dS",
+			 service_uri(svc), HILO(evt->event_id), date,
+			 BcdCharToInt(evt->duration_h), BcdCharToInt(evt->duration_m), BcdCharToInt(evt->duration_s));
+	event_set_transport_uri(event, uri);
+	p = evt->data;
+	end = p + GetEITDescriptorsLoopLength(evt);
+	while(p + DESCR_GEN_LEN <= end && p + DESCR_GEN_LEN + GetDescriptorLength(p) <= end)
 	{
-		descr = (void *) d;
+		descr = (void *) p;
+		p += DESCR_GEN_LEN + GetDescriptorLength(p);
 		switch(GetDescriptorTag(descr))
 		{
+		case 0x4d:
+			parse_eit_short_event_descriptor(event, descr);
+			break;
 		default:
-			fprintf(stderr, "Warning: parse_eit_event: Unknown EIT event descriptor 0x%02x (len=%d)\n",
-					GetDescriptorTag(descr), (int) GetDescriptorLength(descr));
+			DBG(9, fprintf(stderr, "[parse_eit_event: Skipped EIT descriptor 0x%02x (len=%d)]\n",
+						   GetDescriptorTag(descr), (int) GetDescriptorLength(descr)));
 		}
 	}
+	dvb_callbacks_event(callbacks, event);
+	return 0;
+}
+
+/* The short_event_descriptor carries the event's name and a short
+ * description in a single language
+ */
+static int
+parse_eit_short_event_descriptor(event_t *event, struct descr_gen *descr)
+{
+	descr_short_event_t *d = (void *) descr;
+	char lang[4], buf[256];
+	unsigned char *p;
+	unsigned char l;
+
+	if(GetDescriptorLength(d) < DESCR_SHORT_EVENT_LEN - DESCR_GEN_LEN + 1 ||
+	   d->event_name_length > GetDescriptorLength(d) - (DESCR_SHORT_EVENT_LEN - DESCR_GEN_LEN) - 1)
+	{
+		fprintf(stderr, "Warning: parse_eit_short_event_descriptor: Malformed short_event_descriptor (len=%d)\n", (int) GetDescriptorLength(d));
+		return -1;
+	}
+	lang[0] = d->lang_code1;
+	lang[1] = d->lang_code2;
+	lang[2] = d->lang_code3;
+	lang[3] = 0;
+	p = d->data;
+	strncpy(buf, (const char *) p, d->event_name_length);
+	buf[d->event_name_length] = 0;
+	event_set_title(event, buf, lang);
+	p += d->event_name_length;
+	l = *p;
+	p++;
+	if(l > GetDescriptorLength(d) - (DESCR_SHORT_EVENT_LEN - DESCR_GEN_LEN) - 1 - d->event_name_length)
+	{
+		l = GetDescriptorLength(d) - (DESCR_SHORT_EVENT_LEN - DESCR_GEN_LEN) - 1 - d->event_name_length;
+	}
+	strncpy(buf, (const char *) p, l);
+	buf[l] = 0;
+	event_set_subtitle(event, buf, lang);
+	return 0;
 }
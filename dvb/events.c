@@ -16,63 +16,425 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
 #include <sys/time.h>
 #include <time.h>
 
 #include "events.h"
+#include "hash.h"
 
-#define EVENT_ID_SIZE                   64
+/* Size of the chunks from which event strings are allocated: a pool's first
+ * chunk is small, so that an event which isn't in the store doesn't cost a
+ * full chunk, and each chunk after it is twice the size of the last
+ */
+#define EVENT_CHUNK_MIN                 256
+#define EVENT_CHUNK_SIZE                16384
+
+#define EVENT_POOL_ALIGN(size)          (((size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
 
+typedef struct event_index_struct event_index_t;
+typedef struct event_pool_struct event_pool_t;
+typedef struct event_chunk_struct event_chunk_t;
+
+/* Events added with event_add_dvb() are held in a store keyed by service and
+ * event_id, and each service's events are also kept in order of their start
+ * times so that its schedule can be walked, and now/next found, without
+ * having to search.
+ *
+ * An event is a small fixed-size header: its strings, titles and the arrays
+ * listing them are carved from a pool shared by all of the events of the
+ * same service (an event which isn't in the store has a pool of its own).
+ * Only language codes, of which there are few, are interned.
+ * Strings which are replaced are simply abandoned, and the pool is compacted
+ * by event_expire() once more than half of it is unused.
+ */
 struct event_struct
 {
-	char identifier[EVENT_ID_SIZE];
-	char transport_uri[128];
-	char pcrid[128];
-	char scrid[128];
-	char lang[8];
-	time_t start;
-	time_t duration;
-	size_t ntitle;
+	const char *identifier;
+	const char *transport_uri;
+	const char *pcrid;
+	const char *scrid;
 	event_langstr_t **title;
-	size_t nsubtitle;
 	event_langstr_t **subtitle;
-	event_audio_t audio;
-	event_aspect_t aspect;
+	event_langstr_t **description;
 	service_t *service;
+	/* The service's index, if the event is in the store */
+	event_index_t *index;
+	event_pool_t *pool;
 	void *data;
+	time_t start;
+	int32_t duration;
+	int32_t event_id;
+	/* The version of the present/following and of the schedule sub-table
+	 * the event was last seen in, or -1 if it hasn't been seen in one
+	 */
+	int8_t version[2];
+	uint8_t ntitle;
+	uint8_t nsubtitle;
+	uint8_t ndescription;
+	uint8_t audio;
+	uint8_t aspect;
+	/* Packed by lang_pack() */
+	uint32_t lang;
+	/* Interned */
+	const char *channel;
+	/* Arrays carved from the pool, in the order their items were added; the
+	 * language codes in them are interned
+	 */
+	uint8_t *categories;
+	uint8_t *ratings;
+	const char **languages;
+	const char **subtitling;
+	event_crid_t *crids;
+	event_descriptor_t *unknown;
+	uint8_t ncategories;
+	uint8_t nratings;
+	uint8_t nlanguages;
+	uint8_t nsubtitling;
+	uint8_t ncrids;
+	uint8_t nunknown;
+};
+
+struct event_chunk_struct
+{
+	event_chunk_t *next;
+	size_t size;
+	char data[];
+};
+
+struct event_pool_struct
+{
+	event_chunk_t *chunks;
+	char *cur;
+	size_t left;
+	/* Bytes handed out, and how many of those have since been abandoned */
+	size_t used;
+	size_t dead;
+};
+
+/* The events belonging to a single service, ordered by start time */
+struct event_index_struct
+{
+	service_t *service;
+	size_t nevents;
+	size_t alloc;
+	event_t **events;
+	event_pool_t pool;
 };
 
-static event_langstr_t *event_set_langstr(event_langstr_t ***list, size_t *count, const char *lang, const char *str);
-static event_langstr_t *event_locate_langstr(event_langstr_t **list, size_t count, const char *lang);
+static dvb_hash_t indexes;
+static dvb_hash_t store;
+
+static event_t *event_init(event_t *event, event_pool_t *pool, const char *identifier);
+static event_langstr_t *event_set_langstr(event_pool_t *pool, event_langstr_t ***list, uint8_t *count, const char *lang, const char *str);
+static event_langstr_t *event_locate_langstr(event_langstr_t **list, size_t count, uint32_t code);
+static void event_free_langstr(event_pool_t *pool, event_langstr_t ***list, uint8_t *count);
+static void *event_append(event_pool_t *pool, void *list, uint8_t *count, size_t size, const void *item);
+static void event_free_strings(event_t *event);
+static void *event_pool_alloc(event_pool_t *pool, size_t size);
+static void event_pool_discard(event_pool_t *pool, size_t size);
+static const char *event_pool_strdup(event_pool_t *pool, const char *str);
+static void event_pool_strfree(event_pool_t *pool, const char *str);
+static void event_pool_release(event_pool_t *pool);
+static const char *event_pool_move(event_pool_t *to, const char *str, size_t *need);
+static event_langstr_t **event_pool_move_langstr(event_pool_t *to, event_langstr_t **list, uint8_t *count, size_t *need);
+static void *event_pool_move_array(event_pool_t *to, void *list, size_t size, size_t *need);
+static void event_pool_compact(event_index_t *index);
+static event_index_t *event_index(service_t *service, int create);
+static size_t event_index_position(event_index_t *index, time_t start);
+static int event_index_insert(event_index_t *index, event_t *event);
+static void event_index_remove(event_index_t *index, event_t *event);
+static event_t *event_store_find(service_t *service, int event_id);
+static int event_store_insert(event_t *event);
+static void event_store_remove(event_t *event);
 
 event_t *
 event_alloc(const char *identifier)  
 {
 	event_t *p;
 
-	if(strlen(identifier) >= EVENT_ID_SIZE)
+	/* The event's private pool immediately follows it */
+	if(NULL == (p = (event_t *) calloc(1, sizeof(event_t) + sizeof(event_pool_t))))
 	{
-		errno = EINVAL;
 		return NULL;
 	}
-	if(NULL == (p = (event_t *) calloc(1, sizeof(event_t))))
+	if(!event_init(p, (event_pool_t *) (p + 1), identifier))
 	{
+		free(p);
 		return NULL;
 	}
-	strcpy(p->identifier, identifier);
-	p->audio = EA_INVALID;
-	p->aspect = EA_INVALID;
 	return p;
 }
 
+static event_t *
+event_init(event_t *event, event_pool_t *pool, const char *identifier)
+{
+	event->pool = pool;
+	if(identifier && identifier[0] && NULL == (event->identifier = event_pool_strdup(pool, identifier)))
+	{
+		return NULL;
+	}
+	event->audio = EA_INVALID;
+	event->aspect = EA_INVALID;
+	event->version[0] = event->version[1] = -1;
+	return event;
+}
+
+/* Free an event, first removing it from the store if it was added to it */
 void
 event_free(event_t *event)
 {
+	if(event->index)
+	{
+		event_store_remove(event);
+		event_index_remove(event->index, event);
+	}
+	if(event->pool == (event_pool_t *) (event + 1))
+	{
+		/* Allocated by event_alloc(), with a pool of its own */
+		event_pool_release(event->pool);
+	}
+	else
+	{
+		event_free_strings(event);
+		event_pool_strfree(event->pool, event->identifier);
+	}
 	free(event);
 }
 
+/* Add an event to the store, or if the service already has an event with
+ * this event_id, reset and return that instead.
+ */
+event_t *
+event_add_dvb(service_t *service, int event_id)
+{
+	event_index_t *index;
+	event_t *p;
+	const char *uri;
+	char *identifier;
+	size_t len;
+
+	if((p = event_store_find(service, event_id)))
+	{
+		event_reset(p);
+		return p;
+	}
+	if(NULL == (index = event_index(service, 1)))
+	{
+		return NULL;
+	}
+	if(NULL == (p = (event_t *) calloc(1, sizeof(event_t))))
+	{
+		return NULL;
+	}
+	event_init(p, &(index->pool), NULL);
+	uri = service_uri(service);
+	len = strlen(uri) + 6;
+	if(NULL == (identifier = (char *) event_pool_alloc(p->pool, len)))
+	{
+		free(p);
+		return NULL;
+	}
+	snprintf(identifier, len, "%s;%04x", uri, event_id);
+	p->identifier = identifier;
+	p->event_id = event_id;
+	p->service = service;
+	if(event_store_insert(p))
+	{
+		event_free(p);
+		return NULL;
+	}
+	if(event_index_insert(index, p))
+	{
+		event_store_remove(p);
+		event_free(p);
+		return NULL;
+	}
+	p->index = index;
+	return p;
+}
+
+event_t *
+event_locate_dvb(service_t *service, int event_id)
+{
+	return event_store_find(service, event_id);
+}
+
+/* Discard the descriptive information held about an event, keeping only its
+ * identity, version, times and associated data, so that it can be
+ * re-populated from a newer version of its EIT.
+ */
+void
+event_reset(event_t *event)
+{
+	event_free_strings(event);
+	event->lang = 0;
+	event->audio = EA_INVALID;
+	event->aspect = EA_INVALID;
+}
+
+/* Abandon everything an event holds in its pool except its identifier */
+static void
+event_free_strings(event_t *event)
+{
+	size_t i;
+
+	event_free_langstr(event->pool, &(event->title), &(event->ntitle));
+	event_free_langstr(event->pool, &(event->subtitle), &(event->nsubtitle));
+	event_free_langstr(event->pool, &(event->description), &(event->ndescription));
+	event_pool_strfree(event->pool, event->transport_uri);
+	event_pool_strfree(event->pool, event->pcrid);
+	event_pool_strfree(event->pool, event->scrid);
+	event->transport_uri = NULL;
+	event->pcrid = NULL;
+	event->scrid = NULL;
+	event->channel = NULL;
+	for(i = 0; i < event->ncrids; i++)
+	{
+		event_pool_strfree(event->pool, event->crids[i].crid);
+	}
+	event_pool_discard(event->pool, sizeof(event_crid_t) * event->ncrids);
+	event_pool_discard(event->pool, sizeof(uint8_t) * event->ncategories);
+	event_pool_discard(event->pool, sizeof(uint8_t) * event->nratings);
+	event_pool_discard(event->pool, sizeof(const char *) * event->nlanguages);
+	event_pool_discard(event->pool, sizeof(const char *) * event->nsubtitling);
+	event_pool_discard(event->pool, sizeof(event_descriptor_t) * event->nunknown);
+	event->crids = NULL;
+	event->categories = event->ratings = NULL;
+	event->languages = event->subtitling = NULL;
+	event->unknown = NULL;
+	event->ncrids = event->ncategories = event->nratings = 0;
+	event->nlanguages = event->nsubtitling = event->nunknown = 0;
+}
+
+int
+event_id(event_t *event)
+{
+	return event->event_id;
+}
+
+/* The present/following (0x4E, 0x4F) and schedule (0x50 to 0x6F) tables are
+ * independent sub-tables, each with versions of its own, and an event may be
+ * carried in both: a version is recorded for each.
+ */
+void
+event_set_version(event_t *event, int table_id, int version)
+{
+	event->version[table_id >= 0x50] = version;
+}
+
+/* Return the version of the sub-table of the kind table_id belongs to which
+ * the event was last seen in, or -1
+ */
+int
+event_version(event_t *event, int table_id)
+{
+	return event->version[table_id >= 0x50];
+}
+
+/* Free every stored event which finished at or before 'when', returning the
+ * number freed
+ */
+size_t
+event_expire(time_t when)
+{
+	event_index_t *index;
+	event_t *event;
+	size_t i, j, k, count;
+
+	count = 0;
+	for(i = 0; i < indexes.size; i++)
+	{
+		if(!(index = (event_index_t *) indexes.slots[i]))
+		{
+			continue;
+		}
+		for(j = k = 0; j < index->nevents; j++)
+		{
+			event = index->events[j];
+			if(event->start < when && event->start + event->duration <= when)
+			{
+				event_store_remove(event);
+				event->index = NULL;
+				event_free(event);
+				count++;
+				continue;
+			}
+			if(event->start >= when)
+			{
+				/* Everything after this starts later */
+				memmove(&(index->events[k]), &(index->events[j]), sizeof(event_t *) * (index->nevents - j));
+				k += index->nevents - j;
+				break;
+			}
+			index->events[k] = event;
+			k++;
+		}
+		index->nevents = k;
+		if(index->pool.dead > index->pool.used / 2 && index->pool.dead > EVENT_CHUNK_SIZE)
+		{
+			event_pool_compact(index);
+		}
+	}
+	return count;
+}
+
+/* Return the event being broadcast on a service at a given time */
+event_t *
+event_at(service_t *service, time_t when)
+{
+	event_index_t *index;
+	size_t i;
+
+	if(NULL == (index = event_index(service, 0)))
+	{
+		return NULL;
+	}
+	/* The last event to have started by 'when' */
+	i = event_index_position(index, when + 1);
+	if(i && index->events[i - 1]->start + index->events[i - 1]->duration > when)
+	{
+		return index->events[i - 1];
+	}
+	return NULL;
+}
+
+/* Return the first event on a service starting after a given time */
+event_t *
+event_after(service_t *service, time_t when)
+{
+	event_index_t *index;
+	size_t i;
+
+	if(NULL == (index = event_index(service, 0)))
+	{
+		return NULL;
+	}
+	i = event_index_position(index, when + 1);
+	if(i < index->nevents)
+	{
+		return index->events[i];
+	}
+	return NULL;
+}
+
+/* Return a service's stored events, in order of their start times */
+event_t **
+event_schedule(service_t *service, size_t *count)
+{
+	event_index_t *index;
+
+	if(NULL == (index = event_index(service, 0)))
+	{
+		*count = 0;
+		return NULL;
+	}
+	*count = index->nevents;
+	return index->events;
+}
+
 const char *
 event_identifier(event_t *event)
 {
@@ -82,15 +444,15 @@ event_identifier(event_t *event)
 void
 event_set_lang(event_t *event, const char *lang)
 {
-	strncpy(event->lang, lang, sizeof(event->lang) - 1);
+	event->lang = lang_pack(lang);
 }
 
 const char *
 event_lang(event_t *event)
 {
-	if(event->lang[0])
+	if(event->lang)
 	{
-		return event->lang;
+		return lang_unpack(event->lang);
 	}
 	return NULL;
 }
@@ -98,7 +460,7 @@ event_lang(event_t *event)
 void
 event_set_title(event_t *event, const char *title, const char *lang)
 {
-	event_set_langstr(&(event->title), &(event->ntitle), lang, title);
+	event_set_langstr(event->pool, &(event->title), &(event->ntitle), lang, title);
 }
 
 const char *
@@ -106,7 +468,7 @@ event_title(event_t *event, const char *lang)
 {
 	event_langstr_t *p;
 	
-	if(NULL == (p = event_locate_langstr(event->title, event->ntitle, lang)))
+	if(NULL == (p = event_locate_langstr(event->title, event->ntitle, lang_pack(lang))))
 	{
 		return NULL;
 	}
@@ -123,7 +485,7 @@ event_titles(event_t *event, size_t *ntitles)
 void
 event_set_subtitle(event_t *event, const char *title, const char *lang)
 {
-	event_set_langstr(&(event->subtitle), &(event->nsubtitle), lang, title);
+	event_set_langstr(event->pool, &(event->subtitle), &(event->nsubtitle), lang, title);
 }
 
 const char *
@@ -131,7 +493,7 @@ event_subtitle(event_t *event, const char *lang)
 {
 	event_langstr_t *p;
 	
-	if(NULL == (p = event_locate_langstr(event->subtitle, event->ntitle, lang)))
+	if(NULL == (p = event_locate_langstr(event->subtitle, event->nsubtitle, lang_pack(lang))))
 	{
 		return NULL;
 	}
@@ -145,6 +507,31 @@ event_subtitles(event_t *event, size_t *ntitles)
 	return (const event_langstr_t **) event->subtitle;
 }
 
+void
+event_set_description(event_t *event, const char *description, const char *lang)
+{
+	event_set_langstr(event->pool, &(event->description), &(event->ndescription), lang, description);
+}
+
+const char *
+event_description(event_t *event, const char *lang)
+{
+	event_langstr_t *p;
+	
+	if(NULL == (p = event_locate_langstr(event->description, event->ndescription, lang_pack(lang))))
+	{
+		return NULL;
+	}
+	return p->str;
+}
+
+const event_langstr_t **
+event_descriptions(event_t *event, size_t *ndescriptions)
+{
+	*ndescriptions = event->ndescription;
+	return (const event_langstr_t **) event->description;
+}
+
 
 void
 event_set_aspect(event_t *event, event_aspect_t aspect)
@@ -170,10 +557,154 @@ event_audio(event_t *event)
 	return event->audio;
 }
 
+void
+event_set_channel(event_t *event, const char *channel)
+{
+	event->channel = (channel && channel[0] ? intern_str(channel) : NULL);
+}
+
+const char *
+event_channel(event_t *event)
+{
+	return event->channel;
+}
+
+void
+event_add_category(event_t *event, int category)
+{
+	uint8_t c = category;
+	void *p;
+
+	if((p = event_append(event->pool, event->categories, &(event->ncategories), sizeof(uint8_t), &c)))
+	{
+		event->categories = (uint8_t *) p;
+	}
+}
+
+const uint8_t *
+event_categories(event_t *event, size_t *ncategories)
+{
+	*ncategories = event->ncategories;
+	return event->categories;
+}
+
+void
+event_add_rating(event_t *event, int rating)
+{
+	uint8_t r = rating;
+	void *p;
+
+	if((p = event_append(event->pool, event->ratings, &(event->nratings), sizeof(uint8_t), &r)))
+	{
+		event->ratings = (uint8_t *) p;
+	}
+}
+
+const uint8_t *
+event_ratings(event_t *event, size_t *nratings)
+{
+	*nratings = event->nratings;
+	return event->ratings;
+}
+
+void
+event_add_language(event_t *event, const char *lang)
+{
+	void *p;
+
+	if(NULL == (lang = intern_str(lang)))
+	{
+		return;
+	}
+	if((p = event_append(event->pool, event->languages, &(event->nlanguages), sizeof(const char *), &lang)))
+	{
+		event->languages = (const char **) p;
+	}
+}
+
+const char **
+event_languages(event_t *event, size_t *nlanguages)
+{
+	*nlanguages = event->nlanguages;
+	return event->languages;
+}
+
+void
+event_add_subtitling(event_t *event, const char *lang)
+{
+	void *p;
+
+	if(NULL == (lang = intern_str(lang)))
+	{
+		return;
+	}
+	if((p = event_append(event->pool, event->subtitling, &(event->nsubtitling), sizeof(const char *), &lang)))
+	{
+		event->subtitling = (const char **) p;
+	}
+}
+
+const char **
+event_subtitling(event_t *event, size_t *nsubtitling)
+{
+	*nsubtitling = event->nsubtitling;
+	return event->subtitling;
+}
+
+void
+event_add_crid(event_t *event, int type, const char *crid)
+{
+	event_crid_t c;
+	void *p;
+
+	c.type = type;
+	if(NULL == (c.crid = event_pool_strdup(event->pool, crid)))
+	{
+		return;
+	}
+	if((p = event_append(event->pool, event->crids, &(event->ncrids), sizeof(event_crid_t), &c)))
+	{
+		event->crids = (event_crid_t *) p;
+	}
+	else
+	{
+		event_pool_strfree(event->pool, c.crid);
+	}
+}
+
+const event_crid_t *
+event_crids(event_t *event, size_t *ncrids)
+{
+	*ncrids = event->ncrids;
+	return event->crids;
+}
+
+void
+event_add_unknown(event_t *event, int tag, int length)
+{
+	event_descriptor_t d;
+	void *p;
+
+	d.tag = tag;
+	d.length = length;
+	if((p = event_append(event->pool, event->unknown, &(event->nunknown), sizeof(event_descriptor_t), &d)))
+	{
+		event->unknown = (event_descriptor_t *) p;
+	}
+}
+
+const event_descriptor_t *
+event_unknown(event_t *event, size_t *nunknown)
+{
+	*nunknown = event->nunknown;
+	return event->unknown;
+}
+
 void
 event_set_pcrid(event_t *event, const char *pcrid)
 {
-	strncpy(event->pcrid, pcrid, sizeof(event->pcrid) - 1);
+	event_pool_strfree(event->pool, event->pcrid);
+	event->pcrid = event_pool_strdup(event->pool, pcrid);
 }
 
 size_t
@@ -181,7 +712,7 @@ event_qual_pcrid(event_t *event, char *buf, size_t buflen)
 {	
 	const char *authority;
 
-	if(!event->pcrid[0])
+	if(!event->pcrid)
 	{
 		*buf = 0;
 		return 0;
@@ -202,43 +733,33 @@ event_qual_pcrid(event_t *event, char *buf, size_t buflen)
 const char *
 event_pcrid(event_t *event)
 {
-	if(event->pcrid[0])
-	{
-		return event->pcrid;
-	}
-	return NULL;
+	return event->pcrid;
 }
 
 void
 event_set_scrid(event_t *event, const char *scrid)
 {
-	strncpy(event->scrid, scrid, sizeof(event->scrid) - 1);
+	event_pool_strfree(event->pool, event->scrid);
+	event->scrid = event_pool_strdup(event->pool, scrid);
 }
 
 const char *
 event_scrid(event_t *event)
 {
-	if(event->scrid[0])
-	{
-		return event->scrid;
-	}
-	return NULL;
+	return event->scrid;
 }
 
 void
 event_set_transport_uri(event_t *event, const char *transport_uri)
 {
-	strncpy(event->transport_uri, transport_uri, sizeof(event->transport_uri) - 1);
+	event_pool_strfree(event->pool, event->transport_uri);
+	event->transport_uri = event_pool_strdup(event->pool, transport_uri);
 }
 
 const char *
 event_transport_uri(event_t *event)
 {
-	if(event->transport_uri[0])
-	{
-		return event->transport_uri;
-	}
-	return NULL;
+	return event->transport_uri;
 }
 
 void
@@ -256,6 +777,18 @@ event_service(event_t *event)
 void
 event_set_start(event_t *event, time_t start)
 {
+	if(event->index && start != event->start)
+	{
+		/* Move the event to its new position in the schedule */
+		event_index_remove(event->index, event);
+		event->start = start;
+		if(event_index_insert(event->index, event))
+		{
+			event_store_remove(event);
+			event->index = NULL;
+		}
+		return;
+	}
 	event->start = start;
 }
 
@@ -302,7 +835,7 @@ event_debug(event_t *event)
 	struct tm *tm;
 	size_t i;
 
-	fprintf(stderr, " - Event identifier='%s', transport URI='%s'\n", event->identifier, event->transport_uri);
+	fprintf(stderr, " - Event identifier='%s', transport URI='%s'\n", (event->identifier ? event->identifier : ""), (event->transport_uri ? event->transport_uri : ""));
 	if(event->start)
 	{
 		tm = gmtime(&event->start);
@@ -313,12 +846,12 @@ event_debug(event_t *event)
 	{
 		fprintf(stderr, "   Service: %s\n", service_uri(event->service));
 	}
-	if(event->pcrid[0])
+	if(event->pcrid)
 	{
 		event_qual_pcrid(event, buf, sizeof(buf));
 		fprintf(stderr, "   pCrid: %s\n", buf);
 	}
-	if(event->scrid[0])
+	if(event->scrid)
 	{
 		fprintf(stderr, "   sCrid: %s\n", event->scrid);
 	}	
@@ -333,30 +866,42 @@ event_debug(event_t *event)
 	{
 		if(event->subtitle[i])
 		{
-			fprintf(stderr, "   Sub-title[%s]='%s'\n", event->title[i]->lang, event->title[i]->str);
+			fprintf(stderr, "   Sub-title[%s]='%s'\n", event->subtitle[i]->lang, event->subtitle[i]->str);
+		}
+	}
+	for(i = 0; i < event->ndescription; i++)
+	{
+		if(event->description[i])
+		{
+			fprintf(stderr, "   Description[%s]='%s'\n", event->description[i]->lang, event->description[i]->str);
 		}
 	}
 }
 
+/* Set the string for a language in a list, replacing any existing string;
+ * an empty or NULL string removes it. The list and its entries belong to the
+ * pool, as do the strings themselves: a list which has to grow is copied,
+ * and the old one abandoned.
+ */
 static event_langstr_t *
-event_set_langstr(event_langstr_t ***list, size_t *count, const char *lang, const char *str)
+event_set_langstr(event_pool_t *pool, event_langstr_t ***list, uint8_t *count, const char *lang, const char *str)
 {
 	event_langstr_t *p, **q;
+	uint32_t code;
 	size_t i;
 	ssize_t ff;
 
+	code = lang_pack(lang);
 	if(str && str[0])
 	{
-		if(NULL == (p = (event_langstr_t *) calloc(1, sizeof(event_langstr_t) + strlen(str) + 1)))
+		if(NULL == (str = event_pool_strdup(pool, str)))
 		{
 			return NULL;
 		}
-		strncpy(p->lang, lang, sizeof(p->lang) - 1);
-		strcpy(p->str, str);
 	}
 	else
 	{
-		p = NULL;
+		str = NULL;
 	}
 	ff = -1;
 	for(i = 0; i < *count; i++)
@@ -365,28 +910,52 @@ event_set_langstr(event_langstr_t ***list, size_t *count, const char *lang, cons
 		{
 			ff = i;
 		}
-		else if(!strcmp((*list)[i]->lang, lang))
+		else if((*list)[i]->code == code)
 		{
-			free((*list)[i]);
-			(*list)[i] = p;
-			return p;
+			event_pool_strfree(pool, (*list)[i]->str);
+			if(!str)
+			{
+				event_pool_discard(pool, sizeof(event_langstr_t));
+				(*list)[i] = NULL;
+				return NULL;
+			}
+			(*list)[i]->str = str;
+			return (*list)[i];
 		}
 	}
-	if(!p)
+	if(!str)
 	{
 		/* Nothing to do */
 		return NULL;
 	}
+	if(NULL == (p = (event_langstr_t *) event_pool_alloc(pool, sizeof(event_langstr_t))) ||
+	   NULL == (p->lang = lang_unpack(code)))
+	{
+		if(p)
+		{
+			event_pool_discard(pool, sizeof(event_langstr_t));
+		}
+		event_pool_strfree(pool, str);
+		return NULL;
+	}
+	p->code = code;
+	p->str = str;
 	if(ff != -1)
 	{
 		(*list)[ff] = p;
 		return p;
 	}
-	if(NULL == (q = (event_langstr_t **) realloc(*list, sizeof(event_langstr_t *) * ((*count) + 1))))
+	if(*count == UINT8_MAX || NULL == (q = (event_langstr_t **) event_pool_alloc(pool, sizeof(event_langstr_t *) * ((*count) + 1))))
 	{
-		free(p);
+		event_pool_discard(pool, sizeof(event_langstr_t));
+		event_pool_strfree(pool, str);
 		return NULL;
 	}
+	if(*count)
+	{
+		memcpy(q, *list, sizeof(event_langstr_t *) * (*count));
+		event_pool_discard(pool, sizeof(event_langstr_t *) * (*count));
+	}
 	*list = q;
 	q[*count] = p;
 	(*count)++;
@@ -394,13 +963,13 @@ event_set_langstr(event_langstr_t ***list, size_t *count, const char *lang, cons
 }
 
 static event_langstr_t *
-event_locate_langstr(event_langstr_t **list, size_t count, const char *lang)
+event_locate_langstr(event_langstr_t **list, size_t count, uint32_t code)
 {
 	size_t i;
 	
 	for(i = 0; i < count; i++)
 	{
-		if(list[i] && !strcmp(list[i]->lang, lang))
+		if(list[i] && list[i]->code == code)
 		{
 			return list[i];
 		}
@@ -408,4 +977,430 @@ event_locate_langstr(event_langstr_t **list, size_t count, const char *lang)
 	return NULL;
 }
 
+static void
+event_free_langstr(event_pool_t *pool, event_langstr_t ***list, uint8_t *count)
+{
+	size_t i;
+
+	for(i = 0; i < *count; i++)
+	{
+		if((*list)[i])
+		{
+			event_pool_strfree(pool, (*list)[i]->str);
+			event_pool_discard(pool, sizeof(event_langstr_t));
+		}
+	}
+	if(*count)
+	{
+		event_pool_discard(pool, sizeof(event_langstr_t *) * (*count));
+	}
+	*list = NULL;
+	*count = 0;
+}
+
+/* Append an item of 'size' bytes to an array belonging to the pool,
+ * returning the new array, or NULL if it couldn't be added (in which case
+ * the old array is left as it was). As with the lists of strings, the array
+ * is copied, and the old one abandoned.
+ */
+static void *
+event_append(event_pool_t *pool, void *list, uint8_t *count, size_t size, const void *item)
+{
+	char *q;
+
+	if(*count == UINT8_MAX || NULL == (q = (char *) event_pool_alloc(pool, size * ((*count) + 1))))
+	{
+		return NULL;
+	}
+	if(*count)
+	{
+		memcpy(q, list, size * (*count));
+		event_pool_discard(pool, size * (*count));
+	}
+	memcpy(q + size * (*count), item, size);
+	(*count)++;
+	return q;
+}
+
+/* Allocate from a pool; the result is aligned for a pointer */
+static void *
+event_pool_alloc(event_pool_t *pool, size_t size)
+{
+	event_chunk_t *chunk;
+	size_t csize;
+	void *p;
+
+	size = EVENT_POOL_ALIGN(size);
+	if(pool->left < size)
+	{
+		csize = EVENT_CHUNK_MIN;
+		if(pool->chunks)
+		{
+			csize = (pool->chunks->size < EVENT_CHUNK_SIZE / 2 ? pool->chunks->size * 2 : EVENT_CHUNK_SIZE);
+		}
+		if(csize < size)
+		{
+			csize = size;
+		}
+		if(NULL == (chunk = (event_chunk_t *) malloc(sizeof(event_chunk_t) + csize)))
+		{
+			return NULL;
+		}
+		chunk->size = csize;
+		chunk->next = pool->chunks;
+		pool->chunks = chunk;
+		pool->cur = chunk->data;
+		pool->left = chunk->size;
+	}
+	p = pool->cur;
+	pool->cur += size;
+	pool->left -= size;
+	pool->used += size;
+	return p;
+}
+
+/* Account for an allocation of 'size' bytes which is no longer used; the
+ * space is only recovered when the pool is compacted
+ */
+static void
+event_pool_discard(event_pool_t *pool, size_t size)
+{
+	pool->dead += EVENT_POOL_ALIGN(size);
+}
+
+/* Copy a string into a pool; empty strings are stored as NULL */
+static const char *
+event_pool_strdup(event_pool_t *pool, const char *str)
+{
+	char *p;
+	size_t len;
+
+	if(!str || !str[0])
+	{
+		return NULL;
+	}
+	len = strlen(str) + 1;
+	if(NULL == (p = (char *) event_pool_alloc(pool, len)))
+	{
+		return NULL;
+	}
+	memcpy(p, str, len);
+	return p;
+}
+
+static void
+event_pool_strfree(event_pool_t *pool, const char *str)
+{
+	if(str)
+	{
+		event_pool_discard(pool, strlen(str) + 1);
+	}
+}
+
+static void
+event_pool_release(event_pool_t *pool)
+{
+	event_chunk_t *chunk;
+
+	while((chunk = pool->chunks))
+	{
+		pool->chunks = chunk->next;
+		free(chunk);
+	}
+	memset(pool, 0, sizeof(event_pool_t));
+}
+
+/* Copy a string or list of strings belonging to one of an index's events
+ * into a new pool: if 'to' is NULL, just add up the space which is needed.
+ */
+static const char *
+event_pool_move(event_pool_t *to, const char *str, size_t *need)
+{
+	if(!str)
+	{
+		return NULL;
+	}
+	if(!to)
+	{
+		*need += EVENT_POOL_ALIGN(strlen(str) + 1);
+		return str;
+	}
+	return event_pool_strdup(to, str);
+}
+
+static event_langstr_t **
+event_pool_move_langstr(event_pool_t *to, event_langstr_t **list, uint8_t *count, size_t *need)
+{
+	event_langstr_t **q, *p;
+	size_t i, n;
+
+	for(i = n = 0; i < *count; i++)
+	{
+		if(list[i])
+		{
+			n++;
+		}
+	}
+	if(!n)
+	{
+		if(to)
+		{
+			*count = 0;
+		}
+		return NULL;
+	}
+	if(!to)
+	{
+		*need += EVENT_POOL_ALIGN(sizeof(event_langstr_t *) * n) + n * EVENT_POOL_ALIGN(sizeof(event_langstr_t));
+		for(i = 0; i < *count; i++)
+		{
+			event_pool_move(NULL, (list[i] ? list[i]->str : NULL), need);
+		}
+		return list;
+	}
+	q = (event_langstr_t **) event_pool_alloc(to, sizeof(event_langstr_t *) * n);
+	for(i = n = 0; i < *count; i++)
+	{
+		if(list[i])
+		{
+			p = (event_langstr_t *) event_pool_alloc(to, sizeof(event_langstr_t));
+			*p = *(list[i]);
+			p->str = event_pool_move(to, p->str, NULL);
+			q[n] = p;
+			n++;
+		}
+	}
+	*count = n;
+	return q;
+}
+
+static void *
+event_pool_move_array(event_pool_t *to, void *list, size_t size, size_t *need)
+{
+	void *p;
+
+	if(!list || !size)
+	{
+		return NULL;
+	}
+	if(!to)
+	{
+		*need += EVENT_POOL_ALIGN(size);
+		return list;
+	}
+	p = event_pool_alloc(to, size);
+	memcpy(p, list, size);
+	return p;
+}
+
+/* Copy the live contents of an index's pool into a single new chunk, and
+ * release the old one. The space needed is found first, so that the copy
+ * itself can't fail part-way through.
+ */
+static void
+event_pool_compact(event_index_t *index)
+{
+	event_pool_t pool;
+	event_t *e;
+	size_t i, j, need;
+
+	need = 0;
+	for(i = 0; i < index->nevents; i++)
+	{
+		e = index->events[i];
+		event_pool_move(NULL, e->identifier, &need);
+		event_pool_move(NULL, e->transport_uri, &need);
+		event_pool_move(NULL, e->pcrid, &need);
+		event_pool_move(NULL, e->scrid, &need);
+		event_pool_move_langstr(NULL, e->title, &(e->ntitle), &need);
+		event_pool_move_langstr(NULL, e->subtitle, &(e->nsubtitle), &need);
+		event_pool_move_langstr(NULL, e->description, &(e->ndescription), &need);
+		event_pool_move_array(NULL, e->crids, sizeof(event_crid_t) * e->ncrids, &need);
+		for(j = 0; j < e->ncrids; j++)
+		{
+			event_pool_move(NULL, e->crids[j].crid, &need);
+		}
+		event_pool_move_array(NULL, e->categories, sizeof(uint8_t) * e->ncategories, &need);
+		event_pool_move_array(NULL, e->ratings, sizeof(uint8_t) * e->nratings, &need);
+		event_pool_move_array(NULL, e->languages, sizeof(const char *) * e->nlanguages, &need);
+		event_pool_move_array(NULL, e->subtitling, sizeof(const char *) * e->nsubtitling, &need);
+		event_pool_move_array(NULL, e->unknown, sizeof(event_descriptor_t) * e->nunknown, &need);
+	}
+	memset(&pool, 0, sizeof(event_pool_t));
+	if(need)
+	{
+		if(!event_pool_alloc(&pool, need))
+		{
+			return;
+		}
+		/* Rewind so that the copies are made into the chunk just allocated */
+		pool.cur = pool.chunks->data;
+		pool.left = pool.chunks->size;
+		pool.used = 0;
+	}
+	for(i = 0; i < index->nevents; i++)
+	{
+		e = index->events[i];
+		e->identifier = event_pool_move(&pool, e->identifier, NULL);
+		e->transport_uri = event_pool_move(&pool, e->transport_uri, NULL);
+		e->pcrid = event_pool_move(&pool, e->pcrid, NULL);
+		e->scrid = event_pool_move(&pool, e->scrid, NULL);
+		e->title = event_pool_move_langstr(&pool, e->title, &(e->ntitle), NULL);
+		e->subtitle = event_pool_move_langstr(&pool, e->subtitle, &(e->nsubtitle), NULL);
+		e->description = event_pool_move_langstr(&pool, e->description, &(e->ndescription), NULL);
+		e->crids = event_pool_move_array(&pool, e->crids, sizeof(event_crid_t) * e->ncrids, NULL);
+		for(j = 0; j < e->ncrids; j++)
+		{
+			e->crids[j].crid = event_pool_move(&pool, e->crids[j].crid, NULL);
+		}
+		e->categories = event_pool_move_array(&pool, e->categories, sizeof(uint8_t) * e->ncategories, NULL);
+		e->ratings = event_pool_move_array(&pool, e->ratings, sizeof(uint8_t) * e->nratings, NULL);
+		e->languages = event_pool_move_array(&pool, e->languages, sizeof(const char *) * e->nlanguages, NULL);
+		e->subtitling = event_pool_move_array(&pool, e->subtitling, sizeof(const char *) * e->nsubtitling, NULL);
+		e->unknown = event_pool_move_array(&pool, e->unknown, sizeof(event_descriptor_t) * e->nunknown, NULL);
+	}
+	event_pool_release(&(index->pool));
+	index->pool = pool;
+}
+
+static size_t
+event_hash(service_t *service, int event_id)
+{
+	return dvb_hash_mix(((uint64_t) (uintptr_t) service << 16) ^ (uint64_t) event_id);
+}
+
+static size_t
+event_index_hash(const void *entry)
+{
+	return event_hash(((const event_index_t *) entry)->service, 0);
+}
+
+static int
+event_index_match(const void *entry, const void *key)
+{
+	return ((const event_index_t *) entry)->service == (const service_t *) key;
+}
+
+/* Locate (and optionally create) the index of a service's events */
+static event_index_t *
+event_index(service_t *service, int create)
+{
+	event_index_t *p;
 
+	if((p = (event_index_t *) dvb_hash_find(&indexes, event_hash(service, 0), event_index_match, service)))
+	{
+		return p;
+	}
+	if(!create)
+	{
+		return NULL;
+	}
+	if(NULL == (p = (event_index_t *) calloc(1, sizeof(event_index_t))))
+	{
+		return NULL;
+	}
+	p->service = service;
+	if(dvb_hash_insert(&indexes, p, event_index_hash))
+	{
+		free(p);
+		return NULL;
+	}
+	return p;
+}
+
+/* Return the position of the first event starting at or after 'start' */
+static size_t
+event_index_position(event_index_t *index, time_t start)
+{
+	size_t lo, hi, mid;
+
+	lo = 0;
+	hi = index->nevents;
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		if(index->events[mid]->start < start)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static int
+event_index_insert(event_index_t *index, event_t *event)
+{
+	event_t **l;
+	size_t i;
+
+	if(index->nevents + 1 > index->alloc)
+	{
+		if(NULL == (l = (event_t **) realloc(index->events, sizeof(event_t *) * (index->alloc + 32))))
+		{
+			return -1;
+		}
+		index->events = l;
+		index->alloc += 32;
+	}
+	i = event_index_position(index, event->start + 1);
+	memmove(&(index->events[i + 1]), &(index->events[i]), sizeof(event_t *) * (index->nevents - i));
+	index->events[i] = event;
+	index->nevents++;
+	return 0;
+}
+
+static void
+event_index_remove(event_index_t *index, event_t *event)
+{
+	size_t i;
+
+	for(i = event_index_position(index, event->start); i < index->nevents; i++)
+	{
+		if(index->events[i] == event)
+		{
+			index->nevents--;
+			memmove(&(index->events[i]), &(index->events[i + 1]), sizeof(event_t *) * (index->nevents - i));
+			return;
+		}
+	}
+}
+
+static size_t
+event_store_hash(const void *entry)
+{
+	return event_hash(((const event_t *) entry)->service, ((const event_t *) entry)->event_id);
+}
+
+static int
+event_store_match(const void *entry, const void *key)
+{
+	const event_t *event = (const event_t *) entry, *k = (const event_t *) key;
+
+	return event->service == k->service && event->event_id == k->event_id;
+}
+
+static event_t *
+event_store_find(service_t *service, int event_id)
+{
+	event_t key;
+
+	key.service = service;
+	key.event_id = event_id;
+	return (event_t *) dvb_hash_find(&store, event_hash(service, event_id), event_store_match, &key);
+}
+
+static int
+event_store_insert(event_t *event)
+{
+	return dvb_hash_insert(&store, event, event_store_hash);
+}
+
+static void
+event_store_remove(event_t *event)
+{
+	dvb_hash_remove(&store, event, event_store_hash);
+}
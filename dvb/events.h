@@ -20,9 +20,12 @@
 # include <time.h>
 
 # include "services.h"
+# include "intern.h"
 
 typedef struct event_struct event_t;
 typedef struct event_langstr_struct event_langstr_t;
+typedef struct event_crid_struct event_crid_t;
+typedef struct event_descriptor_struct event_descriptor_t;
 
 # define EA_INVALID                     0xFF
 
@@ -43,14 +46,42 @@ typedef enum {
 	EA_HARDOFHEARING   
 } event_audio_t;
 
+/* lang is interned; code is the language as packed by lang_pack() */
 struct event_langstr_struct {
-	char lang[8];
-	char str[1];
+	uint32_t code;
+	const char *lang;
+	const char *str;
+};
+
+/* A CRID from a content identifier descriptor, with its crid_type */
+struct event_crid_struct {
+	int type;
+	const char *crid;
+};
+
+/* A descriptor which wasn't recognised, noted so that it can be reported */
+struct event_descriptor_struct {
+	uint8_t tag;
+	uint8_t length;
 };
 
 event_t *event_alloc(const char *identifier);
 void event_free(event_t *event);
 
+event_t *event_add_dvb(service_t *service, int event_id);
+event_t *event_locate_dvb(service_t *service, int event_id);
+void event_reset(event_t *event);
+
+int event_id(event_t *event);
+
+void event_set_version(event_t *event, int table_id, int version);
+int event_version(event_t *event, int table_id);
+
+size_t event_expire(time_t when);
+event_t *event_at(service_t *service, time_t when);
+event_t *event_after(service_t *service, time_t when);
+event_t **event_schedule(service_t *service, size_t *count);
+
 const char *event_identifier(event_t *event);
 
 void event_set_start(event_t *event, time_t time);
@@ -72,12 +103,37 @@ void event_set_subtitle(event_t *event, const char *title, const char *lang);
 const char *event_subtitle(event_t *event, const char *lang);
 const event_langstr_t **event_subtitles(event_t *event, size_t *ntitles);
 
+void event_set_description(event_t *event, const char *description, const char *lang);
+const char *event_description(event_t *event, const char *lang);
+const event_langstr_t **event_descriptions(event_t *event, size_t *ndescriptions);
+
 void event_set_aspect(event_t *event, event_aspect_t aspect);
 event_aspect_t event_aspect(event_t *event);
 
 void event_set_audio(event_t *event, event_audio_t audio);
 event_audio_t event_audio(event_t *event);
 
+void event_set_channel(event_t *event, const char *channel);
+const char *event_channel(event_t *event);
+
+void event_add_category(event_t *event, int category);
+const uint8_t *event_categories(event_t *event, size_t *ncategories);
+
+void event_add_rating(event_t *event, int rating);
+const uint8_t *event_ratings(event_t *event, size_t *nratings);
+
+void event_add_language(event_t *event, const char *lang);
+const char **event_languages(event_t *event, size_t *nlanguages);
+
+void event_add_subtitling(event_t *event, const char *lang);
+const char **event_subtitling(event_t *event, size_t *nsubtitling);
+
+void event_add_crid(event_t *event, int type, const char *crid);
+const event_crid_t *event_crids(event_t *event, size_t *ncrids);
+
+void event_add_unknown(event_t *event, int tag, int length);
+const event_descriptor_t *event_unknown(event_t *event, size_t *nunknown);
+
 void event_set_pcrid(event_t *event, const char *pcrid);
 const char *event_pcrid(event_t *event);
 size_t event_qual_pcrid(event_t *event, char *buf, size_t buflen);
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2010 Mo McRoberts.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* The open-addressed hash table shared by the indexes of services,
+ * multiplexes, platforms, events, tables and interned strings.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "hash.h"
+
+#define DVB_HASH_MIN                    64
+
+/* Mix a key (or a hash of one) so that its low bits are usable as an index */
+size_t
+dvb_hash_mix(uint64_t k)
+{
+	k ^= k >> 29;
+	k *= UINT64_C(0x9E3779B97F4A7C15);
+	return (size_t) (k ^ (k >> 32));
+}
+
+/* Hash the first len bytes of a string */
+size_t
+dvb_hash_str(const char *str, size_t len)
+{
+	uint64_t k;
+	size_t i;
+
+	/* FNV-1a, with the result mixed as for the other hashes */
+	k = UINT64_C(0xCBF29CE484222325);
+	for(i = 0; i < len; i++)
+	{
+		k ^= (uint8_t) str[i];
+		k *= UINT64_C(0x100000001B3);
+	}
+	return dvb_hash_mix(k);
+}
+
+/* Return the entry for which match() returns non-zero, starting from the slot
+ * for the hash value hv, or NULL if there is none
+ */
+void *
+dvb_hash_find(dvb_hash_t *hash, size_t hv, int (*match)(const void *entry, const void *key), const void *key)
+{
+	size_t i, mask;
+
+	if(!hash->size)
+	{
+		return NULL;
+	}
+	mask = hash->size - 1;
+	for(i = hv & mask; hash->slots[i]; i = (i + 1) & mask)
+	{
+		if(match(hash->slots[i], key))
+		{
+			return hash->slots[i];
+		}
+	}
+	return NULL;
+}
+
+/* Add an entry, which must not already be present, doubling the number of
+ * slots first if the table would otherwise become more than half full
+ */
+int
+dvb_hash_insert(dvb_hash_t *hash, void *entry, size_t (*fn)(const void *entry))
+{
+	void **slots;
+	size_t i, j, size, mask;
+
+	if((hash->count + 1) * 2 > hash->size)
+	{
+		size = (hash->size ? hash->size * 2 : DVB_HASH_MIN);
+		if(NULL == (slots = (void **) calloc(size, sizeof(void *))))
+		{
+			return -1;
+		}
+		mask = size - 1;
+		for(i = 0; i < hash->size; i++)
+		{
+			if(hash->slots[i])
+			{
+				for(j = fn(hash->slots[i]) & mask; slots[j]; j = (j + 1) & mask);
+				slots[j] = hash->slots[i];
+			}
+		}
+		free(hash->slots);
+		hash->slots = slots;
+		hash->size = size;
+	}
+	mask = hash->size - 1;
+	for(i = fn(entry) & mask; hash->slots[i]; i = (i + 1) & mask);
+	hash->slots[i] = entry;
+	hash->count++;
+	return 0;
+}
+
+/* Remove an entry; the entries following it in the same run are shifted back
+ * so that no tombstone is needed.
+ */
+void
+dvb_hash_remove(dvb_hash_t *hash, const void *entry, size_t (*fn)(const void *entry))
+{
+	size_t i, j, k, mask;
+
+	if(!hash->size)
+	{
+		return;
+	}
+	mask = hash->size - 1;
+	for(i = fn(entry) & mask; hash->slots[i] != entry; i = (i + 1) & mask)
+	{
+		if(!hash->slots[i])
+		{
+			return;
+		}
+	}
+	hash->slots[i] = NULL;
+	hash->count--;
+	for(j = (i + 1) & mask; hash->slots[j]; j = (j + 1) & mask)
+	{
+		k = fn(hash->slots[j]) & mask;
+		/* Move the entry into the gap unless its home lies after the gap */
+		if((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j))
+		{
+			hash->slots[i] = hash->slots[j];
+			hash->slots[j] = NULL;
+			i = j;
+		}
+	}
+}
+
+/* Empty the table and free its slots; the entries are the caller's */
+void
+dvb_hash_clear(dvb_hash_t *hash)
+{
+	free(hash->slots);
+	hash->slots = NULL;
+	hash->size = 0;
+	hash->count = 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2010 Mo McRoberts.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef HASH_H_
+# define HASH_H_                        1
+
+# include <stddef.h>
+# include <stdint.h>
+
+typedef struct dvb_hash_struct dvb_hash_t;
+
+/* An open-addressed hash table of pointers to entries, which is probed
+ * linearly and kept no more than half full; a zero-filled dvb_hash_t is an
+ * empty table. The entries themselves never move, and an entry's hash value
+ * (as returned by the function passed to dvb_hash_insert() and
+ * dvb_hash_remove()) must be the same as that passed to dvb_hash_find() when
+ * looking it up by its key.
+ */
+struct dvb_hash_struct
+{
+	size_t count;
+	size_t size;
+	void **slots;
+};
+
+size_t dvb_hash_mix(uint64_t k);
+size_t dvb_hash_str(const char *str, size_t len);
+
+void *dvb_hash_find(dvb_hash_t *hash, size_t hv, int (*match)(const void *entry, const void *key), const void *key);
+int dvb_hash_insert(dvb_hash_t *hash, void *entry, size_t (*fn)(const void *entry));
+void dvb_hash_remove(dvb_hash_t *hash, const void *entry, size_t (*fn)(const void *entry));
+void dvb_hash_clear(dvb_hash_t *hash);
+
+#endif /*!HASH_H_*/
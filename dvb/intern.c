@@ -0,0 +1,173 @@
+/*
+ * Copyright 2010 Mo McRoberts.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Strings drawn from small, bounded sets which recur throughout a guide
+ * (authorities and language codes) are interned: each distinct string is
+ * stored only once, so that copies can be shared and compared by pointer.
+ * Interned strings are never freed, so nothing whose range of values is
+ * open-ended, such as titles or CRIDs, should be interned.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "intern.h"
+#include "hash.h"
+
+#define INTERN_CHUNK_SIZE               16384
+
+typedef struct intern_chunk_struct intern_chunk_t;
+
+struct intern_chunk_struct
+{
+	intern_chunk_t *next;
+	char data[];
+};
+
+/* The key used to look up a string which isn't NUL-terminated */
+struct intern_key
+{
+	const char *str;
+	size_t len;
+};
+
+static dvb_hash_t interned;
+static intern_chunk_t *chunks;
+static char *cur;
+static size_t left;
+
+static size_t
+intern_entry_hash(const void *entry)
+{
+	return dvb_hash_str((const char *) entry, strlen((const char *) entry));
+}
+
+static int
+intern_match(const void *entry, const void *k)
+{
+	const struct intern_key *key = (const struct intern_key *) k;
+
+	return !strncmp((const char *) entry, key->str, key->len) && !((const char *) entry)[key->len];
+}
+
+/* Copy a string into the chunks, which are allocated as needed */
+static char *
+intern_copy(const char *str, size_t len)
+{
+	intern_chunk_t *chunk;
+	size_t size;
+	char *p;
+
+	if(left < len + 1)
+	{
+		size = (len + 1 > INTERN_CHUNK_SIZE ? len + 1 : INTERN_CHUNK_SIZE);
+		if(NULL == (chunk = (intern_chunk_t *) malloc(sizeof(intern_chunk_t) + size)))
+		{
+			return NULL;
+		}
+		chunk->next = chunks;
+		chunks = chunk;
+		cur = chunk->data;
+		left = size;
+	}
+	p = cur;
+	memcpy(p, str, len);
+	p[len] = 0;
+	cur += len + 1;
+	left -= len + 1;
+	return p;
+}
+
+/* Return the interned copy of the first len bytes of str */
+const char *
+intern_strn(const char *str, size_t len)
+{
+	struct intern_key key;
+	char *p;
+
+	key.str = str;
+	key.len = len;
+	if((p = (char *) dvb_hash_find(&interned, dvb_hash_str(str, len), intern_match, &key)))
+	{
+		return p;
+	}
+	if(NULL == (p = intern_copy(str, len)))
+	{
+		return NULL;
+	}
+	if(dvb_hash_insert(&interned, p, intern_entry_hash))
+	{
+		return NULL;
+	}
+	return p;
+}
+
+const char *
+intern_str(const char *str)
+{
+	if(!str)
+	{
+		return NULL;
+	}
+	return intern_strn(str, strlen(str));
+}
+
+/* Pack a language code (such as "eng", or an XMLTV "en") into 24 bits,
+ * folding it to lower-case; an empty code packs to zero.
+ */
+uint32_t
+lang_pack(const char *lang)
+{
+	uint32_t code;
+	int i;
+
+	code = 0;
+	for(i = 0; i < 3; i++)
+	{
+		code <<= 8;
+		if(lang && lang[0])
+		{
+			code |= (uint8_t) (lang[0] >= 'A' && lang[0] <= 'Z' ? lang[0] + ('a' - 'A') : lang[0]);
+			lang++;
+		}
+	}
+	return code;
+}
+
+/* Return the interned string form of a packed language code */
+const char *
+lang_unpack(uint32_t code)
+{
+	char buf[4];
+	size_t len;
+
+	len = 0;
+	if((buf[len] = (code >> 16) & 0xFF))
+	{
+		len++;
+	}
+	if((buf[len] = (code >> 8) & 0xFF))
+	{
+		len++;
+	}
+	if((buf[len] = code & 0xFF))
+	{
+		len++;
+	}
+	return intern_strn(buf, len);
+}
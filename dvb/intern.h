@@ -0,0 +1,29 @@
+/*
+ * Copyright 2010 Mo McRoberts.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef INTERN_H_
+# define INTERN_H_                      1
+
+# include <stddef.h>
+# include <stdint.h>
+
+const char *intern_str(const char *str);
+const char *intern_strn(const char *str, size_t len);
+
+uint32_t lang_pack(const char *lang);
+const char *lang_unpack(uint32_t code);
+
+#endif /*!INTERN_H_*/
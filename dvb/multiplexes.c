@@ -16,37 +16,74 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
 
 #include "multiplexes.h"
 #include "platforms.h"
+#include "hash.h"
 
 #define MUX_URI_SIZE                    128
 
+/* DVB multiplexes are indexed by their packed (onid, tsid) pair, and their
+ * URIs are only formatted when asked for; multiplexes with any other kind of
+ * URI are located by a linear search.
+ *
+ * Multiplexes are never freed: mux_reset_all() instead advances the
+ * generation, which makes every existing multiplex invisible until it is
+ * added again, at which point it is reset and re-used in place.
+ */
 struct mux_struct
 {
+	/* Empty for a DVB multiplex until mux_uri() is called */
 	char uri[MUX_URI_SIZE];
+	/* original_network_id << 16 | transport_stream_id */
+	uint32_t key;
+	int dvb;
+	unsigned long generation;
 	void *data;
 	platform_t *platform;
 };
 
 static size_t nmultiplexes, nmuxalloc;
 static mux_t **multiplexes;
+static dvb_hash_t hash;
+static unsigned long generation;
 
 static mux_t *mux_alloc(void);
+static int mux_parse_dvb(const char *uri, uint32_t *key);
+static mux_t *mux_find(uint32_t key);
+static int mux_insert(mux_t *mux);
 
 mux_t *
 mux_add(const char *uri)
 {
 	mux_t *p;
+	size_t i;
+	uint32_t key;
 
 	if(strlen(uri) >= MUX_URI_SIZE)
 	{
 		errno = EINVAL;
 		return NULL;
 	}
-	if(NULL == (p = mux_locate(uri)))
+	if(!mux_parse_dvb(uri, &key))
+	{
+		return mux_add_dvb((int) (key >> 16), (int) (key & 0xFFFF));
+	}
+	for(i = 0; i < nmultiplexes; i++)
+	{
+		if(!multiplexes[i]->dvb && !strcmp(multiplexes[i]->uri, uri))
+		{
+			break;
+		}
+	}
+	if(i < nmultiplexes)
+	{
+		p = multiplexes[i];
+	}
+	else
 	{
 		if(NULL == (p = mux_alloc()))
 		{
@@ -61,10 +98,30 @@ mux_add(const char *uri)
 mux_t *
 mux_add_dvb(int original_network_id, int transport_stream_id)
 {
-	char uri[64];
-	
-	sprintf(uri, "dvb://%04x.%04x", original_network_id, transport_stream_id);
-	return mux_add(uri);
+	mux_t *p;
+	uint32_t key;
+
+	key = ((uint32_t) original_network_id << 16) | (uint32_t) transport_stream_id;
+	if(NULL == (p = mux_find(key)))
+	{
+		if(NULL == (p = mux_alloc()))
+		{
+			return NULL;
+		}
+		p->key = key;
+		p->dvb = 1;
+		if(mux_insert(p))
+		{
+			/* mux_alloc() appended it to the list: take it off again,
+			 * so that mux_foreach() doesn't visit it
+			 */
+			nmultiplexes--;
+			free(p);
+			return NULL;
+		}
+	}
+	mux_reset(p);
+	return p;
 }
 
 void
@@ -74,18 +131,38 @@ mux_reset(mux_t *multiplex)
 
 	memset(&p, 0, sizeof(mux_t));
 	strcpy(p.uri, multiplex->uri);
-	p.data = multiplex->data;
+	p.key = multiplex->key;
+	p.dvb = multiplex->dvb;
+	p.generation = generation;
+	if(multiplex->generation == generation)
+	{
+		p.data = multiplex->data;
+	}
 	memcpy(multiplex, &p, sizeof(mux_t));
 }
 
+/* Forget every multiplex (for example, before a rescan) without freeing
+ * them
+ */
+void
+mux_reset_all(void)
+{
+	generation++;
+}
+
 mux_t *
 mux_locate(const char *uri)
 {
 	size_t i;
-	
+	uint32_t key;
+
+	if(!mux_parse_dvb(uri, &key))
+	{
+		return mux_locate_dvb((int) (key >> 16), (int) (key & 0xFFFF));
+	}
 	for(i = 0; i < nmultiplexes; i++)
 	{
-		if(multiplexes[i] && !strcmp(multiplexes[i]->uri, uri))
+		if(multiplexes[i]->generation == generation && !multiplexes[i]->dvb && !strcmp(multiplexes[i]->uri, uri))
 		{
 			return multiplexes[i];
 		}
@@ -96,10 +173,13 @@ mux_locate(const char *uri)
 mux_t *
 mux_locate_dvb(int original_network_id, int transport_stream_id)
 {
-	char uri[64];
-	
-	sprintf(uri, "dvb://%04x.%04x", original_network_id, transport_stream_id);
-	return mux_locate(uri);
+	mux_t *p;
+
+	if((p = mux_find(((uint32_t) original_network_id << 16) | (uint32_t) transport_stream_id)) && p->generation == generation)
+	{
+		return p;
+	}
+	return NULL;
 }
 
 mux_t *
@@ -117,15 +197,22 @@ mux_locate_add(const char *uri)
 mux_t *
 mux_locate_add_dvb(int original_network_id, int transport_stream_id)
 {
-	char uri[64];
+	mux_t *s;
 	
-	sprintf(uri, "dvb://%04x.%04x", original_network_id, transport_stream_id);
-	return mux_locate_add(uri);
+	if((s = mux_locate_dvb(original_network_id, transport_stream_id)))
+	{
+		return s;
+	}
+	return mux_add_dvb(original_network_id, transport_stream_id);
 }
 
 const char *
 mux_uri(mux_t *multiplex)
 {
+	if(!multiplex->uri[0] && multiplex->dvb)
+	{
+		sprintf(multiplex->uri, "dvb://%04x.%04x", (unsigned) (multiplex->key >> 16), (unsigned) (multiplex->key & 0xFFFF));
+	}
 	return multiplex->uri;
 }
 
@@ -161,7 +248,8 @@ mux_alloc(void)
 	if(NULL == (p = (mux_t *) calloc(1, sizeof(mux_t))))
 	{
 		return NULL;
-	}  
+	}
+	p->generation = generation;
 	if(nmultiplexes + 1 > nmuxalloc)
 	{
 		if(NULL == (l = (mux_t **) realloc(multiplexes, sizeof(mux_t *) * (nmuxalloc + 4))))
@@ -177,6 +265,71 @@ mux_alloc(void)
 	return p;
 }
 
+/* Parse a URI of the form dvb://onid.tsid, as formatted by mux_uri(), into
+ * a key; returns 0 on success or -1 if it isn't one.
+ */
+static int
+mux_parse_dvb(const char *uri, uint32_t *key)
+{
+	size_t i;
+	int c;
+
+	if(strncmp(uri, "dvb://", 6) || strlen(uri) != 15)
+	{
+		return -1;
+	}
+	*key = 0;
+	for(i = 6; i < 15; i++)
+	{
+		c = uri[i];
+		if(i == 10)
+		{
+			if(c != '.')
+			{
+				return -1;
+			}
+			continue;
+		}
+		if(c >= '0' && c <= '9')
+		{
+			*key = (*key << 4) | (c - '0');
+		}
+		else if(c >= 'a' && c <= 'f')
+		{
+			*key = (*key << 4) | (c - 'a' + 10);
+		}
+		else
+		{
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static size_t
+mux_hash(const void *entry)
+{
+	return dvb_hash_mix(((const mux_t *) entry)->key);
+}
+
+static int
+mux_match(const void *entry, const void *key)
+{
+	return ((const mux_t *) entry)->key == *(const uint32_t *) key;
+}
+
+static mux_t *
+mux_find(uint32_t key)
+{
+	return (mux_t *) dvb_hash_find(&hash, dvb_hash_mix(key), mux_match, &key);
+}
+
+static int
+mux_insert(mux_t *multiplex)
+{
+	return dvb_hash_insert(&hash, multiplex, mux_hash);
+}
+
 int
 mux_foreach(int (*fn)(mux_t *mux, void *data), void *data)
 {
@@ -185,7 +338,7 @@ mux_foreach(int (*fn)(mux_t *mux, void *data), void *data)
 
 	for(n = 0; n < nmultiplexes; n++)
 	{
-		if(multiplexes[n])
+		if(multiplexes[n]->generation == generation)
 		{
 			if((r = fn(multiplexes[n], data)) != 0)
 			{
@@ -195,5 +348,3 @@ mux_foreach(int (*fn)(mux_t *mux, void *data), void *data)
 	}
 	return 0;
 }
-
-		
@@ -33,6 +33,7 @@ mux_t *mux_locate_add_dvb(int original_network_id, int transport_stream_id);
 const char *mux_uri(mux_t *mux);
 
 void mux_reset(mux_t *mux);
+void mux_reset_all(void);
 
 void mux_set_platform(mux_t *mux, platform_t *platform);
 platform_t *mux_platform(mux_t *mux);
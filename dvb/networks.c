@@ -22,7 +22,14 @@
 #include "networks.h"
 
 #define NETWORK_IDENT_SIZE              32
+/* LCNs below this (without a sub-LCN) are indexed directly */
+#define NETWORK_LCN_DENSE               16384
 
+/* A network's services are held sorted by LCN and then sub-LCN, so that
+ * network_services() can return them in channel order and any service can be
+ * found by a binary search; in addition, those with an LCN but no sub-LCN
+ * (the common case) are indexed directly by LCN.
+ */
 struct network_struct
 {
 	char ident[NETWORK_IDENT_SIZE];
@@ -35,12 +42,15 @@ struct network_struct
 	size_t nservice;
 	size_t servalloc;
 	network_service_t **service;
+	size_t lcnsize;
+	network_service_t **bylcn;
 };
 
 static size_t nnetworks, nnetalloc;
 static network_t **networks;
 
 static network_t *network_alloc(void);
+static size_t network_service_index(network_t *network, int lcn, int sublcn);
 
 network_t *
 network_add(const char *ident)
@@ -77,12 +87,19 @@ void
 network_reset(network_t *network)
 {
 	network_t p;
+	size_t i;
 
 	memset(&p, 0, sizeof(network_t));
 	strcpy(p.ident, network->ident);
 	p.data = network->data;
 	p.version = -1;
 	free(network->mux);
+	for(i = 0; i < network->nservice; i++)
+	{
+		free(network->service[i]);
+	}
+	free(network->service);
+	free(network->bylcn);
 	memcpy(network, &p, sizeof(network_t));
 }
 
@@ -213,51 +230,74 @@ network_muxes(network_t *network, size_t *count)
 	return network->mux;
 }
 
+/* Assign a service to an LCN (and sub-LCN, or -1 if none), replacing any
+ * service previously assigned to it; if service is NULL, the assignment is
+ * removed instead.
+ */
 network_service_t *
 network_set_service(network_t *network, service_t *service, int visible, int lcn, int sublcn)
 {
 	network_service_t *srv, **l;
-	size_t i;
+	size_t i, size;
 
-	for(i = 0; i < network->nservice; i++)
+	i = network_service_index(network, lcn, sublcn);
+	if(i < network->nservice && network->service[i]->lcn == lcn && network->service[i]->sublcn == sublcn)
 	{
-		if(!network->service[i])
+		srv = network->service[i];
+		if(service)
 		{
-			continue;
+			srv->service = service;
+			srv->visible = visible;
+			return srv;
 		}
-		if(network->service[i]->lcn == lcn && network->service[i]->sublcn == sublcn)
+		if(sublcn == -1 && lcn >= 0 && (size_t) lcn < network->lcnsize)
 		{
-			if(service)
-			{
-				network->service[i]->service = service;
-				network->service[i]->visible = visible;
-				return network->service[i];
-			}
-			free(network->service[i]);
-			network->service[i] = NULL;
-			return NULL;
+			network->bylcn[lcn] = NULL;
 		}
+		network->nservice--;
+		memmove(&(network->service[i]), &(network->service[i + 1]), sizeof(network_service_t *) * (network->nservice - i));
+		free(srv);
+		return NULL;
 	}
-	if(NULL == (srv = calloc(1, sizeof(network_service_t))))
+	if(!service)
 	{
 		return NULL;
 	}
-	srv->service = service;
-	srv->visible = visible;
-	srv->lcn = lcn;
-	srv->sublcn = sublcn;
+	if(sublcn == -1 && lcn >= 0 && lcn < NETWORK_LCN_DENSE && (size_t) lcn >= network->lcnsize)
+	{
+		for(size = (network->lcnsize ? network->lcnsize : 1024); size <= (size_t) lcn; size *= 2);
+		if(NULL == (l = realloc(network->bylcn, sizeof(network_service_t *) * size)))
+		{
+			return NULL;
+		}
+		memset(&(l[network->lcnsize]), 0, sizeof(network_service_t *) * (size - network->lcnsize));
+		network->bylcn = l;
+		network->lcnsize = size;
+	}
 	if(network->nservice + 1 > network->servalloc)
 	{
 		if(NULL == (l = realloc(network->service, sizeof(network_service_t *) * (network->servalloc + 16))))
 		{
-			free(srv);
 			return NULL;
 		}
 		network->service = l;
 		network->servalloc += 16;
 	}
-	network->service[network->nservice] = srv;
+	if(NULL == (srv = calloc(1, sizeof(network_service_t))))
+	{
+		return NULL;
+	}
+	srv->service = service;
+	srv->visible = visible;
+	srv->lcn = lcn;
+	srv->sublcn = sublcn;
+	memmove(&(network->service[i + 1]), &(network->service[i]), sizeof(network_service_t *) * (network->nservice - i));
+	network->service[i] = srv;
 	network->nservice++;
+	if(sublcn == -1 && lcn >= 0 && (size_t) lcn < network->lcnsize)
+	{
+		network->bylcn[lcn] = srv;
+	}
 	return srv;
 }
 
@@ -266,16 +306,23 @@ network_service(network_t *network, int lcn, int sublcn)
 {
 	size_t i;
 
-	for(i = 0; i < network->nservice; i++)
+	if(sublcn == -1 && lcn >= 0 && lcn < NETWORK_LCN_DENSE)
 	{
-		if(network->service[i] && network->service[i]->lcn == lcn && network->service[i]->sublcn == sublcn)
+		if((size_t) lcn < network->lcnsize)
 		{
-			return network->service[i];
+			return network->bylcn[lcn];
 		}
+		return NULL;
+	}
+	i = network_service_index(network, lcn, sublcn);
+	if(i < network->nservice && network->service[i]->lcn == lcn && network->service[i]->sublcn == sublcn)
+	{
+		return network->service[i];
 	}
 	return NULL;
 }
 
+/* Return the services in order of LCN and sub-LCN */
 network_service_t **
 network_services(network_t *network, size_t *count)
 {
@@ -333,6 +380,33 @@ network_debug_dump(void)
 	}
 }
 
+/* Return the position of the first service whose LCN and sub-LCN are not
+ * less than those given
+ */
+static size_t
+network_service_index(network_t *network, int lcn, int sublcn)
+{
+	size_t lo, hi, mid;
+	network_service_t *srv;
+
+	lo = 0;
+	hi = network->nservice;
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		srv = network->service[mid];
+		if(srv->lcn < lcn || (srv->lcn == lcn && srv->sublcn < sublcn))
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
 static network_t *
 network_alloc(void)
 {
@@ -356,5 +430,3 @@ network_alloc(void)
 	nnetworks++;
 	return p;
 }
-
-		
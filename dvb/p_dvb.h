@@ -25,13 +25,135 @@
 
 # include "../debug.h"
 
+# define DVB_TS_SYNC                    0x47
+# define DVB_TS_MAX_PID                 8192
+# define DVB_SECTION_MAX                4096
+/* Must be a power of two */
+# define DVB_DEMUX_RING                 65536
+
+/* Section storage: size classes from DVB_ARENA_MIN doubling up to
+ * DVB_SECTION_MAX, carved from slabs of DVB_ARENA_SLAB bytes
+ */
+# define DVB_ARENA_MIN                  256
+# define DVB_ARENA_CLASSES              5
+# define DVB_ARENA_SLAB                 16384
+
+/* Whether a section has been accounted for in a received bitmap */
+# define DVB_SECTION_HAS(received, secnum) ((received)[(secnum) >> 5] & (UINT32_C(1) << ((secnum) & 31)))
+# define DVB_TABLE_HAS(table, secnum)   DVB_SECTION_HAS((table)->received, secnum)
+
+typedef struct dvb_ts_pid_struct dvb_ts_pid_t;
+typedef struct dvb_reactor_entry_struct dvb_reactor_entry_t;
+typedef struct dvb_arena_struct dvb_arena_t;
+typedef struct dvb_arena_slab_struct dvb_arena_slab_t;
+
+struct dvb_arena_struct
+{
+	/* The maximum number of bytes of slabs to allocate (0 = unlimited) */
+	size_t limit;
+	size_t used;
+	dvb_arena_slab_t *slabs;
+	void *free[DVB_ARENA_CLASSES];
+	/* The remainder of the slab most recently allocated for each class */
+	uint8_t *cur[DVB_ARENA_CLASSES];
+	size_t left[DVB_ARENA_CLASSES];
+};
+
 struct dvb_demux_struct
 {
 	int fd;
 	time_t timeout;
-	uint8_t buf[8192];
-	size_t ntables;
-	dvb_table_t *tables;
+	/* Data read but not yet processed lies between tail and head, which
+	 * only ever increase and are masked to index the ring
+	 */
+	size_t head;
+	size_t tail;
+	uint8_t ring[DVB_DEMUX_RING];
+	/* Sections or packets which wrap around the end of the ring are made
+	 * contiguous here
+	 */
+	uint8_t scratch[DVB_SECTION_MAX];
+	/* Set once the descriptor has been closed or has failed */
+	int eof;
+	/* The sub-tables, by identity */
+	dvb_hash_t tables;
+	/* Storage for the sections of those tables */
+	dvb_arena_t arena;
+	/* If non-NULL, the input is a raw transport stream */
+	dvb_ts_t *ts;
+	/* The section filter programmed on the device, if any */
+	int filtered;
+	struct dmx_sct_filter_params filter;
+};
+
+/* A set of section filters serviced concurrently */
+struct dvb_acquire_struct
+{
+	time_t timeout;
+	char *path;
+	size_t nfilters;
+	struct dmx_sct_filter_params *filters;
+	/* One demux context per filter if path is a demux device, otherwise
+	 * a single context for the transport stream.
+	 */
+	size_t ncontexts;
+	dvb_demux_t **contexts;
+	/* Set if the input is a transport stream, along with the distinct
+	 * PIDs requested so far
+	 */
+	int ts;
+	size_t npids;
+	int *pids;
+	/* The reactor servicing the contexts, and the callbacks to invoke */
+	dvb_reactor_t *reactor;
+	dvb_callbacks_t *callbacks;
+	int complete;
+};
+
+/* A demux context attached to a reactor */
+struct dvb_reactor_entry_struct
+{
+	dvb_demux_t *context;
+	time_t deadline;
+	/* When data was last received */
+	time_t last;
+	int (*fn)(dvb_demux_t *context, dvb_table_t *table, void *data);
+	void *data;
+	/* Registered with epoll (regular files can't be) */
+	int polled;
+	/* Detached, awaiting removal */
+	int dead;
+};
+
+struct dvb_reactor_struct
+{
+	int epfd;
+	size_t nentries;
+	dvb_reactor_entry_t **entries;
+};
+
+/* Reassembly state for a single PID */
+struct dvb_ts_pid_struct
+{
+	int pid;
+	int cc;
+	int active;
+	size_t len;
+	size_t need;
+	uint8_t buf[DVB_SECTION_MAX];
+};
+
+struct dvb_ts_struct
+{
+	/* Index into pids (plus one) for each PID we're interested in */
+	uint8_t map[DVB_TS_MAX_PID];
+	size_t npids;
+	dvb_ts_pid_t *pids;
+	/* The packet currently being processed */
+	uint8_t packet[DVB_TS_PACKET_SIZE];
+	dvb_ts_pid_t *cur;
+	size_t off;
+	int start;
 };
 
 #ifdef __cplusplus
@@ -40,8 +162,17 @@ extern "C" {
 
 	dvb_demux_t *dvb_demux_new(int fd);
 	void dvb_demux_delete(dvb_demux_t *context);
+	void dvb_demux_tables_free(dvb_demux_t *context);
+	void dvb_demux_filter_complete(dvb_demux_t *context, dvb_table_t *table);
+	int dvb_section_mark(uint32_t *received, size_t *remaining, int secnum);
+	void dvb_section_mark_segment(uint32_t *received, size_t *remaining, size_t nsections, dvb_section_t *section);
+
+	void *dvb_arena_alloc(dvb_arena_t *arena, size_t size);
+	void dvb_arena_free(dvb_arena_t *arena, void *p, size_t size);
+	void dvb_arena_release(dvb_arena_t *arena);
 
-	uint32_t dvb_crc32(const uint8_t *data, size_t len);
+	uint32_t dvb_crc32_table(const uint8_t *data, size_t len);
+	uint32_t dvb_crc32_slice8(const uint8_t *data, size_t len);
 
 #ifdef __cplusplus
 };
@@ -16,34 +16,67 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
 
 #include "platforms.h"
+#include "hash.h"
 
 #define PLATFORM_URI_SIZE               64
 
+/* DVB platforms are indexed by original_network_id, and their URIs are only
+ * formatted when asked for. As with multiplexes, platforms are never freed:
+ * platform_reset_all() advances the generation instead, so that existing
+ * platforms are re-used in place as they are added again.
+ */
 struct platform_struct
 {
+	/* Empty for a DVB platform until platform_uri() is called */
 	char uri[PLATFORM_URI_SIZE];
+	int original_network_id;
+	int dvb;
+	unsigned long generation;
 };
 
 static size_t nplatform;
 static platform_t **platforms;
+static dvb_hash_t hash;
+static unsigned long generation;
 
 static platform_t *platform_alloc(void);
+static int platform_parse_dvb(const char *uri);
+static platform_t *platform_find(int original_network_id);
+static int platform_insert(platform_t *platform);
 
 platform_t *
 platform_add(const char *uri)
 {
 	platform_t *p;
+	size_t i;
+	int onid;
 	
 	if(strlen(uri) >= PLATFORM_URI_SIZE)
 	{
 		errno = EINVAL;
 		return NULL;
 	}
-	if(NULL == (p = platform_locate(uri)))
+	if(-1 != (onid = platform_parse_dvb(uri)))
+	{
+		return platform_add_dvb(onid);
+	}
+	for(i = 0; i < nplatform; i++)
+	{
+		if(!platforms[i]->dvb && !strcmp(platforms[i]->uri, uri))
+		{
+			break;
+		}
+	}
+	if(i < nplatform)
+	{
+		p = platforms[i];
+	}
+	else
 	{
 		if(NULL == (p = platform_alloc()))
 		{
@@ -58,20 +91,41 @@ platform_add(const char *uri)
 platform_t *
 platform_add_dvb(int original_network_id)
 {
-	char uri[32];
+	platform_t *p;
 
-	snprintf(uri, sizeof(uri), "dvb://%04x", original_network_id);
-	return platform_add(uri);
+	if(NULL == (p = platform_find(original_network_id)))
+	{
+		if(NULL == (p = platform_alloc()))
+		{
+			return NULL;
+		}
+		p->original_network_id = original_network_id;
+		p->dvb = 1;
+		if(platform_insert(p))
+		{
+			/* platform_alloc() appended it to the list: take it off again */
+			nplatform--;
+			free(p);
+			return NULL;
+		}
+	}
+	platform_reset(p);
+	return p;
 }
 
 platform_t *
 platform_locate(const char *uri)
 {
 	size_t i;
+	int onid;
 	
+	if(-1 != (onid = platform_parse_dvb(uri)))
+	{
+		return platform_locate_dvb(onid);
+	}
 	for(i = 0; i < nplatform; i++)
 	{
-		if(platforms[i] && !strcmp(platforms[i]->uri, uri))
+		if(platforms[i]->generation == generation && !platforms[i]->dvb && !strcmp(platforms[i]->uri, uri))
 		{
 			return platforms[i];
 		}
@@ -82,10 +136,13 @@ platform_locate(const char *uri)
 platform_t *
 platform_locate_dvb(int original_network_id)
 {
-	char uri[32];
+	platform_t *p;
 
-	snprintf(uri, sizeof(uri), "dvb://%04x", original_network_id);
-	return platform_locate(uri);
+	if((p = platform_find(original_network_id)) && p->generation == generation)
+	{
+		return p;
+	}
+	return NULL;
 }
 
 platform_t *
@@ -103,21 +160,35 @@ platform_locate_add(const char *uri)
 platform_t *
 platform_locate_add_dvb(int original_network_id)
 {
-	char uri[32];
+	platform_t *p;
 
-	snprintf(uri, sizeof(uri), "dvb://%04x", original_network_id);
-	return platform_locate_add(uri);
+	if((p = platform_locate_dvb(original_network_id)))
+	{
+		return p;
+	}
+	return platform_add_dvb(original_network_id);
 }
 
 void
 platform_reset(platform_t *platform)
 {
-	(void) platform;
+	platform->generation = generation;
+}
+
+/* Forget every platform (for example, before a rescan) without freeing them */
+void
+platform_reset_all(void)
+{
+	generation++;
 }
 
 const char *
 platform_uri(platform_t *platform)
 {
+	if(!platform->uri[0] && platform->dvb)
+	{
+		snprintf(platform->uri, sizeof(platform->uri), "dvb://%04x", platform->original_network_id);
+	}
 	return platform->uri;
 }
 
@@ -140,3 +211,60 @@ platform_alloc(void)
 	nplatform++;
 	return p;
 }
+
+/* Parse a URI of the form dvb://onid, as formatted by platform_uri(),
+ * returning the original_network_id or -1 if it isn't one.
+ */
+static int
+platform_parse_dvb(const char *uri)
+{
+	size_t i;
+	int c, onid;
+
+	if(strncmp(uri, "dvb://", 6) || strlen(uri) != 10)
+	{
+		return -1;
+	}
+	onid = 0;
+	for(i = 6; i < 10; i++)
+	{
+		c = uri[i];
+		if(c >= '0' && c <= '9')
+		{
+			onid = (onid << 4) | (c - '0');
+		}
+		else if(c >= 'a' && c <= 'f')
+		{
+			onid = (onid << 4) | (c - 'a' + 10);
+		}
+		else
+		{
+			return -1;
+		}
+	}
+	return onid;
+}
+
+static size_t
+platform_hash(const void *entry)
+{
+	return dvb_hash_mix((uint64_t) ((const platform_t *) entry)->original_network_id);
+}
+
+static int
+platform_match(const void *entry, const void *key)
+{
+	return ((const platform_t *) entry)->original_network_id == *(const int *) key;
+}
+
+static platform_t *
+platform_find(int original_network_id)
+{
+	return (platform_t *) dvb_hash_find(&hash, dvb_hash_mix((uint64_t) original_network_id), platform_match, &original_network_id);
+}
+
+static int
+platform_insert(platform_t *platform)
+{
+	return dvb_hash_insert(&hash, platform, platform_hash);
+}
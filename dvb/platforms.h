@@ -29,6 +29,7 @@ platform_t *platform_locate_add(const char *ident);
 platform_t *platform_locate_add_dvb(int original_network_id);
 
 void platform_reset(platform_t *platform);
+void platform_reset_all(void);
 
 const char *platform_uri(platform_t *platform);
 
@@ -0,0 +1,290 @@
+/*
+ * Copyright 2010 Mo McRoberts.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* An epoll-based reactor which services any number of demux contexts (across
+ * any number of adapters) from a single thread. Each context has its own
+ * deadline and idle timeout, and a callback which is invoked for each complete
+ * table read from it, and once more with a NULL table when it expires.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+
+#include "p_dvb.h"
+
+#define DVB_REACTOR_EVENTS              16
+
+static void dvb_reactor_dispatch(dvb_reactor_t *reactor, dvb_reactor_entry_t *entry, time_t now);
+static void dvb_reactor_expire(dvb_reactor_t *reactor, dvb_reactor_entry_t *entry);
+static void dvb_reactor_detach(dvb_reactor_t *reactor, dvb_reactor_entry_t *entry);
+static void dvb_reactor_reap(dvb_reactor_t *reactor);
+
+dvb_reactor_t *
+dvb_reactor_new(void)
+{
+	dvb_reactor_t *p;
+
+	if(NULL == (p = calloc(1, sizeof(dvb_reactor_t))))
+	{
+		return NULL;
+	}
+	if(-1 == (p->epfd = epoll_create1(EPOLL_CLOEXEC)))
+	{
+		free(p);
+		return NULL;
+	}
+	return p;
+}
+
+/* Destroy a reactor; any contexts still attached to it are left open */
+void
+dvb_reactor_delete(dvb_reactor_t *reactor)
+{
+	size_t i;
+
+	for(i = 0; i < reactor->nentries; i++)
+	{
+		free(reactor->entries[i]);
+	}
+	free(reactor->entries);
+	close(reactor->epfd);
+	free(reactor);
+}
+
+/* Attach a demux context to the reactor. fn is invoked with each complete
+ * table read from the context; if it returns non-zero, the context is
+ * detached. Once 'deadline' passes (if non-zero), no data has arrived for
+ * the context's timeout (see dvb_demux_set_timeout()), or the input ends, the
+ * context is detached and fn is invoked a final time with a NULL table, at
+ * which point it may safely close the context.
+ */
+int
+dvb_reactor_add(dvb_reactor_t *reactor, dvb_demux_t *context, time_t deadline, int (*fn)(dvb_demux_t *context, dvb_table_t *table, void *data), void *data)
+{
+	struct epoll_event ev;
+	dvb_reactor_entry_t *p, **l;
+
+	if(NULL == (l = realloc(reactor->entries, sizeof(dvb_reactor_entry_t *) * (reactor->nentries + 1))))
+	{
+		return -1;
+	}
+	reactor->entries = l;
+	if(NULL == (p = calloc(1, sizeof(dvb_reactor_entry_t))))
+	{
+		return -1;
+	}
+	p->context = context;
+	p->deadline = deadline;
+	p->last = time(NULL);
+	p->fn = fn;
+	p->data = data;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLET;
+	ev.data.ptr = p;
+	if(-1 == epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, context->fd, &ev))
+	{
+		if(errno != EPERM)
+		{
+			free(p);
+			return -1;
+		}
+		/* Regular files can't be polled, but are always readable */
+		DBG(5, fprintf(stderr, "[dvb_reactor_add: descriptor %d is not pollable; will read continuously]\n", context->fd));
+	}
+	else
+	{
+		p->polled = 1;
+	}
+	l[reactor->nentries] = p;
+	reactor->nentries++;
+	return 0;
+}
+
+/* Detach a context from the reactor without invoking its callback */
+int
+dvb_reactor_remove(dvb_reactor_t *reactor, dvb_demux_t *context)
+{
+	size_t i;
+
+	for(i = 0; i < reactor->nentries; i++)
+	{
+		if(reactor->entries[i]->context == context && !reactor->entries[i]->dead)
+		{
+			dvb_reactor_detach(reactor, reactor->entries[i]);
+			return 0;
+		}
+	}
+	errno = ENOENT;
+	return -1;
+}
+
+/* Service the attached contexts until none remain. Returns 0, or -1 if
+ * epoll_wait() fails.
+ */
+int
+dvb_reactor_run(dvb_reactor_t *reactor)
+{
+	struct epoll_event events[DVB_REACTOR_EVENTS];
+	dvb_reactor_entry_t *entry;
+	time_t now, t;
+	int i, n, ms;
+	size_t c;
+
+	while(1)
+	{
+		dvb_reactor_reap(reactor);
+		if(!reactor->nentries)
+		{
+			break;
+		}
+		now = time(NULL);
+		ms = -1;
+		for(c = 0; c < reactor->nentries; c++)
+		{
+			entry = reactor->entries[c];
+			if(entry->dead)
+			{
+				continue;
+			}
+			if((entry->deadline && now >= entry->deadline) ||
+			   (entry->context->timeout && now - entry->last >= entry->context->timeout))
+			{
+				DBG(8, fprintf(stderr, "[dvb_reactor_run: descriptor %d has expired]\n", entry->context->fd));
+				dvb_reactor_expire(reactor, entry);
+				continue;
+			}
+			if(!entry->polled)
+			{
+				ms = 0;
+				continue;
+			}
+			t = 0;
+			if(entry->deadline)
+			{
+				t = entry->deadline - now;
+			}
+			if(entry->context->timeout && (!t || entry->last + entry->context->timeout - now < t))
+			{
+				t = entry->last + entry->context->timeout - now;
+			}
+			if(t && (ms == -1 || t * 1000 < ms))
+			{
+				ms = t * 1000;
+			}
+		}
+		n = epoll_wait(reactor->epfd, events, DVB_REACTOR_EVENTS, ms);
+		if(n == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+		now = time(NULL);
+		for(i = 0; i < n; i++)
+		{
+			entry = events[i].data.ptr;
+			if(!entry->dead)
+			{
+				dvb_reactor_dispatch(reactor, entry, now);
+			}
+		}
+		for(c = 0; c < reactor->nentries; c++)
+		{
+			entry = reactor->entries[c];
+			if(!entry->dead && !entry->polled)
+			{
+				dvb_reactor_dispatch(reactor, entry, now);
+			}
+		}
+	}
+	return 0;
+}
+
+/* Read everything currently available from a context; because the
+ * descriptor is edge-triggered, it must be drained fully before the next
+ * notification will arrive.
+ */
+static void
+dvb_reactor_dispatch(dvb_reactor_t *reactor, dvb_reactor_entry_t *entry, time_t now)
+{
+	dvb_table_t *table;
+
+	entry->last = now;
+	while((table = dvb_demux_read_nowait(entry->context)))
+	{
+		if(entry->fn(entry->context, table, entry->data))
+		{
+			dvb_reactor_detach(reactor, entry);
+			return;
+		}
+		if(entry->dead)
+		{
+			/* The callback detached it */
+			return;
+		}
+	}
+	if(dvb_demux_eof(entry->context))
+	{
+		DBG(5, fprintf(stderr, "[dvb_reactor_dispatch: descriptor %d has ended]\n", entry->context->fd));
+		dvb_reactor_expire(reactor, entry);
+	}
+}
+
+static void
+dvb_reactor_expire(dvb_reactor_t *reactor, dvb_reactor_entry_t *entry)
+{
+	dvb_reactor_detach(reactor, entry);
+	entry->fn(entry->context, NULL, entry->data);
+}
+
+/* Mark an entry as dead and stop polling its descriptor; the entry itself is
+ * freed by dvb_reactor_reap(), as it may still be referenced by a pending
+ * epoll event.
+ */
+static void
+dvb_reactor_detach(dvb_reactor_t *reactor, dvb_reactor_entry_t *entry)
+{
+	if(entry->polled)
+	{
+		epoll_ctl(reactor->epfd, EPOLL_CTL_DEL, entry->context->fd, NULL);
+	}
+	entry->dead = 1;
+}
+
+static void
+dvb_reactor_reap(dvb_reactor_t *reactor)
+{
+	size_t i;
+
+	for(i = 0; i < reactor->nentries; )
+	{
+		if(reactor->entries[i]->dead)
+		{
+			free(reactor->entries[i]);
+			reactor->nentries--;
+			reactor->entries[i] = reactor->entries[reactor->nentries];
+			continue;
+		}
+		i++;
+	}
+}
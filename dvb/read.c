@@ -21,6 +21,7 @@
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <sys/ioctl.h>
 #include <signal.h>
 #include <unistd.h>
@@ -29,10 +30,16 @@
 
 #include "p_dvb.h"
 
+static uint8_t *dvb_demux_ring_ptr(dvb_demux_t *context, size_t len);
+static dvb_table_t *dvb_demux_read_buffer(dvb_demux_t *context);
+static int dvb_demux_read_fill(dvb_demux_t *context);
+static dvb_table_t *dvb_demux_read_ts(dvb_demux_t *context);
 static dvb_table_t *dvb_demux_read_section(dvb_demux_t *context, dvb_section_t *section);
-static dvb_table_t *dvb_demux_section_add(dvb_demux_t *context, int table_id, int current_next, uint32_t identifier, int version, int secnum, int last, dvb_section_t *section);
-static dvb_table_t *dvb_demux_table_alloc(dvb_demux_t *context, int table_id, int current_next, uint32_t identifier, int count);
+static dvb_table_t *dvb_demux_section_add(dvb_demux_t *context, const dvb_table_t *key, int version, int secnum, int last, dvb_section_t *section);
+static dvb_table_t *dvb_demux_table_find(dvb_demux_t *context, const dvb_table_t *key);
+static dvb_table_t *dvb_demux_table_alloc(dvb_demux_t *context, const dvb_table_t *key, int count);
 static void dvb_demux_table_reset(dvb_demux_t *context, dvb_table_t *table, int count);
+static dvb_section_t *dvb_demux_section_copy(dvb_demux_t *context, dvb_section_t *section);
 
 /* Read until either 'until', or the specified timeout is reached, or a complete
  * SI table (a fully-populated set of sections) is read. When it is, return it.
@@ -51,71 +58,14 @@ dvb_demux_read(dvb_demux_t *context, time_t until)
 	time_t now;
 	struct timeval tv, *tvp;
 	fd_set fds;
-	int r, nbytes, noioctl, need;
-	size_t bufstart, bufend, bsize, l;
-	uint8_t *p;
-	dvb_section_t *section;
+	int r;
 	dvb_table_t *s;
 
-	need = 3;
-	bufstart = bufend = 0;
-	noioctl = 1;
 	while(1)
 	{
-		if(bufstart >= 1024)
+		if((s = dvb_demux_read_buffer(context)))
 		{
-			DBG(9, fprintf(stderr, "[dvb_read: buffer shifted far enough; moving back]\n"));
-			memmove(context->buf, &(context->buf[bufstart]), bufend - bufstart);
-			bufend -= bufstart;
-			bufstart = 0;
-		}
-		p = &(context->buf[bufstart]);
-		bsize = bufend - bufstart;
-		if(bsize < sizeof(si_tab_t))
-		{
-			need = sizeof(si_tab_t) - bsize;
-		}
-		else
-		{
-			DBG(9, fprintf(stderr, "[dvb_read: have minimum number of required bytes (%d - %d = %d)]\n", bufend, bufstart, bufend - bufstart));
-			DBG(9, fprintf(stderr, "[dvb_read: bytes: %02x %02x %02x %02x - %02x %02x %02x %02x]\n",
-						   context->buf[bufstart] & 0xFF, context->buf[bufstart + 1] & 0xFF, 
-						   context->buf[bufstart + 2] & 0xFF, context->buf[bufstart + 3] & 0xFF,
-						   context->buf[bufstart + 4] & 0xFF, context->buf[bufstart + 5] & 0xFF,
-						   context->buf[bufstart + 6] & 0xFF, context->buf[bufstart + 7] & 0xFF));
-			if(p[0] == 0 && p[1] == 0 && p[2] == 1)
-			{
-				/* PES packet */
-				DBG(9, fprintf(stderr, "[dvb_read: skipping PES packet]\n"));
-				bufstart = bufend = 0;
-				continue;
-			}
-			section = (void *) p;
-			l = GetSectionLength(&section->si);
-			DBG(9, fprintf(stderr, "[dvb_read: table_id = 0x%02x, section_length = %d]\n", GetTableId(&section->si), l));
-			if(bsize < l + sizeof(si_tab_t))
-			{
-				need = sizeof(si_tab_t) + l - bsize;
-			}
-			else
-			{
-				DBG(9, fprintf(stderr, "[dvb_read: have sufficient bytes]\n"));
-				if (dvb_crc32(p, l + sizeof(si_tab_t)) != 0)
-				{
-					DBG(5, fprintf(stderr, "Warning: dvb_read: CRC failed; shifting start\n"));
-					bufstart++;
-					continue;
-				}
-				s = dvb_demux_read_section(context, section);
-				bufstart = bufend;
-				if(s)
-				{
-					DBG(9, fprintf(stderr, "[dvb_read: have a complete section set]\n"));
-					return s;
-				}
-				DBG(9, fprintf(stderr, "[dvb_read: read a section, discarded or incomplete set; looping]\n"));
-				continue;
-			}
+			return s;
 		}
 		if(context->timeout && until)
 		{
@@ -155,6 +105,7 @@ dvb_demux_read(dvb_demux_t *context, time_t until)
 			tvp = NULL;
 		}
 		tv.tv_usec = 0;
+		FD_ZERO(&fds);
 		FD_SET(context->fd, &fds);
 		DBG(9, fprintf(stderr, "[dvb_read: waiting for data]\n"));
 		r = select(context->fd + 1, &fds, NULL, NULL, tvp);
@@ -167,82 +118,294 @@ dvb_demux_read(dvb_demux_t *context, time_t until)
 		{
 			break;
 		}
-		nbytes = need;
-		DBG(9, fprintf(stderr, "[dvb_read: %d bytes to read]\n", nbytes));
-		do
+		r = dvb_demux_read_fill(context);
+		if(r == -1 && errno == EWOULDBLOCK)
 		{
-			r = read(context->fd, &(context->buf[bufend]), nbytes);
+			/* Out of data */
+			DBG(9, fprintf(stderr, "[dvb_read: EWOULDBLOCK]\n"));
+			continue;
 		}
-		while(r == -1 && errno == EINTR);
-		if(r == -1)
+		if(r <= 0)
+		{
+			break;
+		}
+	}
+	DBG(9, fprintf(stderr, "[dvb_read: loop ended]\n"));
+	return NULL;
+}
+
+/* Process whatever can be read from the context without blocking, returning
+ * the first complete table, or NULL once no more data is immediately
+ * available. Any partially-read section is retained for the next call. This
+ * is intended for use where several contexts are being serviced by a single
+ * poll() loop; dvb_demux_eof() indicates whether the descriptor has been
+ * closed or has failed, in which case the context should no longer be polled.
+ */
+dvb_table_t *
+dvb_demux_read_nowait(dvb_demux_t *context)
+{
+	int r;
+	dvb_table_t *s;
+
+	while(1)
+	{
+		if((s = dvb_demux_read_buffer(context)))
+		{
+			return s;
+		}
+		r = dvb_demux_read_fill(context);
+		if(r == -1 && errno == EWOULDBLOCK)
+		{
+			return NULL;
+		}
+		if(r <= 0)
+		{
+			DBG(8, fprintf(stderr, "[dvb_read_nowait: end of input]\n"));
+			context->eof = 1;
+			return NULL;
+		}
+	}
+}
+
+int
+dvb_demux_eof(dvb_demux_t *context)
+{
+	return context->eof;
+}
+
+/* Return a pointer to len contiguous bytes at the tail of the ring, copying
+ * them to the scratch buffer if they wrap around its end.
+ */
+static uint8_t *
+dvb_demux_ring_ptr(dvb_demux_t *context, size_t len)
+{
+	size_t start, n;
+
+	start = context->tail & (DVB_DEMUX_RING - 1);
+	if(start + len <= DVB_DEMUX_RING)
+	{
+		return &(context->ring[start]);
+	}
+	n = DVB_DEMUX_RING - start;
+	memcpy(context->scratch, &(context->ring[start]), n);
+	memcpy(&(context->scratch[n]), context->ring, len - n);
+	return context->scratch;
+}
+
+/* Process as much of the buffered data as possible, returning as soon as a
+ * table is completed by it. NULL is returned once more data is needed.
+ */
+static dvb_table_t *
+dvb_demux_read_buffer(dvb_demux_t *context)
+{
+	size_t bsize, l;
+	uint8_t *p;
+	dvb_section_t *section;
+	dvb_table_t *s;
+
+	while(1)
+	{
+		bsize = context->head - context->tail;
+		if(context->ts)
 		{
-			if(errno == EWOULDBLOCK)
+			/* Raw transport stream: hand each complete packet to the
+			 * reassembler and process whatever sections it yields.
+			 */
+			if((s = dvb_demux_read_ts(context)))
+			{
+				return s;
+			}
+			if(bsize < DVB_TS_PACKET_SIZE)
+			{
+				return NULL;
+			}
+			p = dvb_demux_ring_ptr(context, DVB_TS_PACKET_SIZE);
+			if(dvb_ts_packet(context->ts, p))
+			{
+				DBG(5, fprintf(stderr, "Warning: dvb_read: lost transport stream sync; shifting start\n"));
+				context->tail++;
+			}
+			else
 			{
-				/* Out of data */
-				DBG(9, fprintf(stderr, "[dvb_read: EWOULDBLOCK]\n"));
-				continue;
+				context->tail += DVB_TS_PACKET_SIZE;
 			}
+			continue;
+		}
+		if(bsize < sizeof(si_tab_t))
+		{
+			return NULL;
+		}
+		p = dvb_demux_ring_ptr(context, sizeof(si_tab_t));
+		DBG(9, fprintf(stderr, "[dvb_read: have minimum number of required bytes (%d)]\n", (int) bsize));
+		if(p[0] == 0 && p[1] == 0 && p[2] == 1)
+		{
+			/* PES packet */
+			DBG(9, fprintf(stderr, "[dvb_read: skipping PES packet]\n"));
+			context->tail = context->head;
+			continue;
+		}
+		l = GetSectionLength(p) + sizeof(si_tab_t);
+		DBG(9, fprintf(stderr, "[dvb_read: table_id = 0x%02x, section_length = %d]\n", GetTableId(p), (int) l));
+		if(l > DVB_SECTION_MAX)
+		{
+			DBG(5, fprintf(stderr, "Warning: dvb_read: bogus section length %d; shifting start\n", (int) l));
+			context->tail++;
+			continue;
+		}
+		if(bsize < l)
+		{
+			return NULL;
+		}
+		DBG(9, fprintf(stderr, "[dvb_read: have sufficient bytes]\n"));
+		p = dvb_demux_ring_ptr(context, l);
+		if (dvb_crc32(p, l) != 0)
+		{
+			DBG(5, fprintf(stderr, "Warning: dvb_read: CRC failed; shifting start\n"));
+			context->tail++;
+			continue;
+		}
+		section = (void *) p;
+		context->tail += l;
+		if((s = dvb_demux_read_section(context, section)))
+		{
+			DBG(9, fprintf(stderr, "[dvb_read: have a complete section set]\n"));
+			return s;
+		}
+		DBG(9, fprintf(stderr, "[dvb_read: read a section, discarded or incomplete set; looping]\n"));
+	}
+}
+
+/* Fill as much of the free space in the ring as a single readv() will */
+static int
+dvb_demux_read_fill(dvb_demux_t *context)
+{
+	struct iovec iov[2];
+	size_t start, space;
+	int r, n;
+
+	start = context->head & (DVB_DEMUX_RING - 1);
+	space = DVB_DEMUX_RING - (context->head - context->tail);
+	iov[0].iov_base = &(context->ring[start]);
+	if(start + space <= DVB_DEMUX_RING)
+	{
+		iov[0].iov_len = space;
+		n = 1;
+	}
+	else
+	{
+		iov[0].iov_len = DVB_DEMUX_RING - start;
+		iov[1].iov_base = context->ring;
+		iov[1].iov_len = space - iov[0].iov_len;
+		n = 2;
+	}
+	DBG(9, fprintf(stderr, "[dvb_read: up to %d bytes to read]\n", (int) space));
+	do
+	{
+		r = readv(context->fd, iov, n);
+	}
+	while(r == -1 && errno == EINTR);
+	if(r == -1)
+	{
+		if(errno == EOVERFLOW)
+		{
+			/* The kernel's buffer overflowed and data was lost; the
+			 * next read will succeed.
+			 */
+			DBG(5, fprintf(stderr, "Warning: dvb_read: demux buffer overflow\n"));
+			errno = EWOULDBLOCK;
+		}
+		else if(errno != EWOULDBLOCK)
+		{
 			perror("dvb_read: read()");
-			break;
 		}
-		if(!r)
+		return -1;
+	}
+	if(!r)
+	{
+		DBG(9, fprintf(stderr, "[dvb_read: descriptor closed]\n"));
+		return 0;
+	}
+	DBG(9, fprintf(stderr, "[dvb_read: read %d bytes]\n", r));
+	context->head += r;
+	return r;
+}
+
+/* Process any sections remaining in the transport packet most recently passed
+ * to the reassembler, returning as soon as one completes a table.
+ */
+static dvb_table_t *
+dvb_demux_read_ts(dvb_demux_t *context)
+{
+	const uint8_t *p;
+	size_t l;
+	dvb_table_t *s;
+
+	while((p = dvb_ts_section(context->ts, &l)))
+	{
+		if(dvb_crc32(p, l) != 0)
 		{
-			DBG(9, fprintf(stderr, "[dvb_read: descriptor closed]\n"));
-			break;
+			DBG(5, fprintf(stderr, "Warning: dvb_read: CRC failed on reassembled section; discarding\n"));
+			continue;
+		}
+		if((s = dvb_demux_read_section(context, (dvb_section_t *) (void *) p)))
+		{
+			DBG(9, fprintf(stderr, "[dvb_read: have a complete section set]\n"));
+			return s;
 		}
-		DBG(9, fprintf(stderr, "[dvb_read: read %d bytes]\n", r));
-		bufend += r;
 	}
-	DBG(9, fprintf(stderr, "[dvb_read: loop ended]\n"));
 	return NULL;
 }
 
 static dvb_table_t *
 dvb_demux_read_section(dvb_demux_t *context, dvb_section_t *section)
 {
-	int versioned, cni;
-	dvb_table_t *table;
+	int versioned;
+	dvb_table_t key, *table;
 	dvb_section_t *p;
-	size_t i;
-	uint32_t identifier;
 
 	DBG(8, fprintf(stderr, "[read_section: table_id is 0x%02x]\n", section->si.table_id));
+	memset(&key, 0, sizeof(key));
+	key.table_id = GetTableId(section);
+	key.current_next_indicator = 1;
 	versioned = 1;
-	identifier = 0;
-	cni = 1;
-	switch(GetTableId(section))
+	switch(key.table_id)
 	{
 	case 0x00: /* PAT */
-		identifier = HILO(section->pat.transport_stream_id);
-		cni = section->pat.current_next_indicator;
+		key.table_id_extension = HILO(section->pat.transport_stream_id);
+		key.transport_stream_id = key.table_id_extension;
+		key.identifier = key.table_id_extension;
+		key.current_next_indicator = section->pat.current_next_indicator;
 		break;
 	case 0x02: /* PMT */
-		identifier = HILO(section->pmt.program_number);
-		cni = section->pmt.current_next_indicator;
+		key.table_id_extension = HILO(section->pmt.program_number);
+		key.identifier = key.table_id_extension;
+		key.current_next_indicator = section->pmt.current_next_indicator;
 		break;
 	case 0x03: /* TSDT */
 		break;
 	case 0x40: /* NIT (this network) */
 	case 0x41: /* NIT (other network) */
-		identifier = HILO(section->nit.network_id);
-		cni = section->nit.current_next_indicator;
+		key.table_id_extension = HILO(section->nit.network_id);
+		key.identifier = key.table_id_extension;
+		key.current_next_indicator = section->nit.current_next_indicator;
 		break;
 	case 0x42: /* SDT (this TS) */
 	case 0x46: /* SDT (other TS) */
-		identifier = ((uint32_t) HILO(section->sdt.original_network_id)) << 16 | HILO(section->sdt.transport_stream_id);
-		cni = section->sdt.current_next_indicator;
-		break;
-	case 0x4E: /* EIT (this TS, now & next) */
-	case 0x4F: /* EIT (other TS, now & next) */
-		identifier = ((uint32_t) HILO(section->sdt.original_network_id)) << 16 | HILO(section->sdt.transport_stream_id);
-		cni = section->eit.current_next_indicator;
+		key.table_id_extension = HILO(section->sdt.transport_stream_id);
+		key.transport_stream_id = key.table_id_extension;
+		key.original_network_id = HILO(section->sdt.original_network_id);
+		key.identifier = ((uint32_t) key.original_network_id) << 16 | key.transport_stream_id;
+		key.current_next_indicator = section->sdt.current_next_indicator;
 		break;
 	default:
-		if(GetTableId(section) >= 0x50 && GetTableId(section) <= 0x6F)
+		if(key.table_id >= 0x4E && key.table_id <= 0x6F)
 		{
-			/* EITs */
-			identifier = ((uint32_t) HILO(section->sdt.original_network_id)) << 16 | HILO(section->sdt.transport_stream_id);
-			cni = section->eit.current_next_indicator;
+			/* EITs: each service's schedule is a separate sub-table */
+			key.table_id_extension = HILO(section->eit.service_id);
+			key.transport_stream_id = HILO(section->eit.transport_stream_id);
+			key.original_network_id = HILO(section->eit.original_network_id);
+			key.identifier = ((uint32_t) key.original_network_id) << 16 | key.transport_stream_id;
+			key.current_next_indicator = section->eit.current_next_indicator;
 		}
 		else
 		{
@@ -254,120 +417,217 @@ dvb_demux_read_section(dvb_demux_t *context, dvb_section_t *section)
 		/* Versioned tables all have the same set of leading bytes */
 		DBG(8, fprintf(stderr, "[read_section: table is versioned; version=%02x, secno=%d, last=%d]\n",
 					   section->pat.version_number, section->pat.section_number, section->pat.last_section_number));
-		table = dvb_demux_section_add(
-			context,
-			GetTableId(section),
-			cni,
-			identifier,
-			section->pat.version_number,
-			section->pat.section_number,
-			section->pat.last_section_number,
-			section);
-		for(i = 0; i < table->nsections; i++)
-		{
-			if(!table->sections[i])
-			{
-				DBG(8, fprintf(stderr, "[read_section: section %d of %d is absent]\n", (int) i, (int) table->nsections - 1 ));
-				break;
-			}
+		if(NULL == (table = dvb_demux_section_add(
+						context,
+						&key,
+						section->pat.version_number,
+						section->pat.section_number,
+						section->pat.last_section_number,
+						section)))
+		{
+			return NULL;
 		}
-		if(i == table->nsections)
+		if(key.table_id >= 0x4E && key.table_id <= 0x6F && table->version_number == section->eit.version_number)
+		{
+			/* (Unless it was a stale section which was discarded) */
+			dvb_section_mark_segment(table->received, &(table->remaining), table->nsections, section);
+			table->last_table_id = GetLastTableId(section);
+		}
+		if(!table->remaining)
 		{
 			/* Complete set of sections */
 			DBG(8, fprintf(stderr, "[read_section: all %d sections are present]\n", (int) table->nsections));
+			dvb_demux_filter_complete(context, table);
 			return table;
 		}
 		/* Not ready yet */
+		DBG(8, fprintf(stderr, "[read_section: %d of %d sections outstanding]\n", (int) table->remaining, (int) table->nsections));
 		return NULL;
 	}
 	DBG(8, fprintf(stderr, "[read_section: table is not versioned]\n"));
 	/* dvb_demux_section_replace() */
-	table = dvb_demux_table_alloc(context, GetTableId(section), cni, identifier, 1);
-	if(NULL == (p = calloc(1, GetSectionLength(section) + sizeof(si_tab_t))))
+	if(NULL == (table = dvb_demux_table_alloc(context, &key, 1)))
+	{
+		return NULL;
+	}
+	if(NULL == (p = dvb_demux_section_copy(context, section)))
 	{
 		return NULL;
 	} 
-	memcpy(p, section, GetSectionLength(section) + sizeof(si_tab_t));
 	table->sections[0] = p;
+	dvb_section_mark(table->received, &(table->remaining), 0);
 	return table;
 }
 
 static dvb_table_t *
-dvb_demux_section_add(dvb_demux_t *context, int table_id, int current_next, uint32_t identifier, int version, int secnum, int last, dvb_section_t *section)
+dvb_demux_section_add(dvb_demux_t *context, const dvb_table_t *key, int version, int secnum, int last, dvb_section_t *section)
 {
-	size_t i;
 	dvb_table_t *table;
 	dvb_section_t *p;
+	int delta;
 
-	for(i = 0; i < context->ntables; i++)
+	if((table = dvb_demux_table_find(context, key)))
 	{
-		if(context->tables[i].table_id == table_id && context->tables[i].current_next_indicator == current_next && context->tables[i].identifier == identifier)
+		/* version_number is 5 bits and wraps, so a version is newer if it
+		 * is less than half the range ahead of the one we hold
+		 */
+		delta = (table->version_number < 0 ? 1 : (version - table->version_number) & 0x1f);
+		if(delta > 15)
 		{
-			table = &(context->tables[i]);
-			if(table->version_number > version)
-			{
-				/* Discard the new one */
-				return table;
-			}
-			else if(table->version_number < version)
-			{
-				/* Discard the previous one */
-				dvb_demux_table_reset(context, table, last + 1);
-				table->version_number = version;
-			}
-			/* We've previously (at least partially) read this one */
-			if(table->sections[secnum])
-			{
-				return table;
-			}
-			if(NULL == (p = calloc(1, GetSectionLength(section) + sizeof(si_tab_t))))
-			{
-				return NULL;
-			} 
-			memcpy(p, section, GetSectionLength(section) + sizeof(si_tab_t));
-			table->sections[secnum] = p;
+			/* Discard the new one */
 			return table;
 		}
+		else if(delta || table->nsections != (size_t) last + 1)
+		{
+			/* Discard the previous one */
+			dvb_demux_table_reset(context, table, last + 1);
+			table->version_number = version;
+		}
+		/* We've previously (at least partially) read this one */
+		if(secnum > last || DVB_TABLE_HAS(table, secnum))
+		{
+			return table;
+		}
+	}
+	else
+	{
+		/* No match, add a new entry */
+		DBG(9, fprintf(stderr, "[section_add: adding a new table for section with table_id = 0x%02x]\n", key->table_id));
+		if(NULL == (table = dvb_demux_table_alloc(context, key, last + 1)))
+		{
+			return NULL;
+		}
+		table->version_number = version;
+	}
+	if(secnum > last)
+	{
+		return table;
 	}
-	/* No match, add a new entry */
-	DBG(9, fprintf(stderr, "[section_add: adding a new table for section with table_id = 0x%02x]\n", table_id));
-	table = dvb_demux_table_alloc(context, table_id, current_next, identifier, last + 1);
-	table->version_number = version;
-	if(NULL == (p = calloc(1, GetSectionLength(section) + sizeof(si_tab_t))))
+	if(NULL == (p = dvb_demux_section_copy(context, section)))
 	{
 		return NULL;
 	} 
-	memcpy(p, section, GetSectionLength(section) + sizeof(si_tab_t));
 	table->sections[secnum] = p;
+	dvb_section_mark(table->received, &(table->remaining), secnum);
 	return table;
 }
 
+/* Copy a section from the input buffer into the context's arena */
+static dvb_section_t *
+dvb_demux_section_copy(dvb_demux_t *context, dvb_section_t *section)
+{
+	dvb_section_t *p;
+	size_t len;
+
+	len = GetSectionLength(section) + sizeof(si_tab_t);
+	if(NULL == (p = dvb_arena_alloc(&(context->arena), len)))
+	{
+		return NULL;
+	}
+	memcpy(p, section, len);
+	return p;
+}
+
+/* Record a section as accounted for in a received bitmap, returning 1 if it
+ * wasn't already
+ */
+int
+dvb_section_mark(uint32_t *received, size_t *remaining, int secnum)
+{
+	if(DVB_SECTION_HAS(received, secnum))
+	{
+		return 0;
+	}
+	received[secnum >> 5] |= (UINT32_C(1) << (secnum & 31));
+	(*remaining)--;
+	return 1;
+}
+
+/* EIT sub-tables are divided into segments of eight sections, each of which
+ * is only populated up to its segment_last_section_number; the remainder of
+ * each segment will never be transmitted and so mustn't be waited for.
+ */
+void
+dvb_section_mark_segment(uint32_t *received, size_t *remaining, size_t nsections, dvb_section_t *section)
+{
+	int secnum, seglast, end;
+
+	secnum = section->eit.section_number;
+	seglast = GetSegmentLastSectionNumber(section);
+	end = (secnum | 7);
+	if(end >= (int) nsections)
+	{
+		end = nsections - 1;
+	}
+	if(seglast < secnum)
+	{
+		/* Bogus: the section lies outside its own segment */
+		seglast = secnum;
+	}
+	for(secnum = seglast + 1; secnum <= end; secnum++)
+	{
+		dvb_section_mark(received, remaining, secnum);
+	}
+}
+
+/* The sub-tables are held in an open-addressed hash table of pointers, so
+ * that a table, once allocated, never moves.
+ */
+static size_t
+dvb_demux_table_hash(const void *entry)
+{
+	const dvb_table_t *key = (const dvb_table_t *) entry;
+
+	return dvb_hash_mix((uint64_t) key->table_id |
+						((uint64_t) key->current_next_indicator << 8) |
+						((uint64_t) key->table_id_extension << 16) |
+						((uint64_t) key->transport_stream_id << 32) |
+						((uint64_t) key->original_network_id << 48));
+}
+
+static int
+dvb_demux_table_match(const void *entry, const void *k)
+{
+	const dvb_table_t *table = (const dvb_table_t *) entry, *key = (const dvb_table_t *) k;
+
+	return table->table_id == key->table_id &&
+		table->table_id_extension == key->table_id_extension &&
+		table->transport_stream_id == key->transport_stream_id &&
+		table->original_network_id == key->original_network_id &&
+		table->current_next_indicator == key->current_next_indicator;
+}
+
 static dvb_table_t *
-dvb_demux_table_alloc(dvb_demux_t *context, int table_id, int current_next, uint32_t identifier, int count)
+dvb_demux_table_find(dvb_demux_t *context, const dvb_table_t *key)
 {
-	size_t i;
-	dvb_table_t *p, *l;
+	return (dvb_table_t *) dvb_hash_find(&(context->tables), dvb_demux_table_hash(key), dvb_demux_table_match, key);
+}
+
+static dvb_table_t *
+dvb_demux_table_alloc(dvb_demux_t *context, const dvb_table_t *key, int count)
+{
+	dvb_table_t *p;
 	
-	for(i = 0; i < context->ntables; i++)
+	if((p = dvb_demux_table_find(context, key)))
 	{
-		if(context->tables[i].table_id == table_id && context->tables[i].current_next_indicator == current_next && context->tables[i].identifier == identifier)
-		{
-			p = &(context->tables[i]);
-			dvb_demux_table_reset(context, p, count);
-			return p;
-		}
+		dvb_demux_table_reset(context, p, count);
+		return p;
 	}
-	if(NULL == (l = realloc(context->tables, sizeof(dvb_table_t) * (context->ntables + 1))))
+	if(NULL == (p = calloc(1, sizeof(dvb_table_t))))
 	{
 		return NULL;
 	}
-	context->tables = l;
-	p = &(l[context->ntables]);
-	context->ntables++;
-	memset(p, 0, sizeof(dvb_table_t));
-	p->table_id = table_id;
-	p->current_next_indicator = current_next;
-	p->identifier = identifier;
+	p->table_id = key->table_id;
+	p->current_next_indicator = key->current_next_indicator;
+	p->identifier = key->identifier;
+	p->table_id_extension = key->table_id_extension;
+	p->transport_stream_id = key->transport_stream_id;
+	p->original_network_id = key->original_network_id;
+	if(dvb_hash_insert(&(context->tables), p, dvb_demux_table_hash))
+	{
+		free(p);
+		return NULL;
+	}
 	dvb_demux_table_reset(context, p, count);
 	return p;
 }
@@ -377,14 +637,43 @@ dvb_demux_table_reset(dvb_demux_t *context, dvb_table_t *table, int count)
 {
 	size_t i;
 
-	(void) context;
-	
 	for(i = 0; i < table->nsections; i++)
 	{
-		free(table->sections[i]);
+		if(table->sections[i])
+		{
+			dvb_arena_free(&(context->arena), table->sections[i], GetSectionLength(table->sections[i]) + sizeof(si_tab_t));
+		}
 	}
-	free(table->sections);
 	table->version_number = -1;
-	table->nsections = count;
-	table->sections = calloc(count, sizeof(dvb_table_t *));
+	if(table->nsections == (size_t) count && count)
+	{
+		/* Re-use the existing array */
+		memset(table->sections, 0, sizeof(dvb_section_t *) * count);
+	}
+	else
+	{
+		free(table->sections);
+		table->nsections = count;
+		table->sections = (count ? calloc(count, sizeof(dvb_section_t *)) : NULL);
+	}
+	memset(table->received, 0, sizeof(table->received));
+	table->remaining = count;
+}
+
+/* Free all of the tables associated with a context */
+void
+dvb_demux_tables_free(dvb_demux_t *context)
+{
+	size_t i;
+	dvb_table_t *table;
+
+	for(i = 0; i < context->tables.size; i++)
+	{
+		if((table = (dvb_table_t *) context->tables.slots[i]))
+		{
+			dvb_demux_table_reset(context, table, 0);
+			free(table);
+		}
+	}
+	dvb_hash_clear(&(context->tables));
 }
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2010 Mo McRoberts.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Tracks the acquisition of EIT schedules (table_ids 0x50-0x5F for the
+ * actual transport stream, 0x60-0x6F for others), so that a grab can stop as
+ * soon as everything which has been announced has been received rather than
+ * waiting for a fixed period.
+ *
+ * Each service's schedule is spread across the table_ids from the first of
+ * its group up to the segment_last_table_id announced in its sections, and
+ * each of those sub-tables is divided into segments of eight sections, of
+ * which only those up to segment_last_section_number are ever transmitted.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "p_dvb.h"
+
+#define DVB_SCHEDULE_TABLES             32
+
+typedef struct dvb_schedule_service_struct dvb_schedule_service_t;
+typedef struct dvb_schedule_table_struct dvb_schedule_table_t;
+
+/* Progress of a single table_id of a service's schedule */
+struct dvb_schedule_table_struct
+{
+	int version_number;
+	size_t nsections;
+	uint32_t received[8];
+	size_t remaining;
+};
+
+struct dvb_schedule_service_struct
+{
+	/* original_network_id << 32 | transport_stream_id << 16 | service_id */
+	uint64_t key;
+	/* The last table_id announced for each group, or -1 if none has been
+	 * seen for that group
+	 */
+	int last_table_id[2];
+	/* Bit n is set once table_id 0x50 + n is complete */
+	uint32_t complete;
+	int done;
+	/* Allocated as each table_id is first seen */
+	dvb_schedule_table_t *tables[DVB_SCHEDULE_TABLES];
+};
+
+struct dvb_schedule_struct
+{
+	dvb_hash_t services;
+	/* The number of services whose schedules are not yet complete */
+	size_t incomplete;
+	/* Set once a section has been received a second time since the last
+	 * new service was seen: until the carousel has come round again, there
+	 * may be services which haven't yet been announced at all
+	 */
+	int repeated;
+};
+
+static dvb_schedule_service_t *dvb_schedule_service(dvb_schedule_t *schedule, int onid, int tsid, int sid);
+static void dvb_schedule_update(dvb_schedule_t *schedule, dvb_schedule_service_t *service);
+
+dvb_schedule_t *
+dvb_schedule_new(void)
+{
+	return calloc(1, sizeof(dvb_schedule_t));
+}
+
+void
+dvb_schedule_delete(dvb_schedule_t *schedule)
+{
+	dvb_schedule_service_t *service;
+	size_t i;
+	int c;
+
+	for(i = 0; i < schedule->services.size; i++)
+	{
+		if((service = (dvb_schedule_service_t *) schedule->services.slots[i]))
+		{
+			for(c = 0; c < DVB_SCHEDULE_TABLES; c++)
+			{
+				free(service->tables[c]);
+			}
+			free(service);
+		}
+	}
+	dvb_hash_clear(&(schedule->services));
+	free(schedule);
+}
+
+/* Declare that a service is expected to carry a schedule (for example,
+ * because its EIT_schedule_flag is set in the SDT), so that the schedule
+ * won't be considered complete until it has been received.
+ */
+int
+dvb_schedule_expect(dvb_schedule_t *schedule, int onid, int tsid, int sid)
+{
+	if(NULL == dvb_schedule_service(schedule, onid, tsid, sid))
+	{
+		return -1;
+	}
+	return 0;
+}
+
+/* Account for an EIT section. Returns 1 if every schedule announced so far
+ * is now complete (see dvb_schedule_complete()), 0 if not, or -1 on error. Sections which aren't part of
+ * a current schedule are ignored.
+ */
+int
+dvb_schedule_add(dvb_schedule_t *schedule, dvb_section_t *section)
+{
+	dvb_schedule_service_t *service;
+	dvb_schedule_table_t *table;
+	int tid, group, c, secnum;
+
+	tid = section->si.table_id;
+	if(tid < 0x50 || tid > 0x6F || !section->eit.current_next_indicator)
+	{
+		return dvb_schedule_complete(schedule);
+	}
+	if(NULL == (service = dvb_schedule_service(schedule,
+											   HILO(section->eit.original_network_id),
+											   HILO(section->eit.transport_stream_id),
+											   GetServiceId(section))))
+	{
+		return -1;
+	}
+	c = tid - 0x50;
+	group = c >> 4;
+	if(NULL == (table = service->tables[c]))
+	{
+		if(NULL == (table = calloc(1, sizeof(dvb_schedule_table_t))))
+		{
+			return -1;
+		}
+		table->version_number = -1;
+		service->tables[c] = table;
+	}
+	if(table->version_number != section->eit.version_number ||
+	   table->nsections != (size_t) section->eit.last_section_number + 1)
+	{
+		/* New (or changed) sub-table: start again */
+		DBG(8, fprintf(stderr, "[dvb_schedule_add: table 0x%02x of service %04x is now version %d]\n", tid, GetServiceId(section), section->eit.version_number));
+		table->version_number = section->eit.version_number;
+		table->nsections = section->eit.last_section_number + 1;
+		memset(table->received, 0, sizeof(table->received));
+		table->remaining = table->nsections;
+		service->complete &= ~(UINT32_C(1) << c);
+	}
+	secnum = section->eit.section_number;
+	if(secnum < (int) table->nsections)
+	{
+		if(!dvb_section_mark(table->received, &(table->remaining), secnum))
+		{
+			schedule->repeated = 1;
+		}
+		dvb_section_mark_segment(table->received, &(table->remaining), table->nsections, section);
+	}
+	if(!table->remaining)
+	{
+		service->complete |= (UINT32_C(1) << c);
+	}
+	if(GetLastTableId(section) >= (group << 4) + 0x50 && GetLastTableId(section) <= (group << 4) + 0x5F)
+	{
+		service->last_table_id[group] = GetLastTableId(section);
+	}
+	else if(service->last_table_id[group] < tid)
+	{
+		/* Bogus: assume at least this table_id is present */
+		service->last_table_id[group] = tid;
+	}
+	dvb_schedule_update(schedule, service);
+	return dvb_schedule_complete(schedule);
+}
+
+/* Returns 1 if the schedule of every service seen (or expected) has been
+ * received in full, and the carousel has since begun to repeat
+ */
+int
+dvb_schedule_complete(dvb_schedule_t *schedule)
+{
+	return schedule->services.count && !schedule->incomplete && schedule->repeated;
+}
+
+/* Re-evaluate whether a service's schedule is complete */
+static void
+dvb_schedule_update(dvb_schedule_t *schedule, dvb_schedule_service_t *service)
+{
+	uint32_t need;
+	int group, done;
+
+	need = 0;
+	for(group = 0; group < 2; group++)
+	{
+		if(service->last_table_id[group] != -1)
+		{
+			/* Every table_id from the start of the group to the last */
+			need |= ((UINT32_C(2) << (service->last_table_id[group] - 0x50)) - 1) & (UINT32_C(0xFFFF) << (group << 4));
+		}
+	}
+	done = (need && (service->complete & need) == need);
+	if(done && !service->done)
+	{
+		DBG(5, fprintf(stderr, "[dvb_schedule_update: schedule for service %04x is complete]\n", (int) (service->key & 0xFFFF)));
+		schedule->incomplete--;
+	}
+	else if(!done && service->done)
+	{
+		schedule->incomplete++;
+	}
+	service->done = done;
+}
+
+static size_t
+dvb_schedule_hash(const void *entry)
+{
+	return dvb_hash_mix(((const dvb_schedule_service_t *) entry)->key);
+}
+
+static int
+dvb_schedule_match(const void *entry, const void *key)
+{
+	return ((const dvb_schedule_service_t *) entry)->key == *(const uint64_t *) key;
+}
+
+/* Locate a service, adding it if it hasn't been seen before */
+static dvb_schedule_service_t *
+dvb_schedule_service(dvb_schedule_t *schedule, int onid, int tsid, int sid)
+{
+	dvb_schedule_service_t *p;
+	uint64_t key;
+
+	key = ((uint64_t) onid << 32) | ((uint64_t) tsid << 16) | (uint64_t) sid;
+	if((p = (dvb_schedule_service_t *) dvb_hash_find(&(schedule->services), dvb_hash_mix(key), dvb_schedule_match, &key)))
+	{
+		return p;
+	}
+	if(NULL == (p = calloc(1, sizeof(dvb_schedule_service_t))))
+	{
+		return NULL;
+	}
+	p->key = key;
+	p->last_table_id[0] = -1;
+	p->last_table_id[1] = -1;
+	if(dvb_hash_insert(&(schedule->services), p, dvb_schedule_hash))
+	{
+		free(p);
+		return NULL;
+	}
+	schedule->incomplete++;
+	schedule->repeated = 0;
+	return p;
+}
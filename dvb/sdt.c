@@ -65,6 +65,7 @@ dvb_parse_sdt(dvb_table_t *table, dvb_callbacks_t *callbacks)
 			svc = service_add_dvb(GetSDTOriginalNetworkId(sdt), GetSDTTransportStreamId(sdt), HILO(service->service_id));
 			mux = mux_locate_add_dvb(GetSDTOriginalNetworkId(sdt), GetSDTTransportStreamId(sdt));
 			service_set_mux(svc, mux);
+			service_set_eit_schedule(svc, service->eit_schedule_flag);
 			DBG(9, fprintf(stderr, "[dvb_parse_sdt:%d: there are %u bytes of descriptors]\n", i, ndescr));
 			if(!ndescr)
 			{
@@ -114,10 +115,7 @@ dvb_parse_sdt(dvb_table_t *table, dvb_callbacks_t *callbacks)
 				}
 			}
 			DBG(5, fprintf(stderr, "[dvb_parse_sdt:%d: service description complete]\n", i));
-			if(callbacks && callbacks->service)
-			{
-				callbacks->service(svc, callbacks->service_data);
-			}
+			dvb_callbacks_service(callbacks, svc);
 		}
 	}
 	return 0;
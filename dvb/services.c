@@ -16,21 +16,35 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
 
 #include "services.h"
 #include "multiplexes.h"
+#include "intern.h"
+#include "hash.h"
 
 #define SERVICE_URI_SIZE                128
 
+/* DVB services are indexed by their packed (onid, tsid, sid) triplet, and
+ * their URIs are only formatted when asked for; services with any other kind
+ * of URI are located by a linear search.
+ */
 struct service_struct
 {
+	/* Empty for a DVB service until service_uri() is called */
 	char uri[SERVICE_URI_SIZE];
+	/* original_network_id << 32 | transport_stream_id << 16 | service_id */
+	uint64_t key;
+	int dvb;
 	char name[128];
 	char provider[128];
-	char authority[128];
+	/* Interned, as it is shared by the CRIDs of every event */
+	const char *authority;
 	service_type_t type;
+	/* The EIT_schedule_flag from the SDT */
+	int eit_schedule;
 	void *data;
 	int version;
 	mux_t *mux;
@@ -38,19 +52,28 @@ struct service_struct
 
 static size_t nservices, nservalloc;
 static service_t **services;
+static dvb_hash_t hash;
 
 static service_t *service_alloc(void);
+static int service_parse_dvb(const char *uri, uint64_t *key);
+static service_t *service_find(uint64_t key);
+static int service_insert(service_t *service);
 
 service_t *
 service_add(const char *uri)
 {
 	service_t *p;
+	uint64_t key;
 
 	if(strlen(uri) >= SERVICE_URI_SIZE)
 	{
 		errno = EINVAL;
 		return NULL;
 	}
+	if(!service_parse_dvb(uri, &key))
+	{
+		return service_add_dvb((int) (key >> 32), (int) ((key >> 16) & 0xFFFF), (int) (key & 0xFFFF));
+	}
 	if(NULL == (p = service_locate(uri)))
 	{
 		if(NULL == (p = service_alloc()))
@@ -66,10 +89,25 @@ service_add(const char *uri)
 service_t *
 service_add_dvb(int original_network_id, int transport_stream_id, int service_id)
 {
-	char uri[64];
-	
-	sprintf(uri, "dvb://%04x.%04x.%04x", original_network_id, transport_stream_id, service_id);
-	return service_add(uri);
+	service_t *p;
+	uint64_t key;
+
+	key = ((uint64_t) original_network_id << 32) | ((uint64_t) transport_stream_id << 16) | (uint64_t) service_id;
+	if(NULL == (p = service_find(key)))
+	{
+		if(NULL == (p = service_alloc()))
+		{
+			return NULL;
+		}
+		p->key = key;
+		p->dvb = 1;
+		if(service_insert(p))
+		{
+			return NULL;
+		}
+	}
+	service_reset(p);
+	return p;
 }
 
 void
@@ -79,6 +117,8 @@ service_reset(service_t *service)
 
 	memset(&p, 0, sizeof(service_t));
 	strcpy(p.uri, service->uri);
+	p.key = service->key;
+	p.dvb = service->dvb;
 	p.data = service->data;
 	p.version = -1;
 	p.type = ST_RESERVED_FF;
@@ -89,10 +129,15 @@ service_t *
 service_locate(const char *uri)
 {
 	size_t i;
-	
+	uint64_t key;
+
+	if(!service_parse_dvb(uri, &key))
+	{
+		return service_find(key);
+	}
 	for(i = 0; i < nservices; i++)
 	{
-		if(services[i] && !strcmp(services[i]->uri, uri))
+		if(services[i] && !services[i]->dvb && !strcmp(services[i]->uri, uri))
 		{
 			return services[i];
 		}
@@ -103,10 +148,7 @@ service_locate(const char *uri)
 service_t *
 service_locate_dvb(int original_network_id, int transport_stream_id, int service_id)
 {
-	char uri[64];
-	
-	sprintf(uri, "dvb://%04x.%04x.%04x", original_network_id, transport_stream_id, service_id);
-	return service_locate(uri);
+	return service_find(((uint64_t) original_network_id << 32) | ((uint64_t) transport_stream_id << 16) | (uint64_t) service_id);
 }
 
 /* Locate a service and return it as-is if it already exist, or else create
@@ -127,15 +169,22 @@ service_locate_add(const char *uri)
 service_t *
 service_locate_add_dvb(int original_network_id, int transport_stream_id, int service_id)
 {
-	char uri[64];
+	service_t *s;
 	
-	sprintf(uri, "dvb://%04x.%04x.%04x", original_network_id, transport_stream_id, service_id);
-	return service_locate_add(uri);
+	if((s = service_locate_dvb(original_network_id, transport_stream_id, service_id)))
+	{
+		return s;
+	}
+	return service_add_dvb(original_network_id, transport_stream_id, service_id);
 }
 
 const char *
 service_uri(service_t *service)
 {
+	if(!service->uri[0] && service->dvb)
+	{
+		sprintf(service->uri, "dvb://%04x.%04x.%04x", (unsigned) (service->key >> 32), (unsigned) ((service->key >> 16) & 0xFFFF), (unsigned) (service->key & 0xFFFF));
+	}
 	return service->uri;
 }
 
@@ -175,6 +224,34 @@ service_mux(service_t *service)
 	return service->mux;
 }
 
+void
+service_set_eit_schedule(service_t *service, int flag)
+{
+	service->eit_schedule = flag;
+}
+
+int
+service_eit_schedule(service_t *service)
+{
+	return service->eit_schedule;
+}
+
+/* Obtain the (onid, tsid, sid) triplet of a DVB service; returns -1 if it
+ * isn't one
+ */
+int
+service_dvb(service_t *service, int *original_network_id, int *transport_stream_id, int *service_id)
+{
+	if(!service->dvb)
+	{
+		return -1;
+	}
+	*original_network_id = (int) (service->key >> 32);
+	*transport_stream_id = (int) ((service->key >> 16) & 0xFFFF);
+	*service_id = (int) (service->key & 0xFFFF);
+	return 0;
+}
+
 void
 service_set_name(service_t *service, const char *name)
 {
@@ -210,24 +287,20 @@ service_provider(service_t *service)
 void
 service_set_authority(service_t *service, const char *authority)
 {
-	strncpy(service->authority, authority, sizeof(service->authority) - 1);
+	service->authority = (authority && authority[0] ? intern_str(authority) : NULL);
 }
 
 const char *
 service_authority(service_t *service)
 {
-	if(service->authority[0])
-	{
-		return service->authority;
-	}
-	return NULL;
+	return service->authority;
 }
 
 void
 service_debug(service_t *service)
 {
-	fprintf(stderr, " name='%s', provider='%s', authority='%s', type=0x%02x\n", service->name, service->provider, service->authority, service->type);
-	fprintf(stderr, "      URI: %s\n", service->uri);
+	fprintf(stderr, " name='%s', provider='%s', authority='%s', type=0x%02x\n", service->name, service->provider, (service->authority ? service->authority : ""), service->type);
+	fprintf(stderr, "      URI: %s\n", service_uri(service));
 }
 
 void
@@ -267,6 +340,71 @@ service_alloc(void)
 	return p;
 }
 
+/* Parse a URI of the form dvb://onid.tsid.sid, as formatted by service_uri(),
+ * into a key; returns 0 on success or -1 if it isn't one.
+ */
+static int
+service_parse_dvb(const char *uri, uint64_t *key)
+{
+	size_t i;
+	int c;
+
+	if(strncmp(uri, "dvb://", 6) || strlen(uri) != 20)
+	{
+		return -1;
+	}
+	*key = 0;
+	for(i = 6; i < 20; i++)
+	{
+		c = uri[i];
+		if(i == 10 || i == 15)
+		{
+			if(c != '.')
+			{
+				return -1;
+			}
+			continue;
+		}
+		if(c >= '0' && c <= '9')
+		{
+			*key = (*key << 4) | (c - '0');
+		}
+		else if(c >= 'a' && c <= 'f')
+		{
+			*key = (*key << 4) | (c - 'a' + 10);
+		}
+		else
+		{
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static size_t
+service_hash(const void *entry)
+{
+	return dvb_hash_mix(((const service_t *) entry)->key);
+}
+
+static int
+service_match(const void *entry, const void *key)
+{
+	return ((const service_t *) entry)->key == *(const uint64_t *) key;
+}
+
+static service_t *
+service_find(uint64_t key)
+{
+	return (service_t *) dvb_hash_find(&hash, dvb_hash_mix(key), service_match, &key);
+}
+
+static int
+service_insert(service_t *service)
+{
+	return dvb_hash_insert(&hash, service, service_hash);
+}
+
 int
 service_foreach(int (*fn)(service_t *mux, void *data), void *data)
 {
@@ -87,6 +87,11 @@ const char *service_authority(service_t *service);
 void service_set_mux(service_t *service, mux_t *mux);
 mux_t *service_mux(service_t *service);
 
+void service_set_eit_schedule(service_t *service, int flag);
+int service_eit_schedule(service_t *service);
+
+int service_dvb(service_t *service, int *original_network_id, int *transport_stream_id, int *service_id);
+
 int service_foreach(int (*fn)(service_t *mux, void *data), void *data);
 
 void service_debug(service_t *service);
@@ -45,6 +45,10 @@ dvb_parse_si(dvb_table_t *table, dvb_callbacks_t *callbacks)
 		fprintf(stderr, "Warning: parse_dvb_si: bouquet_association_table (0x%02x) is not yet handled\n", table->table_id);
 		break;
 	}
+	if(table->table_id >= 0x4e && table->table_id <= 0x6f)
+	{
+		return dvb_parse_eit(table, callbacks);
+	}
 	fprintf(stderr, "Warning: parse_dvb_si: Unknown SI table 0x%02x (version=%02d)\n",
 			table->table_id, table->version_number);
 	return 0;
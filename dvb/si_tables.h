@@ -5,6 +5,9 @@
 ///                                                        ///
 //////////////////////////////////////////////////////////////
 
+#ifndef SI_TABLES_H_
+#define SI_TABLES_H_
+
 #include <stdint.h>
 
 // $Revision$
@@ -1652,3 +1655,5 @@ typedef struct descr_logical_channel_svc {
 	unsigned char logical_channel_number_lo;
 } descr_logical_channel_svc_t;
 #define DESCR_LCSVC_LEN sizeof(descr_logical_channel_svc_t)
+
+#endif /*!SI_TABLES_H_*/
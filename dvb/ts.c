@@ -0,0 +1,264 @@
+/*
+ * Copyright 2010 Mo McRoberts.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* MPEG-2 Transport Stream section reassembly (ISO 13818-1, 2.4.3 and 2.4.4) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "p_dvb.h"
+
+/* The PIDs carrying DVB SI which we're interested in by default:
+ * NIT, SDT/BAT, EIT and TDT/TOT.
+ */
+static const int dvb_ts_default_pids[] = { 0x0010, 0x0011, 0x0012, 0x0014 };
+
+static void dvb_ts_pid_reset(dvb_ts_pid_t *pid);
+
+/* Create a new section reassembler which will accept packets on the specified
+ * set of PIDs. If pids is NULL, the standard DVB SI PIDs are used.
+ */
+dvb_ts_t *
+dvb_ts_new(const int *pids, size_t npids)
+{
+	dvb_ts_t *p;
+	size_t i;
+
+	if(!pids)
+	{
+		pids = dvb_ts_default_pids;
+		npids = sizeof(dvb_ts_default_pids) / sizeof(int);
+	}
+	if(!npids || npids > 255)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+	if(NULL == (p = calloc(1, sizeof(dvb_ts_t))))
+	{
+		return NULL;
+	}
+	if(NULL == (p->pids = calloc(npids, sizeof(dvb_ts_pid_t))))
+	{
+		free(p);
+		return NULL;
+	}
+	for(i = 0; i < npids; i++)
+	{
+		if(pids[i] < 0 || pids[i] >= DVB_TS_MAX_PID)
+		{
+			free(p->pids);
+			free(p);
+			errno = EINVAL;
+			return NULL;
+		}
+		p->pids[i].pid = pids[i];
+		dvb_ts_pid_reset(&(p->pids[i]));
+		p->map[pids[i]] = i + 1;
+	}
+	p->npids = npids;
+	p->start = -1;
+	p->off = DVB_TS_PACKET_SIZE;
+	return p;
+}
+
+void
+dvb_ts_delete(dvb_ts_t *ts)
+{
+	if(ts)
+	{
+		free(ts->pids);
+		free(ts);
+	}
+}
+
+/* Load a 188-byte transport packet into the reassembler. Any sections which
+ * are completed by the packet can then be retrieved by calling dvb_ts_section()
+ * until it returns NULL. Returns -1 (and sets errno to EILSEQ) if the packet
+ * doesn't begin with a sync byte, in which case the caller should re-sync.
+ */
+int
+dvb_ts_packet(dvb_ts_t *ts, const uint8_t *packet)
+{
+	dvb_ts_pid_t *pid;
+	int pidnum, cc, afc;
+	size_t off;
+
+	if(packet[0] != DVB_TS_SYNC)
+	{
+		errno = EILSEQ;
+		return -1;
+	}
+	ts->cur = NULL;
+	ts->start = -1;
+	ts->off = DVB_TS_PACKET_SIZE;
+	if(packet[1] & 0x80)
+	{
+		/* transport_error_indicator is set */
+		DBG(9, fprintf(stderr, "[dvb_ts_packet: discarding errored packet]\n"));
+		return 0;
+	}
+	pidnum = ((packet[1] & 0x1F) << 8) | packet[2];
+	if(!ts->map[pidnum])
+	{
+		return 0;
+	}
+	pid = &(ts->pids[ts->map[pidnum] - 1]);
+	afc = (packet[3] >> 4) & 0x03;
+	cc = packet[3] & 0x0F;
+	if(!(afc & 0x01))
+	{
+		/* No payload; the continuity counter doesn't advance */
+		return 0;
+	}
+	if(pid->cc != -1)
+	{
+		if(cc == pid->cc)
+		{
+			/* Duplicate packet */
+			return 0;
+		}
+		if(cc != ((pid->cc + 1) & 0x0F))
+		{
+			DBG(5, fprintf(stderr, "[dvb_ts_packet: continuity error on PID 0x%04x (%d -> %d)]\n", pidnum, pid->cc, cc));
+			dvb_ts_pid_reset(pid);
+		}
+	}
+	pid->cc = cc;
+	off = 4;
+	if(afc & 0x02)
+	{
+		/* Skip the adaptation field */
+		off += 1 + packet[4];
+	}
+	if(packet[1] & 0x40)
+	{
+		/* payload_unit_start_indicator: a pointer_field precedes the payload,
+		 * indicating where the first new section begins; any bytes before that
+		 * point complete the section already in progress.
+		 */
+		if(off >= DVB_TS_PACKET_SIZE)
+		{
+			return 0;
+		}
+		ts->start = off + 1 + packet[off];
+		off++;
+		if(ts->start >= DVB_TS_PACKET_SIZE)
+		{
+			ts->start = -1;
+		}
+	}
+	if(off >= DVB_TS_PACKET_SIZE)
+	{
+		return 0;
+	}
+	memcpy(ts->packet, packet, DVB_TS_PACKET_SIZE);
+	ts->cur = pid;
+	ts->off = off;
+	return 0;
+}
+
+/* Return the next complete section contained in the current packet, if any.
+ * The returned buffer belongs to the reassembler and is only valid until the
+ * next call to dvb_ts_section() or dvb_ts_packet().
+ */
+const uint8_t *
+dvb_ts_section(dvb_ts_t *ts, size_t *len)
+{
+	dvb_ts_pid_t *pid;
+	size_t limit, n, want;
+
+	if(!(pid = ts->cur))
+	{
+		return NULL;
+	}
+	while(1)
+	{
+		if(ts->start != -1 && ts->off >= (size_t) ts->start)
+		{
+			/* Anything still pending before the start of a new section was
+			 * truncated; discard it.
+			 */
+			ts->off = ts->start;
+			ts->start = -1;
+			pid->active = 1;
+			pid->len = 0;
+			pid->need = 0;
+		}
+		if(ts->off >= DVB_TS_PACKET_SIZE)
+		{
+			break;
+		}
+		limit = (ts->start == -1 ? DVB_TS_PACKET_SIZE : (size_t) ts->start);
+		if(!pid->active)
+		{
+			/* Not currently in a section; skip to the next start, if any */
+			ts->off = limit;
+			continue;
+		}
+		if(!pid->len && ts->packet[ts->off] == 0xFF)
+		{
+			/* Stuffing: the remainder of the payload is padding */
+			pid->active = 0;
+			ts->off = limit;
+			continue;
+		}
+		want = (pid->need ? pid->need : sizeof(si_tab_t));
+		n = want - pid->len;
+		if(n > limit - ts->off)
+		{
+			n = limit - ts->off;
+		}
+		memcpy(&(pid->buf[pid->len]), &(ts->packet[ts->off]), n);
+		pid->len += n;
+		ts->off += n;
+		if(pid->len < want)
+		{
+			continue;
+		}
+		if(!pid->need)
+		{
+			pid->need = sizeof(si_tab_t) + GetSectionLength(pid->buf);
+			if(pid->need > DVB_SECTION_MAX)
+			{
+				DBG(5, fprintf(stderr, "[dvb_ts_section: PID 0x%04x: bogus section length %d]\n", pid->pid, (int) pid->need));
+				pid->active = 0;
+				pid->len = 0;
+				pid->need = 0;
+			}
+			continue;
+		}
+		/* Complete section; another may follow immediately */
+		*len = pid->len;
+		pid->len = 0;
+		pid->need = 0;
+		return pid->buf;
+	}
+	ts->cur = NULL;
+	return NULL;
+}
+
+static void
+dvb_ts_pid_reset(dvb_ts_pid_t *pid)
+{
+	pid->cc = -1;
+	pid->active = 0;
+	pid->len = 0;
+	pid->need = 0;
+}
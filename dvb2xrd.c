@@ -52,17 +52,19 @@ static int timeout  = 10;
 static int service_scan = 90;
 static int dvb_adapter = 0;
 static int dvb_demux = 0;
+static const char *input_file;
 
 int debug_level = 0;
 
 static void 
 usage(void)
 {
-	fprintf(stderr, "Usage: %s [-a NUM] [-d NUM] [-t SECS] [-s SECS] [-D LEVEL]\n"
+	fprintf(stderr, "Usage: %s [-a NUM] [-d NUM] [-i FILE] [-t SECS] [-s SECS] [-D LEVEL]\n"
 			" -a NUM            Use DVB adapter NUM (default = 0)\n"
 			" -d NUM            Use DVB demux interface NUM (default = 0)\n"
+			" -i FILE           Read a raw MPEG transport stream from FILE\n"
 			" -t SECS           Stop after SECS seconds of no new data (default = %d)\n"
-			" -s SECS           Stop each pass after SECS seconds if still incomplete (default = %d)\n"
+			" -s SECS           Stop the scan after SECS seconds if still incomplete (default = %d)\n"
 			" -D LEVEL          Set debug level to LEVEL (0 = none, 9 = highest)\n",
 			progname, timeout, service_scan);
 }
@@ -75,6 +77,7 @@ parse_options(int arg_count, char **arg_strings)
 		{"debug", 1, 0, 'D'},
 		{"adapter", 1, 0, 'a'},
 		{"demux", 1, 0, 'd'},
+		{"input", 1, 0, 'i'},
 		{"timeout", 1, 0, 't'},
 		{"scan", 1, 0, 's'},
 		{NULL, 0, 0, 0}
@@ -83,7 +86,7 @@ parse_options(int arg_count, char **arg_strings)
 
 	while (1)
 	{
-		if((c = getopt_long(arg_count, arg_strings, "hD:a:d:t:s:d:", longopts, &idx)) == -1)
+		if((c = getopt_long(arg_count, arg_strings, "hD:a:d:i:t:s:d:", longopts, &idx)) == -1)
 		{
 			break;
 		}
@@ -102,6 +105,9 @@ parse_options(int arg_count, char **arg_strings)
 		case 'd':
 			dvb_demux = atoi(optarg);
 			break;
+		case 'i':
+			input_file = optarg;
+			break;
 		case 't':
 			timeout = atoi(optarg);
 			if (0 == timeout)
@@ -127,98 +133,106 @@ parse_options(int arg_count, char **arg_strings)
 	return 0;
 }
 
+/* Markers stored as the data of each multiplex */
+static int mux_nosdt, mux_hassdt;
+
 static int
-read_nit(dvb_callbacks_t *callbacks)
+count_mux(mux_t *mux, void *data)
 {
-	dvb_demux_t *ctx;
-	dvb_table_t *table;
-	time_t start_time;
-
-	struct dmx_sct_filter_params sct;
-
-	memset(&sct, 0, sizeof(sct));
-	sct.pid = 0x0010;
+	int *pending = data;
 	
-	if(!(ctx = dvb_demux_open(dvb_adapter, dvb_demux, &sct, NULL, 0)))
+	if(mux_data(mux) == &mux_hassdt)
 	{
-		perror("dvb_demux_open");
-		exit(1);
-	}
-	dvb_demux_start(ctx);
-	dvb_demux_set_timeout(ctx, timeout);
-	start_time = time(NULL);
-	do
-	{
-		if(NULL == (table = dvb_demux_read(ctx, (service_scan ? start_time + service_scan : 0))))
-		{
-			break;
-		}
-		dvb_parse_si(table, callbacks);
+		return 0;
 	}
-	while(table->table_id != 0x40);
-	
-	dvb_demux_close(ctx);
+	DBG(5, fprintf(stderr, "[count_mux: Multiplex %s has no SDT yet]\n", mux_uri(mux)));
+	mux_set_data(mux, &mux_nosdt);
+	(*pending)++;
 	return 0;
 }
 
+/* Invoked for each complete NIT or SDT: the scan is complete once the NIT for
+ * this network has been read and every multiplex it describes has had an SDT.
+ * Rather than checking every multiplex each time, the multiplexes still
+ * awaiting an SDT are counted when the NIT arrives, and the count is reduced
+ * as each of their SDTs does; pending is -1 until the NIT has been read.
+ */
 static int
-check_mux(mux_t *mux, void *data)
+scan_table(dvb_table_t *table, void *data)
 {
-	int *flag = data;
-	
-	if(mux_data(mux))
+	int *pending = data;
+	mux_t *mux;
+
+	if(table->table_id == 0x40)
 	{
-		return 0;
+		*pending = 0;
+		mux_foreach(count_mux, pending);
+	}
+	else if(table->table_id == 0x42 || table->table_id == 0x46)
+	{
+		mux = mux_locate_dvb(HILO(table->sections[0]->sdt.original_network_id), HILO(table->sections[0]->sdt.transport_stream_id));
+		if(mux)
+		{
+			if(mux_data(mux) == &mux_nosdt)
+			{
+				(*pending)--;
+			}
+			mux_set_data(mux, &mux_hassdt);
+		}
 	}
-	DBG(5, fprintf(stderr, "[check_mux: Multiplex %s has no SDT yet]\n", mux_uri(mux)));
-	*flag = 0;
-	return 1;
+	return (*pending == 0);
 }
 
+/* Read the NIT and SDTs concurrently, from either the DVB demux interface or
+ * the transport stream file specified with -i.
+ */
 static int
-read_sdt(dvb_callbacks_t *callbacks)
+scan(void)
 {
-	dvb_demux_t *ctx;
-	dvb_table_t *table;
-	time_t start_time;
-	mux_t *mux;
-	int muxflag, matchflag;
-
+	dvb_acquire_t *acq;
 	struct dmx_sct_filter_params sct;
+	dvb_callbacks_t callbacks;
+	int pending;
 
-	memset(&sct, 0, sizeof(sct));
-	sct.pid = 0x0011;
-	
-	if(!(ctx = dvb_demux_open(dvb_adapter, dvb_demux, &sct, NULL, 0)))
+	if(input_file)
+	{
+		acq = dvb_acquire_open_path(input_file);
+	}
+	else
 	{
-		perror("dvb_demux_open");
+		acq = dvb_acquire_open(dvb_adapter, dvb_demux);
+	}
+	if(!acq)
+	{
+		perror((input_file ? input_file : "dvb_acquire_open"));
 		exit(1);
 	}
-	dvb_demux_start(ctx);
-	dvb_demux_set_timeout(ctx, timeout);
-	start_time = time(NULL);
-	muxflag = 1;
-	do
+	/* NIT actual, SDT actual and SDT other */
+	dvb_filter_tables(&sct, 0x0010, 0x40, 0x40);
+	if(dvb_acquire_add(acq, &sct))
 	{
-		if(NULL == (table = dvb_demux_read(ctx, (service_scan ? start_time + service_scan : 0))))
-		{
-			break;
-		}
-		if(table->table_id != 0x42 && table->table_id != 0x46)
-		{
-			continue;
-		}
-		dvb_parse_si(table, callbacks);
-		mux = mux_locate_dvb(HILO(table->sections[0]->sdt.original_network_id), HILO(table->sections[0]->sdt.transport_stream_id));
-		if(mux)
-		{
-			mux_set_data(mux, &muxflag);
-		}
-		matchflag = 1;
-		mux_foreach(check_mux, &matchflag);
+		perror("dvb_acquire_add");
+		exit(1);
+	}
+	dvb_filter_tables(&sct, 0x0011, 0x42, 0x42);
+	if(dvb_acquire_add(acq, &sct))
+	{
+		perror("dvb_acquire_add");
+		exit(1);
+	}
+	dvb_filter_tables(&sct, 0x0011, 0x46, 0x46);
+	if(dvb_acquire_add(acq, &sct))
+	{
+		perror("dvb_acquire_add");
+		exit(1);
 	}
-	while(!matchflag);
-	dvb_demux_close(ctx);
+	dvb_acquire_set_timeout(acq, timeout);
+	memset(&callbacks, 0, sizeof(callbacks));
+	pending = -1;
+	callbacks.table = scan_table;
+	callbacks.table_data = &pending;
+	dvb_acquire_run(acq, (service_scan ? time(NULL) + service_scan : 0), &callbacks);
+	dvb_acquire_close(acq);
 	return 0;
 }
 
@@ -234,8 +248,7 @@ main(int argc, char **argv)
 		progname = argv[0];
 	}
 	parse_options(argc, argv);
-	read_nit(NULL);
-	read_sdt(NULL);   
+	scan();
 	network_debug_dump();
 	service_debug_dump();
 	return 0;
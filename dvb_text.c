@@ -1,1134 +1,807 @@
+/*
+ * Decoding of DVB text (ETSI EN 300 468 Annex A) into UTF-8.
+ *
+ * The first byte of a text field may select its character table: the
+ * single-byte tables (ISO 6937 and ISO 8859-1 to -15) and UCS-2 and UTF-8
+ * are decoded here through the tables below, and iconv is only used for the
+ * East Asian encodings, or if -e names something else as the default.
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <iconv.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-static const char codeset[6][256][10] = {
-	[0] = {	/* Character code table 00 - Latin alphabet - ISO 6937 {{{ */
-		[0x20] = " ",
-		[0x21] = "!",
-		[0x22] = "&quot;",
-		[0x23] = "#",
-		[0x24] = "$",
-		[0x25] = "%",
-		[0x26] = "&amp;",
-		[0x27] = "'",
-		[0x28] = "(",
-		[0x29] = ")",
-		[0x2A] = "*",
-		[0x2B] = "+",
-		[0x2C] = ",",
-		[0x2D] = "-",
-		[0x2E] = ".",
-		[0x2F] = "/",
-		[0x30] = "0",
-		[0x31] = "1",
-		[0x32] = "2",
-		[0x33] = "3",
-		[0x34] = "4",
-		[0x35] = "5",
-		[0x36] = "6",
-		[0x37] = "7",
-		[0x38] = "8",
-		[0x39] = "9",
-		[0x3A] = ":",
-		[0x3B] = ";",
-		[0x3C] = "&lt;",
-		[0x3D] = "=",
-		[0x3E] = "&gt;",
-		[0x3F] = "?",
-		[0x40] = "@",
-		[0x41] = "A",
-		[0x42] = "B",
-		[0x43] = "C",
-		[0x44] = "D",
-		[0x45] = "E",
-		[0x46] = "F",
-		[0x47] = "G",
-		[0x48] = "H",
-		[0x49] = "I",
-		[0x4A] = "J",
-		[0x4B] = "K",
-		[0x4C] = "L",
-		[0x4D] = "M",
-		[0x4E] = "N",
-		[0x4F] = "O",
-		[0x50] = "P",
-		[0x51] = "Q",
-		[0x52] = "R",
-		[0x53] = "S",
-		[0x54] = "T",
-		[0x55] = "U",
-		[0x56] = "V",
-		[0x57] = "W",
-		[0x58] = "X",
-		[0x59] = "Y",
-		[0x5A] = "Z",
-		[0x5B] = "[",
-		[0x5C] = "\\",
-		[0x5D] = "]",
-		[0x5E] = "^",
-		[0x5F] = "_",
-		[0x60] = "`",
-		[0x61] = "a",
-		[0x62] = "b",
-		[0x63] = "c",
-		[0x64] = "d",
-		[0x65] = "e",
-		[0x66] = "f",
-		[0x67] = "g",
-		[0x68] = "h",
-		[0x69] = "i",
-		[0x6A] = "j",
-		[0x6B] = "k",
-		[0x6C] = "l",
-		[0x6D] = "m",
-		[0x6E] = "n",
-		[0x6F] = "o",
-		[0x70] = "p",
-		[0x71] = "q",
-		[0x72] = "r",
-		[0x73] = "s",
-		[0x74] = "t",
-		[0x25] = "u",
-		[0x76] = "v",
-		[0x77] = "w",
-		[0x28] = "x",
-		[0x79] = "y",
-		[0x7A] = "z",
-		[0x7B] = "{",
-		[0x7C] = "|",
-		[0x7D] = "}",
-		[0x7E] = "~",
-		[0xA0] = "&#x00A0;", // NO-BREAK SPACE,
-		[0xA1] = "&#x00A1;", // INVERTED EXCLAMATION MARK,
-		[0xA2] = "&#x00A2;", // CENT SIGN,
-		[0xA3] = "&#x00A3;", // POUND SIGN,
-		[0xA4] = "&#x0024;", // DOLLAR SIGN,
-		[0xA5] = "&#x00A5;", // YEN SIGN,
-		[0xA7] = "&#x00A7;", // SECTION SIGN,
-		[0xA9] = "&#x2018;", // LEFT SINGLE QUOTATION MARK,
-		[0xAA] = "&#x201C;", // LEFT DOUBLE QUOTATION MARK,
-		[0xAB] = "&#x00AB;", // LEFT-POINTING DOUBLE ANGLE QUOTATION MARK,
-		[0xAC] = "&#x2190;", // LEFTWARDS ARROW,
-		[0xAD] = "&#x2191;", // UPWARDS ARROW,
-		[0xAE] = "&#x2192;", // RIGHTWARDS ARROW,
-		[0xAF] = "&#x2193;", // DOWNWARDS ARROW,
-		[0xB0] = "&#x00B0;", // DEGREE SIGN,
-		[0xB1] = "&#x00B1;", // PLUS-MINUS SIGN,
-		[0xB2] = "&#x00B2;", // SUPERSCRIPT TWO,
-		[0xB3] = "&#x00B3;", // SUPERSCRIPT THREE,
-		[0xB4] = "&#x00D7;", // MULTIPLICATION SIGN,
-		[0xB5] = "&#x00B5;", // MICRO SIGN,
-		[0xB6] = "&#x00B6;", // PILCROW SIGN,
-		[0xB7] = "&#x00B7;", // MIDDLE DOT,
-		[0xB8] = "&#x00F7;", // DIVISION SIGN,
-		[0xB9] = "&#x2019;", // RIGHT SINGLE QUOTATION MARK,
-		[0xBa] = "&#x201D;", // RIGHT DOUBLE QUOTATION MARK,
-		[0xBb] = "&#x00BB;", // RIGHT-POINTING DOUBLE ANGLE QUOTATION MARK,
-		[0xBc] = "&#x00BC;", // VULGAR FRACTION ONE QUARTER,
-		[0xBd] = "&#x00BD;", // VULGAR FRACTION ONE HALF,
-		[0xBe] = "&#x00BE;", // VULGAR FRACTION THREE QUARTERS,
-		[0xBf] = "&#x00BF;", // INVERTED QUESTION MARK,
-		[0xC1] = "&#xE002;", // NON-SPACING GRAVE ACCENT <ISO-IR-103_C1>
-		[0xC2] = "&#xE003;", // NON-SPACING ACUTE ACCENT <ISO-IR-103_C2>
-		[0xC3] = "&#xE004;", // NON-SPACING CIRCUMFLEX ACCENT <ISO-IR-103_C3>
-		[0xC4] = "&#xE005;", // NON-SPACING TILDE <ISO-IR-103_C4>
-		[0xC5] = "&#xE006;", // NON-SPACING MACRON <ISO-IR-103_C5>
-		[0xC6] = "&#xE007;", // NON-SPACING BREVE <ISO-IR-103_C6>
-		[0xC7] = "&#xE008;", // NON-SPACING DOT ABOVE <ISO-IR-103_C7>
-		[0xC8] = "&#xE009;", // NON-SPACING DIAERESIS <ISO-IR-103_C8>
-		[0xCA] = "&#xE00A;", // NON-SPACING RING ABOVE <ISO-IR-103_CA>
-		[0xCB] = "&#xE00B;", // NON-SPACING CEDILLA <ISO-IR-103_CB>
-		[0xCD] = "&#xE00D;", // NON-SPACING DOUBLE ACCUTE ACCENT <ISO-IR-103_CD>
-		[0xCE] = "&#xE00E;", // NON-SPACING OGONEK <ISO-IR-103_CE>
-		[0xCF] = "&#xE00F;", // NON-SPACING CARON <ISO-IR-103_CF>
-		[0xD0] = "&#x2014;", // EM DASH,
-		[0xD1] = "&#x00B9;", // SUPERSCRIPT ONE,
-		[0xD2] = "&#x00AE;", // REGISTERED SIGN,
-		[0xD3] = "&#x00A9;", // COPYRIGHT SIGN,
-		[0xD4] = "&#x2122;", // TRADE MARK SIGN,
-		[0xD5] = "&#x266A;", // EIGHTH NOTE,
-		[0xD6] = "&#x00AC;", // NOT SIGN,
-		[0xD7] = "&#x00A6;", // BROKEN BAR,
-		[0xDC] = "&#x215B;", // VULGAR FRACTION ONE EIGHTH,
-		[0xDD] = "&#x215C;", // VULGAR FRACTION THREE EIGHTHS,
-		[0xDE] = "&#x215D;", // VULGAR FRACTION FIVE EIGHTHS,
-		[0xDF] = "&#x215E;", // VULGAR FRACTION SEVEN EIGHTHS,
-		[0xE0] = "&#x2126;", // OHM SIGN,
-		[0xE1] = "&#x00C6;", // LATIN CAPITAL LETTER AE,
-		[0xE2] = "&#x00D0;", // LATIN CAPITAL LETTER ETH (Icelandic),
-		[0xE3] = "&#x00AA;", // FEMININE ORDINAL INDICATOR,
-		[0xE4] = "&#x0126;", // LATIN CAPITAL LETTER H WITH STROKE,
-		[0xE6] = "&#x0132;", // LATIN CAPITAL LIGATURE IJ,
-		[0xE7] = "&#x013F;", // LATIN CAPITAL LETTER L WITH MIDDLE DOT,
-		[0xE8] = "&#x0141;", // LATIN CAPITAL LETTER L WITH STROKE,
-		[0xE9] = "&#x00D8;", // LATIN CAPITAL LETTER O WITH STROKE,
-		[0xEA] = "&#x0152;", // LATIN CAPITAL LIGATURE OE,
-		[0xEB] = "&#x00BA;", // MASCULINE ORDINAL INDICATOR,
-		[0xEC] = "&#x00DE;", // LATIN CAPITAL LETTER THORN (Icelandic),
-		[0xED] = "&#x0166;", // LATIN CAPITAL LETTER T WITH STROKE,
-		[0xEE] = "&#x014A;", // LATIN CAPITAL LETTER ENG (Sami),
-		[0xEF] = "&#x0149;", // LATIN SMALL LETTER N PRECEDED BY APOSTROPHE,
-		[0xF0] = "&#x0138;", // LATIN SMALL LETTER KRA (Greenlandic),
-		[0xF1] = "&#x00E6;", // LATIN SMALL LETTER AE,
-		[0xF2] = "&#x0111;", // LATIN SMALL LETTER D WITH STROKE,
-		[0xF3] = "&#x00F0;", // LATIN SMALL LETTER ETH (Icelandic),
-		[0xF4] = "&#x0127;", // LATIN SMALL LETTER H WITH STROKE,
-		[0xF5] = "&#x0131;", // LATIN SMALL LETTER DOTLESS I,
-		[0xF6] = "&#x0133;", // LATIN SMALL LIGATURE IJ,
-		[0xF7] = "&#x0140;", // LATIN SMALL LETTER L WITH MIDDLE DOT,
-		[0xF8] = "&#x0142;", // LATIN SMALL LETTER L WITH STROKE,
-		[0xF9] = "&#x00F8;", // LATIN SMALL LETTER O WITH STROKE,
-		[0xFA] = "&#x0153;", // LATIN SMALL LIGATURE OE,
-		[0xFB] = "&#x00DF;", // LATIN SMALL LETTER SHARP S (German),
-		[0xFC] = "&#x00FE;", // LATIN SMALL LETTER THORN (Icelandic),
-		[0xFD] = "&#x0167;", // LATIN SMALL LETTER T WITH STROKE,
-		[0xFE] = "&#x014B;", // LATIN SMALL LETTER ENG (Sami),
-		[0xFF] = "&#x00AD;", // SOFT HYPHEN,
-	}, /* }}} */
-	[1] = { /* Character code table 01 - Latin/Cyrillic alphabet - ISO 8859-5 {{{ */
-		[0x20] = " ",
-		[0x21] = "!",
-		[0x22] = "&quot;",
-		[0x23] = "#",
-		[0x24] = "$",
-		[0x25] = "%",
-		[0x26] = "&amp;",
-		[0x27] = "'",
-		[0x28] = "(",
-		[0x29] = ")",
-		[0x2A] = "*",
-		[0x2B] = "+",
-		[0x2C] = ",",
-		[0x2D] = "-",
-		[0x2E] = ".",
-		[0x2F] = "/",
-		[0x30] = "0",
-		[0x31] = "1",
-		[0x32] = "2",
-		[0x33] = "3",
-		[0x34] = "4",
-		[0x35] = "5",
-		[0x36] = "6",
-		[0x37] = "7",
-		[0x38] = "8",
-		[0x39] = "9",
-		[0x3A] = ":",
-		[0x3B] = ";",
-		[0x3C] = "&lt;",
-		[0x3D] = "=",
-		[0x3E] = "&gt;",
-		[0x3F] = "?",
-		[0x40] = "@",
-		[0x41] = "A",
-		[0x42] = "B",
-		[0x43] = "C",
-		[0x44] = "D",
-		[0x45] = "E",
-		[0x46] = "F",
-		[0x47] = "G",
-		[0x48] = "H",
-		[0x49] = "I",
-		[0x4A] = "J",
-		[0x4B] = "K",
-		[0x4C] = "L",
-		[0x4D] = "M",
-		[0x4E] = "N",
-		[0x4F] = "O",
-		[0x50] = "P",
-		[0x51] = "Q",
-		[0x52] = "R",
-		[0x53] = "S",
-		[0x54] = "T",
-		[0x55] = "U",
-		[0x56] = "V",
-		[0x57] = "W",
-		[0x58] = "X",
-		[0x59] = "Y",
-		[0x5A] = "Z",
-		[0x5B] = "[",
-		[0x5C] = "\\",
-		[0x5D] = "]",
-		[0x5E] = "^",
-		[0x5F] = "_",
-		[0x60] = "`",
-		[0x61] = "a",
-		[0x62] = "b",
-		[0x63] = "c",
-		[0x64] = "d",
-		[0x65] = "e",
-		[0x66] = "f",
-		[0x67] = "g",
-		[0x68] = "h",
-		[0x69] = "i",
-		[0x6A] = "j",
-		[0x6B] = "k",
-		[0x6C] = "l",
-		[0x6D] = "m",
-		[0x6E] = "n",
-		[0x6F] = "o",
-		[0x70] = "p",
-		[0x71] = "q",
-		[0x72] = "r",
-		[0x73] = "s",
-		[0x74] = "t",
-		[0x25] = "u",
-		[0x76] = "v",
-		[0x77] = "w",
-		[0x28] = "x",
-		[0x79] = "y",
-		[0x7A] = "z",
-		[0x7B] = "{",
-		[0x7C] = "|",
-		[0x7D] = "}",
-		[0x7E] = "~",
-		[0xA0] = "&#x00A0;", // NO-BREAK SPACE
-		[0xA1] = "&#x0401;", // CYRILLIC CAPITAL LETTER IO
-		[0xA2] = "&#x0402;", // CYRILLIC CAPITAL LETTER DJE
-		[0xA3] = "&#x0403;", // CYRILLIC CAPITAL LETTER GJE
-		[0xA4] = "&#x0404;", // CYRILLIC CAPITAL LETTER UKRAINIAN IE
-		[0xA5] = "&#x0405;", // CYRILLIC CAPITAL LETTER DZE
-		[0xA6] = "&#x0406;", // CYRILLIC CAPITAL LETTER BYELORUSSIAN-UKRAINIAN I
-		[0xA7] = "&#x0407;", // CYRILLIC CAPITAL LETTER YI
-		[0xA8] = "&#x0408;", // CYRILLIC CAPITAL LETTER JE
-		[0xA9] = "&#x0409;", // CYRILLIC CAPITAL LETTER LJE
-		[0xAA] = "&#x040A;", // CYRILLIC CAPITAL LETTER NJE
-		[0xAB] = "&#x040B;", // CYRILLIC CAPITAL LETTER TSHE
-		[0xAC] = "&#x040C;", // CYRILLIC CAPITAL LETTER KJE
-		[0xAD] = "&#x00AD;", // SOFT HYPHEN
-		[0xAE] = "&#x040E;", // CYRILLIC CAPITAL LETTER SHORT U
-		[0xAF] = "&#x040F;", // CYRILLIC CAPITAL LETTER DZHE
-		[0xB0] = "&#x0410;", // CYRILLIC CAPITAL LETTER A
-		[0xB1] = "&#x0411;", // CYRILLIC CAPITAL LETTER BE
-		[0xB2] = "&#x0412;", // CYRILLIC CAPITAL LETTER VE
-		[0xB3] = "&#x0413;", // CYRILLIC CAPITAL LETTER GHE
-		[0xB4] = "&#x0414;", // CYRILLIC CAPITAL LETTER DE
-		[0xB5] = "&#x0415;", // CYRILLIC CAPITAL LETTER IE
-		[0xB6] = "&#x0416;", // CYRILLIC CAPITAL LETTER ZHE
-		[0xB7] = "&#x0417;", // CYRILLIC CAPITAL LETTER ZE
-		[0xB8] = "&#x0418;", // CYRILLIC CAPITAL LETTER I
-		[0xB9] = "&#x0419;", // CYRILLIC CAPITAL LETTER SHORT I
-		[0xBA] = "&#x041A;", // CYRILLIC CAPITAL LETTER KA
-		[0xBB] = "&#x041B;", // CYRILLIC CAPITAL LETTER EL
-		[0xBC] = "&#x041C;", // CYRILLIC CAPITAL LETTER EM
-		[0xBD] = "&#x041D;", // CYRILLIC CAPITAL LETTER EN
-		[0xBE] = "&#x041E;", // CYRILLIC CAPITAL LETTER O
-		[0xBF] = "&#x041F;", // CYRILLIC CAPITAL LETTER PE
-		[0xC0] = "&#x0420;", // CYRILLIC CAPITAL LETTER ER
-		[0xC1] = "&#x0421;", // CYRILLIC CAPITAL LETTER ES
-		[0xC2] = "&#x0422;", // CYRILLIC CAPITAL LETTER TE
-		[0xC3] = "&#x0423;", // CYRILLIC CAPITAL LETTER U
-		[0xC4] = "&#x0424;", // CYRILLIC CAPITAL LETTER EF
-		[0xC5] = "&#x0425;", // CYRILLIC CAPITAL LETTER HA
-		[0xC6] = "&#x0426;", // CYRILLIC CAPITAL LETTER TSE
-		[0xC7] = "&#x0427;", // CYRILLIC CAPITAL LETTER CHE
-		[0xC8] = "&#x0428;", // CYRILLIC CAPITAL LETTER SHA
-		[0xC9] = "&#x0429;", // CYRILLIC CAPITAL LETTER SHCHA
-		[0xCA] = "&#x042A;", // CYRILLIC CAPITAL LETTER HARD SIGN
-		[0xCB] = "&#x042B;", // CYRILLIC CAPITAL LETTER YERU
-		[0xCC] = "&#x042C;", // CYRILLIC CAPITAL LETTER SOFT SIGN
-		[0xCD] = "&#x042D;", // CYRILLIC CAPITAL LETTER E
-		[0xCE] = "&#x042E;", // CYRILLIC CAPITAL LETTER YU
-		[0xCF] = "&#x042F;", // CYRILLIC CAPITAL LETTER YA
-		[0xD0] = "&#x0430;", // CYRILLIC SMALL LETTER A
-		[0xD1] = "&#x0431;", // CYRILLIC SMALL LETTER BE
-		[0xD2] = "&#x0432;", // CYRILLIC SMALL LETTER VE
-		[0xD3] = "&#x0433;", // CYRILLIC SMALL LETTER GHE
-		[0xD4] = "&#x0434;", // CYRILLIC SMALL LETTER DE
-		[0xD5] = "&#x0435;", // CYRILLIC SMALL LETTER IE
-		[0xD6] = "&#x0436;", // CYRILLIC SMALL LETTER ZHE
-		[0xD7] = "&#x0437;", // CYRILLIC SMALL LETTER ZE
-		[0xD8] = "&#x0438;", // CYRILLIC SMALL LETTER I
-		[0xD9] = "&#x0439;", // CYRILLIC SMALL LETTER SHORT I
-		[0xDA] = "&#x043A;", // CYRILLIC SMALL LETTER KA
-		[0xDB] = "&#x043B;", // CYRILLIC SMALL LETTER EL
-		[0xDC] = "&#x043C;", // CYRILLIC SMALL LETTER EM
-		[0xDD] = "&#x043D;", // CYRILLIC SMALL LETTER EN
-		[0xDE] = "&#x043E;", // CYRILLIC SMALL LETTER O
-		[0xDF] = "&#x043F;", // CYRILLIC SMALL LETTER PE
-		[0xE0] = "&#x0440;", // CYRILLIC SMALL LETTER ER
-		[0xE1] = "&#x0441;", // CYRILLIC SMALL LETTER ES
-		[0xE2] = "&#x0442;", // CYRILLIC SMALL LETTER TE
-		[0xE3] = "&#x0443;", // CYRILLIC SMALL LETTER U
-		[0xE4] = "&#x0444;", // CYRILLIC SMALL LETTER EF
-		[0xE5] = "&#x0445;", // CYRILLIC SMALL LETTER HA
-		[0xE6] = "&#x0446;", // CYRILLIC SMALL LETTER TSE
-		[0xE7] = "&#x0447;", // CYRILLIC SMALL LETTER CHE
-		[0xE8] = "&#x0448;", // CYRILLIC SMALL LETTER SHA
-		[0xE9] = "&#x0449;", // CYRILLIC SMALL LETTER SHCHA
-		[0xEA] = "&#x044A;", // CYRILLIC SMALL LETTER HARD SIGN
-		[0xEB] = "&#x044B;", // CYRILLIC SMALL LETTER YERU
-		[0xEC] = "&#x044C;", // CYRILLIC SMALL LETTER SOFT SIGN
-		[0xED] = "&#x044D;", // CYRILLIC SMALL LETTER E
-		[0xEE] = "&#x044E;", // CYRILLIC SMALL LETTER YU
-		[0xEF] = "&#x044F;", // CYRILLIC SMALL LETTER YA
-		[0xF0] = "&#x2116;", // NUMERO SIGN
-		[0xF1] = "&#x0451;", // CYRILLIC SMALL LETTER IO
-		[0xF2] = "&#x0452;", // CYRILLIC SMALL LETTER DJE
-		[0xF3] = "&#x0453;", // CYRILLIC SMALL LETTER GJE
-		[0xF4] = "&#x0454;", // CYRILLIC SMALL LETTER UKRAINIAN IE
-		[0xF5] = "&#x0455;", // CYRILLIC SMALL LETTER DZE
-		[0xF6] = "&#x0456;", // CYRILLIC SMALL LETTER BYELORUSSIAN-UKRAINIAN I
-		[0xF7] = "&#x0457;", // CYRILLIC SMALL LETTER YI
-		[0xF8] = "&#x0458;", // CYRILLIC SMALL LETTER JE
-		[0xF9] = "&#x0459;", // CYRILLIC SMALL LETTER LJE
-		[0xFA] = "&#x045A;", // CYRILLIC SMALL LETTER NJE
-		[0xFB] = "&#x045B;", // CYRILLIC SMALL LETTER TSHE
-		[0xFC] = "&#x045C;", // CYRILLIC SMALL LETTER KJE
-		[0xFD] = "&#x00A7;", // SECTION SIGN
-		[0xFE] = "&#x045E;", // CYRILLIC SMALL LETTER SHORT U
-		[0xFF] = "&#x045F;", // CYRILLIC SMALL LETTER DZHE
-	}, /* }}} */
-	[2] = { /* Character code table 02 - Latin/Arabic alphabet - ISO 8859-6  {{{*/
-		[0x20] = " ",
-		[0x21] = "!",
-		[0x22] = "&quot;",
-		[0x23] = "#",
-		[0x24] = "$",
-		[0x25] = "%",
-		[0x26] = "&amp;",
-		[0x27] = "'",
-		[0x28] = "(",
-		[0x29] = ")",
-		[0x2A] = "*",
-		[0x2B] = "+",
-		[0x2C] = ",",
-		[0x2D] = "-",
-		[0x2E] = ".",
-		[0x2F] = "/",
-		[0x30] = "&#x0660;", // ARABIC DIGIT ZERO
-		[0x31] = "&#x0661;", // ARABIC DIGIT ONE
-		[0x32] = "&#x0662;", // ARABIC DIGIT TWO
-		[0x33] = "&#x0663;", // ARABIC DIGIT THREE
-		[0x34] = "&#x0664;", // ARABIC DIGIT FOUR
-		[0x35] = "&#x0665;", // ARABIC DIGIT FIVE
-		[0x36] = "&#x0666;", // ARABIC DIGIT SIX
-		[0x37] = "&#x0667;", // ARABIC DIGIT SEVEN
-		[0x38] = "&#x0668;", // ARABIC DIGIT EIGHT
-		[0x39] = "&#x0669;", // ARABIC DIGIT NINE
-		[0x3A] = ":",
-		[0x3B] = ";",
-		[0x3C] = "&lt;",
-		[0x3D] = "=",
-		[0x3E] = "&gt;",
-		[0x3F] = "?",
-		[0x40] = "@",
-		[0x41] = "A",
-		[0x42] = "B",
-		[0x43] = "C",
-		[0x44] = "D",
-		[0x45] = "E",
-		[0x46] = "F",
-		[0x47] = "G",
-		[0x48] = "H",
-		[0x49] = "I",
-		[0x4A] = "J",
-		[0x4B] = "K",
-		[0x4C] = "L",
-		[0x4D] = "M",
-		[0x4E] = "N",
-		[0x4F] = "O",
-		[0x50] = "P",
-		[0x51] = "Q",
-		[0x52] = "R",
-		[0x53] = "S",
-		[0x54] = "T",
-		[0x55] = "U",
-		[0x56] = "V",
-		[0x57] = "W",
-		[0x58] = "X",
-		[0x59] = "Y",
-		[0x5A] = "Z",
-		[0x5B] = "[",
-		[0x5C] = "\\",
-		[0x5D] = "]",
-		[0x5E] = "^",
-		[0x5F] = "_",
-		[0x60] = "`",
-		[0x61] = "a",
-		[0x62] = "b",
-		[0x63] = "c",
-		[0x64] = "d",
-		[0x65] = "e",
-		[0x66] = "f",
-		[0x67] = "g",
-		[0x68] = "h",
-		[0x69] = "i",
-		[0x6A] = "j",
-		[0x6B] = "k",
-		[0x6C] = "l",
-		[0x6D] = "m",
-		[0x6E] = "n",
-		[0x6F] = "o",
-		[0x70] = "p",
-		[0x71] = "q",
-		[0x72] = "r",
-		[0x73] = "s",
-		[0x74] = "t",
-		[0x25] = "u",
-		[0x76] = "v",
-		[0x77] = "w",
-		[0x28] = "x",
-		[0x79] = "y",
-		[0x7A] = "z",
-		[0x7B] = "{",
-		[0x7C] = "|",
-		[0x7D] = "}",
-		[0x7E] = "~",
+#define MAX 4096 /* enough for a reassembled extended event description */
+static char result[MAX * 6]; /* xml-ification needs up to 6 bytes */
 
-		[0xA0] = "&#x00A0;", // NO-BREAK SPACE
-		[0xA4] = "&#x00A4;", // CURRENCY SIGN
-		[0xAC] = "&#x060C;", // ARABIC COMMA
-		[0xAD] = "&#x00AD;", // SOFT HYPHEN
-		[0xBB] = "&#x061B;", // ARABIC SEMICOLON
-		[0xBF] = "&#x061F;", // ARABIC QUESTION MARK
-		[0xC1] = "&#x0621;", // ARABIC LETTER HAMZA
-		[0xC2] = "&#x0622;", // ARABIC LETTER ALEF WITH MADDA ABOVE
-		[0xC3] = "&#x0623;", // ARABIC LETTER ALEF WITH HAMZA ABOVE
-		[0xC4] = "&#x0624;", // ARABIC LETTER WAW WITH HAMZA ABOVE
-		[0xC5] = "&#x0625;", // ARABIC LETTER ALEF WITH HAMZA BELOW
-		[0xC6] = "&#x0626;", // ARABIC LETTER YEH WITH HAMZA ABOVE
-		[0xC7] = "&#x0627;", // ARABIC LETTER ALEF
-		[0xC8] = "&#x0628;", // ARABIC LETTER BEH
-		[0xC9] = "&#x0629;", // ARABIC LETTER TEH MARBUTA
-		[0xCA] = "&#x062A;", // ARABIC LETTER TEH
-		[0xCB] = "&#x062B;", // ARABIC LETTER THEH
-		[0xCC] = "&#x062C;", // ARABIC LETTER JEEM
-		[0xCD] = "&#x062D;", // ARABIC LETTER HAH
-		[0xCE] = "&#x062E;", // ARABIC LETTER KHAH
-		[0xCF] = "&#x062F;", // ARABIC LETTER DAL
-		[0xD0] = "&#x0630;", // ARABIC LETTER THAL
-		[0xD1] = "&#x0631;", // ARABIC LETTER REH
-		[0xD2] = "&#x0632;", // ARABIC LETTER ZAIN
-		[0xD3] = "&#x0633;", // ARABIC LETTER SEEN
-		[0xD4] = "&#x0634;", // ARABIC LETTER SHEEN
-		[0xD5] = "&#x0635;", // ARABIC LETTER SAD
-		[0xD6] = "&#x0636;", // ARABIC LETTER DAD
-		[0xD7] = "&#x0637;", // ARABIC LETTER TAH
-		[0xD8] = "&#x0638;", // ARABIC LETTER ZAH
-		[0xD9] = "&#x0639;", // ARABIC LETTER AIN
-		[0xDA] = "&#x063A;", // ARABIC LETTER GHAIN
-		[0xE0] = "&#x0640;", // ARABIC TATWEEL
-		[0xE1] = "&#x0641;", // ARABIC LETTER FEH
-		[0xE2] = "&#x0642;", // ARABIC LETTER QAF
-		[0xE3] = "&#x0643;", // ARABIC LETTER KAF
-		[0xE4] = "&#x0644;", // ARABIC LETTER LAM
-		[0xE5] = "&#x0645;", // ARABIC LETTER MEEM
-		[0xE6] = "&#x0646;", // ARABIC LETTER NOON
-		[0xE7] = "&#x0647;", // ARABIC LETTER HEH
-		[0xE8] = "&#x0648;", // ARABIC LETTER WAW
-		[0xE9] = "&#x0649;", // ARABIC LETTER ALEF MAKSURA
-		[0xEA] = "&#x064A;", // ARABIC LETTER YEH
-		[0xEB] = "&#x064B;", // ARABIC FATHATAN
-		[0xEC] = "&#x064C;", // ARABIC DAMMATAN
-		[0xED] = "&#x064D;", // ARABIC KASRATAN
-		[0xEE] = "&#x064E;", // ARABIC FATHA
-		[0xEF] = "&#x064F;", // ARABIC DAMMA
-		[0xF0] = "&#x0650;", // ARABIC KASRA
-		[0xF1] = "&#x0651;", // ARABIC SHADDA
-		[0xF2] = "&#x0652;", // ARABIC SUKUN
-	}, /* }}} */
-	[3] = { /* Character code table 03 - Latin/Greek alphabet - ISO 8859-7 {{{ */
-		[0x20] = " ",
-		[0x21] = "!",
-		[0x22] = "&quot;",
-		[0x23] = "#",
-		[0x24] = "$",
-		[0x25] = "%",
-		[0x26] = "&amp;",
-		[0x27] = "'",
-		[0x28] = "(",
-		[0x29] = ")",
-		[0x2A] = "*",
-		[0x2B] = "+",
-		[0x2C] = ",",
-		[0x2D] = "-",
-		[0x2E] = ".",
-		[0x2F] = "/",
-		[0x30] = "0",
-		[0x31] = "1",
-		[0x32] = "2",
-		[0x33] = "3",
-		[0x34] = "4",
-		[0x35] = "5",
-		[0x36] = "6",
-		[0x37] = "7",
-		[0x38] = "8",
-		[0x39] = "9",
-		[0x3A] = ":",
-		[0x3B] = ";",
-		[0x3C] = "&lt;",
-		[0x3D] = "=",
-		[0x3E] = "&gt;",
-		[0x3F] = "?",
-		[0x40] = "@",
-		[0x41] = "A",
-		[0x42] = "B",
-		[0x43] = "C",
-		[0x44] = "D",
-		[0x45] = "E",
-		[0x46] = "F",
-		[0x47] = "G",
-		[0x48] = "H",
-		[0x49] = "I",
-		[0x4A] = "J",
-		[0x4B] = "K",
-		[0x4C] = "L",
-		[0x4D] = "M",
-		[0x4E] = "N",
-		[0x4F] = "O",
-		[0x50] = "P",
-		[0x51] = "Q",
-		[0x52] = "R",
-		[0x53] = "S",
-		[0x54] = "T",
-		[0x55] = "U",
-		[0x56] = "V",
-		[0x57] = "W",
-		[0x58] = "X",
-		[0x59] = "Y",
-		[0x5A] = "Z",
-		[0x5B] = "[",
-		[0x5C] = "\\",
-		[0x5D] = "]",
-		[0x5E] = "^",
-		[0x5F] = "_",
-		[0x60] = "`",
-		[0x61] = "a",
-		[0x62] = "b",
-		[0x63] = "c",
-		[0x64] = "d",
-		[0x65] = "e",
-		[0x66] = "f",
-		[0x67] = "g",
-		[0x68] = "h",
-		[0x69] = "i",
-		[0x6A] = "j",
-		[0x6B] = "k",
-		[0x6C] = "l",
-		[0x6D] = "m",
-		[0x6E] = "n",
-		[0x6F] = "o",
-		[0x70] = "p",
-		[0x71] = "q",
-		[0x72] = "r",
-		[0x73] = "s",
-		[0x74] = "t",
-		[0x25] = "u",
-		[0x76] = "v",
-		[0x77] = "w",
-		[0x28] = "x",
-		[0x79] = "y",
-		[0x7A] = "z",
-		[0x7B] = "{",
-		[0x7C] = "|",
-		[0x7D] = "}",
-		[0x7E] = "~",
-		[0xA0] = "&#x00A0;", // NO-BREAK SPACE
-		[0xA1] = "&#x2018;", // LEFT SINGLE QUOTATION MARK
-		[0xA2] = "&#x2019;", // RIGHT SINGLE QUOTATION MARK
-		[0xA3] = "&#x00A3;", // POUND SIGN
-		[0xA6] = "&#x00A6;", // BROKEN BAR
-		[0xA7] = "&#x00A7;", // SECTION SIGN
-		[0xA8] = "&#x00A8;", // DIAERESIS
-		[0xA9] = "&#x00A9;", // COPYRIGHT SIGN
-		[0xAB] = "&#x00AB;", // LEFT-POINTING DOUBLE ANGLE QUOTATION MARK
-		[0xAC] = "&#x00AC;", // NOT SIGN
-		[0xAD] = "&#x00AD;", // SOFT HYPHEN
-		[0xAF] = "&#x2015;", // HORIZONTAL BAR
-		[0xB0] = "&#x00B0;", // DEGREE SIGN
-		[0xB1] = "&#x00B1;", // PLUS-MINUS SIGN
-		[0xB2] = "&#x00B2;", // SUPERSCRIPT TWO
-		[0xB3] = "&#x00B3;", // SUPERSCRIPT THREE
-		[0xB4] = "&#x0384;", // GREEK TONOS
-		[0xB5] = "&#x0385;", // GREEK DIALYTIKA TONOS
-		[0xB6] = "&#x0386;", // GREEK CAPITAL LETTER ALPHA WITH TONOS
-		[0xB7] = "&#x00B7;", // MIDDLE DOT
-		[0xB8] = "&#x0388;", // GREEK CAPITAL LETTER EPSILON WITH TONOS
-		[0xB9] = "&#x0389;", // GREEK CAPITAL LETTER ETA WITH TONOS
-		[0xBA] = "&#x038A;", // GREEK CAPITAL LETTER IOTA WITH TONOS
-		[0xBB] = "&#x00BB;", // RIGHT-POINTING DOUBLE ANGLE QUOTATION MARK
-		[0xBC] = "&#x038C;", // GREEK CAPITAL LETTER OMICRON WITH TONOS
-		[0xBD] = "&#x00BD;", // VULGAR FRACTION ONE HALF
-		[0xBE] = "&#x038E;", // GREEK CAPITAL LETTER UPSILON WITH TONOS
-		[0xBF] = "&#x038F;", // GREEK CAPITAL LETTER OMEGA WITH TONOS
-		[0xC0] = "&#x0390;", // GREEK SMALL LETTER IOTA WITH DIALYTIKA AND TONOS
-		[0xC1] = "&#x0391;", // GREEK CAPITAL LETTER ALPHA
-		[0xC2] = "&#x0392;", // GREEK CAPITAL LETTER BETA
-		[0xC3] = "&#x0393;", // GREEK CAPITAL LETTER GAMMA
-		[0xC4] = "&#x0394;", // GREEK CAPITAL LETTER DELTA
-		[0xC5] = "&#x0395;", // GREEK CAPITAL LETTER EPSILON
-		[0xC6] = "&#x0396;", // GREEK CAPITAL LETTER ZETA
-		[0xC7] = "&#x0397;", // GREEK CAPITAL LETTER ETA
-		[0xC8] = "&#x0398;", // GREEK CAPITAL LETTER THETA
-		[0xC9] = "&#x0399;", // GREEK CAPITAL LETTER IOTA
-		[0xCA] = "&#x039A;", // GREEK CAPITAL LETTER KAPPA
-		[0xCB] = "&#x039B;", // GREEK CAPITAL LETTER LAMDA
-		[0xCC] = "&#x039C;", // GREEK CAPITAL LETTER MU
-		[0xCD] = "&#x039D;", // GREEK CAPITAL LETTER NU
-		[0xCE] = "&#x039E;", // GREEK CAPITAL LETTER XI
-		[0xCF] = "&#x039F;", // GREEK CAPITAL LETTER OMICRON
-		[0xD0] = "&#x03A0;", // GREEK CAPITAL LETTER PI
-		[0xD1] = "&#x03A1;", // GREEK CAPITAL LETTER RHO
-		[0xD3] = "&#x03A3;", // GREEK CAPITAL LETTER SIGMA
-		[0xD4] = "&#x03A4;", // GREEK CAPITAL LETTER TAU
-		[0xD5] = "&#x03A5;", // GREEK CAPITAL LETTER UPSILON
-		[0xD6] = "&#x03A6;", // GREEK CAPITAL LETTER PHI
-		[0xD7] = "&#x03A7;", // GREEK CAPITAL LETTER CHI
-		[0xD8] = "&#x03A8;", // GREEK CAPITAL LETTER PSI
-		[0xD9] = "&#x03A9;", // GREEK CAPITAL LETTER OMEGA
-		[0xDA] = "&#x03AA;", // GREEK CAPITAL LETTER IOTA WITH DIALYTIKA
-		[0xDB] = "&#x03AB;", // GREEK CAPITAL LETTER UPSILON WITH DIALYTIKA
-		[0xDC] = "&#x03AC;", // GREEK SMALL LETTER ALPHA WITH TONOS
-		[0xDD] = "&#x03AD;", // GREEK SMALL LETTER EPSILON WITH TONOS
-		[0xDE] = "&#x03AE;", // GREEK SMALL LETTER ETA WITH TONOS
-		[0xDF] = "&#x03AF;", // GREEK SMALL LETTER IOTA WITH TONOS
-		[0xE0] = "&#x03B0;", // GREEK SMALL LETTER UPSILON WITH DIALYTIKA AND TONOS
-		[0xE1] = "&#x03B1;", // GREEK SMALL LETTER ALPHA
-		[0xE2] = "&#x03B2;", // GREEK SMALL LETTER BETA
-		[0xE3] = "&#x03B3;", // GREEK SMALL LETTER GAMMA
-		[0xE4] = "&#x03B4;", // GREEK SMALL LETTER DELTA
-		[0xE5] = "&#x03B5;", // GREEK SMALL LETTER EPSILON
-		[0xE6] = "&#x03B6;", // GREEK SMALL LETTER ZETA
-		[0xE7] = "&#x03B7;", // GREEK SMALL LETTER ETA
-		[0xE8] = "&#x03B8;", // GREEK SMALL LETTER THETA
-		[0xE9] = "&#x03B9;", // GREEK SMALL LETTER IOTA
-		[0xEA] = "&#x03BA;", // GREEK SMALL LETTER KAPPA
-		[0xEB] = "&#x03BB;", // GREEK SMALL LETTER LAMDA
-		[0xEC] = "&#x03BC;", // GREEK SMALL LETTER MU
-		[0xED] = "&#x03BD;", // GREEK SMALL LETTER NU
-		[0xEE] = "&#x03BE;", // GREEK SMALL LETTER XI
-		[0xEF] = "&#x03BF;", // GREEK SMALL LETTER OMICRON
-		[0xF0] = "&#x03C0;", // GREEK SMALL LETTER PI
-		[0xF1] = "&#x03C1;", // GREEK SMALL LETTER RHO
-		[0xF2] = "&#x03C2;", // GREEK SMALL LETTER FINAL SIGMA
-		[0xF3] = "&#x03C3;", // GREEK SMALL LETTER SIGMA
-		[0xF4] = "&#x03C4;", // GREEK SMALL LETTER TAU
-		[0xF5] = "&#x03C5;", // GREEK SMALL LETTER UPSILON
-		[0xF6] = "&#x03C6;", // GREEK SMALL LETTER PHI
-		[0xF7] = "&#x03C7;", // GREEK SMALL LETTER CHI
-		[0xF8] = "&#x03C8;", // GREEK SMALL LETTER PSI
-		[0xF9] = "&#x03C9;", // GREEK SMALL LETTER OMEGA
-		[0xFA] = "&#x03CA;", // GREEK SMALL LETTER IOTA WITH DIALYTIKA
-		[0xFB] = "&#x03CB;", // GREEK SMALL LETTER UPSILON WITH DIALYTIKA
-		[0xFC] = "&#x03CC;", // GREEK SMALL LETTER OMICRON WITH TONOS
-		[0xFD] = "&#x03CD;", // GREEK SMALL LETTER UPSILON WITH TONOS
-		[0xFE] = "&#x03CE;", // GREEK SMALL LETTER OMEGA WITH TONOS
-	}, /* }}} */
-	[4] = { /* Character code table 04 - Latin/Hebrew alphabet - ISO 8859-8 {{{ */
-		[0x20] = " ",
-		[0x21] = "!",
-		[0x22] = "&quot;",
-		[0x23] = "#",
-		[0x24] = "$",
-		[0x25] = "%",
-		[0x26] = "&amp;",
-		[0x27] = "'",
-		[0x28] = "(",
-		[0x29] = ")",
-		[0x2A] = "*",
-		[0x2B] = "+",
-		[0x2C] = ",",
-		[0x2D] = "-",
-		[0x2E] = ".",
-		[0x2F] = "/",
-		[0x30] = "0",
-		[0x31] = "1",
-		[0x32] = "2",
-		[0x33] = "3",
-		[0x34] = "4",
-		[0x35] = "5",
-		[0x36] = "6",
-		[0x37] = "7",
-		[0x38] = "8",
-		[0x39] = "9",
-		[0x3A] = ":",
-		[0x3B] = ";",
-		[0x3C] = "&lt;",
-		[0x3D] = "=",
-		[0x3E] = "&gt;",
-		[0x3F] = "?",
-		[0x40] = "@",
-		[0x41] = "A",
-		[0x42] = "B",
-		[0x43] = "C",
-		[0x44] = "D",
-		[0x45] = "E",
-		[0x46] = "F",
-		[0x47] = "G",
-		[0x48] = "H",
-		[0x49] = "I",
-		[0x4A] = "J",
-		[0x4B] = "K",
-		[0x4C] = "L",
-		[0x4D] = "M",
-		[0x4E] = "N",
-		[0x4F] = "O",
-		[0x50] = "P",
-		[0x51] = "Q",
-		[0x52] = "R",
-		[0x53] = "S",
-		[0x54] = "T",
-		[0x55] = "U",
-		[0x56] = "V",
-		[0x57] = "W",
-		[0x58] = "X",
-		[0x59] = "Y",
-		[0x5A] = "Z",
-		[0x5B] = "[",
-		[0x5C] = "\\",
-		[0x5D] = "]",
-		[0x5E] = "^",
-		[0x5F] = "_",
-		[0x60] = "`",
-		[0x61] = "a",
-		[0x62] = "b",
-		[0x63] = "c",
-		[0x64] = "d",
-		[0x65] = "e",
-		[0x66] = "f",
-		[0x67] = "g",
-		[0x68] = "h",
-		[0x69] = "i",
-		[0x6A] = "j",
-		[0x6B] = "k",
-		[0x6C] = "l",
-		[0x6D] = "m",
-		[0x6E] = "n",
-		[0x6F] = "o",
-		[0x70] = "p",
-		[0x71] = "q",
-		[0x72] = "r",
-		[0x73] = "s",
-		[0x74] = "t",
-		[0x25] = "u",
-		[0x76] = "v",
-		[0x77] = "w",
-		[0x28] = "x",
-		[0x79] = "y",
-		[0x7A] = "z",
-		[0x7B] = "{",
-		[0x7C] = "|",
-		[0x7D] = "}",
-		[0x7E] = "~",
-		[0xA0] = "&#x00A0;", // NO-BREAK SPACE
-		[0xA2] = "&#x00A2;", // CENT SIGN
-		[0xA3] = "&#x00A3;", // POUND SIGN
-		[0xA4] = "&#x00A4;", // CURRENCY SIGN
-		[0xA5] = "&#x00A5;", // YEN SIGN
-		[0xA6] = "&#x00A6;", // BROKEN BAR
-		[0xA7] = "&#x00A7;", // SECTION SIGN
-		[0xA8] = "&#x00A8;", // DIAERESIS
-		[0xA9] = "&#x00A9;", // COPYRIGHT SIGN
-		[0xAA] = "&#x00D7;", // MULTIPLICATION SIGN
-		[0xAB] = "&#x00AB;", // LEFT-POINTING DOUBLE ANGLE QUOTATION MARK
-		[0xAC] = "&#x00AC;", // NOT SIGN
-		[0xAD] = "&#x00AD;", // SOFT HYPHEN
-		[0xAE] = "&#x00AE;", // REGISTERED SIGN
-		[0xAF] = "&#x00AF;", // MACRON
-		[0xB0] = "&#x00B0;", // DEGREE SIGN
-		[0xB1] = "&#x00B1;", // PLUS-MINUS SIGN
-		[0xB2] = "&#x00B2;", // SUPERSCRIPT TWO
-		[0xB3] = "&#x00B3;", // SUPERSCRIPT THREE
-		[0xB4] = "&#x00B4;", // ACUTE ACCENT
-		[0xB5] = "&#x00B5;", // MICRO SIGN
-		[0xB6] = "&#x00B6;", // PILCROW SIGN
-		[0xB7] = "&#x00B7;", // MIDDLE DOT
-		[0xB8] = "&#x00B8;", // CEDILLA
-		[0xB9] = "&#x00B9;", // SUPERSCRIPT ONE
-		[0xBA] = "&#x00F7;", // DIVISION SIGN
-		[0xBB] = "&#x00BB;", // RIGHT-POINTING DOUBLE ANGLE QUOTATION MARK
-		[0xBC] = "&#x00BC;", // VULGAR FRACTION ONE QUARTER
-		[0xBD] = "&#x00BD;", // VULGAR FRACTION ONE HALF
-		[0xBE] = "&#x00BE;", // VULGAR FRACTION THREE QUARTERS
-		[0xDF] = "&#x2017;", // DOUBLE LOW LINE
-		[0xE0] = "&#x05D0;", // HEBREW LETTER ALEF
-		[0xE1] = "&#x05D1;", // HEBREW LETTER BET
-		[0xE2] = "&#x05D2;", // HEBREW LETTER GIMEL
-		[0xE3] = "&#x05D3;", // HEBREW LETTER DALET
-		[0xE4] = "&#x05D4;", // HEBREW LETTER HE
-		[0xE5] = "&#x05D5;", // HEBREW LETTER VAV
-		[0xE6] = "&#x05D6;", // HEBREW LETTER ZAYIN
-		[0xE7] = "&#x05D7;", // HEBREW LETTER HET
-		[0xE8] = "&#x05D8;", // HEBREW LETTER TET
-		[0xE9] = "&#x05D9;", // HEBREW LETTER YOD
-		[0xEA] = "&#x05DA;", // HEBREW LETTER FINAL KAF
-		[0xEB] = "&#x05DB;", // HEBREW LETTER KAF
-		[0xEC] = "&#x05DC;", // HEBREW LETTER LAMED
-		[0xED] = "&#x05DD;", // HEBREW LETTER FINAL MEM
-		[0xEE] = "&#x05DE;", // HEBREW LETTER MEM
-		[0xEF] = "&#x05DF;", // HEBREW LETTER FINAL NUN
-		[0xF0] = "&#x05E0;", // HEBREW LETTER NUN
-		[0xF1] = "&#x05E1;", // HEBREW LETTER SAMEKH
-		[0xF2] = "&#x05E2;", // HEBREW LETTER AYIN
-		[0xF3] = "&#x05E3;", // HEBREW LETTER FINAL PE
-		[0xF4] = "&#x05E4;", // HEBREW LETTER PE
-		[0xF5] = "&#x05E5;", // HEBREW LETTER FINAL TSADI
-		[0xF6] = "&#x05E6;", // HEBREW LETTER TSADI
-		[0xF7] = "&#x05E7;", // HEBREW LETTER QOF
-		[0xF8] = "&#x05E8;", // HEBREW LETTER RESH
-		[0xF9] = "&#x05E9;", // HEBREW LETTER SHIN
-		[0xFA] = "&#x05EA;", // HEBREW LETTER TAV
-		[0xFD] = "&#x200E;", // LEFT-TO-RIGHT MARK
-		[0xFE] = "&#x200F;", // RIGHT-TO-LEFT MARK
-	}, /* }}} */
-	[5] = { /* Character code table 05 - Latin alphabet number 5 - ISO 8859-9 {{{ */
-		[0x20] = " ",
-		[0x21] = "!",
-		[0x22] = "&quot;",
-		[0x23] = "#",
-		[0x24] = "$",
-		[0x25] = "%",
-		[0x26] = "&amp;",
-		[0x27] = "'",
-		[0x28] = "(",
-		[0x29] = ")",
-		[0x2A] = "*",
-		[0x2B] = "+",
-		[0x2C] = ",",
-		[0x2D] = "-",
-		[0x2E] = ".",
-		[0x2F] = "/",
-		[0x30] = "0",
-		[0x31] = "1",
-		[0x32] = "2",
-		[0x33] = "3",
-		[0x34] = "4",
-		[0x35] = "5",
-		[0x36] = "6",
-		[0x37] = "7",
-		[0x38] = "8",
-		[0x39] = "9",
-		[0x3A] = ":",
-		[0x3B] = ";",
-		[0x3C] = "&lt;",
-		[0x3D] = "=",
-		[0x3E] = "&gt;",
-		[0x3F] = "?",
-		[0x40] = "@",
-		[0x41] = "A",
-		[0x42] = "B",
-		[0x43] = "C",
-		[0x44] = "D",
-		[0x45] = "E",
-		[0x46] = "F",
-		[0x47] = "G",
-		[0x48] = "H",
-		[0x49] = "I",
-		[0x4A] = "J",
-		[0x4B] = "K",
-		[0x4C] = "L",
-		[0x4D] = "M",
-		[0x4E] = "N",
-		[0x4F] = "O",
-		[0x50] = "P",
-		[0x51] = "Q",
-		[0x52] = "R",
-		[0x53] = "S",
-		[0x54] = "T",
-		[0x55] = "U",
-		[0x56] = "V",
-		[0x57] = "W",
-		[0x58] = "X",
-		[0x59] = "Y",
-		[0x5A] = "Z",
-		[0x5B] = "[",
-		[0x5C] = "\\",
-		[0x5D] = "]",
-		[0x5E] = "^",
-		[0x5F] = "_",
-		[0x60] = "`",
-		[0x61] = "a",
-		[0x62] = "b",
-		[0x63] = "c",
-		[0x64] = "d",
-		[0x65] = "e",
-		[0x66] = "f",
-		[0x67] = "g",
-		[0x68] = "h",
-		[0x69] = "i",
-		[0x6A] = "j",
-		[0x6B] = "k",
-		[0x6C] = "l",
-		[0x6D] = "m",
-		[0x6E] = "n",
-		[0x6F] = "o",
-		[0x70] = "p",
-		[0x71] = "q",
-		[0x72] = "r",
-		[0x73] = "s",
-		[0x74] = "t",
-		[0x25] = "u",
-		[0x76] = "v",
-		[0x77] = "w",
-		[0x28] = "x",
-		[0x79] = "y",
-		[0x7A] = "z",
-		[0x7B] = "{",
-		[0x7C] = "|",
-		[0x7D] = "}",
-		[0x7E] = "~",
-		[0xA0] = "&#x00A0;", // NO-BREAK SPACE
-		[0xA1] = "&#x00A1;", // INVERTED EXCLAMATION MARK
-		[0xA2] = "&#x00A2;", // CENT SIGN
-		[0xA3] = "&#x00A3;", // POUND SIGN
-		[0xA4] = "&#x00A4;", // CURRENCY SIGN
-		[0xA5] = "&#x00A5;", // YEN SIGN
-		[0xA6] = "&#x00A6;", // BROKEN BAR
-		[0xA7] = "&#x00A7;", // SECTION SIGN
-		[0xA8] = "&#x00A8;", // DIAERESIS
-		[0xA9] = "&#x00A9;", // COPYRIGHT SIGN
-		[0xAA] = "&#x00AA;", // FEMININE ORDINAL INDICATOR
-		[0xAB] = "&#x00AB;", // LEFT-POINTING DOUBLE ANGLE QUOTATION MARK
-		[0xAC] = "&#x00AC;", // NOT SIGN
-		[0xAD] = "&#x00AD;", // SOFT HYPHEN
-		[0xAE] = "&#x00AE;", // REGISTERED SIGN
-		[0xAF] = "&#x00AF;", // MACRON
-		[0xB0] = "&#x00B0;", // DEGREE SIGN
-		[0xB1] = "&#x00B1;", // PLUS-MINUS SIGN
-		[0xB2] = "&#x00B2;", // SUPERSCRIPT TWO
-		[0xB3] = "&#x00B3;", // SUPERSCRIPT THREE
-		[0xB4] = "&#x00B4;", // ACUTE ACCENT
-		[0xB5] = "&#x00B5;", // MICRO SIGN
-		[0xB6] = "&#x00B6;", // PILCROW SIGN
-		[0xB7] = "&#x00B7;", // MIDDLE DOT
-		[0xB8] = "&#x00B8;", // CEDILLA
-		[0xB9] = "&#x00B9;", // SUPERSCRIPT ONE
-		[0xBA] = "&#x00BA;", // MASCULINE ORDINAL INDICATOR
-		[0xBB] = "&#x00BB;", // RIGHT-POINTING DOUBLE ANGLE QUOTATION MARK
-		[0xBC] = "&#x00BC;", // VULGAR FRACTION ONE QUARTER
-		[0xBD] = "&#x00BD;", // VULGAR FRACTION ONE HALF
-		[0xBE] = "&#x00BE;", // VULGAR FRACTION THREE QUARTERS
-		[0xBF] = "&#x00BF;", // INVERTED QUESTION MARK
-		[0xC0] = "&#x00C0;", // LATIN CAPITAL LETTER A WITH GRAVE
-		[0xC1] = "&#x00C1;", // LATIN CAPITAL LETTER A WITH ACUTE
-		[0xC2] = "&#x00C2;", // LATIN CAPITAL LETTER A WITH CIRCUMFLEX
-		[0xC3] = "&#x00C3;", // LATIN CAPITAL LETTER A WITH TILDE
-		[0xC4] = "&#x00C4;", // LATIN CAPITAL LETTER A WITH DIAERESIS
-		[0xC5] = "&#x00C5;", // LATIN CAPITAL LETTER A WITH RING ABOVE
-		[0xC6] = "&#x00C6;", // LATIN CAPITAL LETTER AE
-		[0xC7] = "&#x00C7;", // LATIN CAPITAL LETTER C WITH CEDILLA
-		[0xC8] = "&#x00C8;", // LATIN CAPITAL LETTER E WITH GRAVE
-		[0xC9] = "&#x00C9;", // LATIN CAPITAL LETTER E WITH ACUTE
-		[0xCA] = "&#x00CA;", // LATIN CAPITAL LETTER E WITH CIRCUMFLEX
-		[0xCB] = "&#x00CB;", // LATIN CAPITAL LETTER E WITH DIAERESIS
-		[0xCC] = "&#x00CC;", // LATIN CAPITAL LETTER I WITH GRAVE
-		[0xCD] = "&#x00CD;", // LATIN CAPITAL LETTER I WITH ACUTE
-		[0xCE] = "&#x00CE;", // LATIN CAPITAL LETTER I WITH CIRCUMFLEX
-		[0xCF] = "&#x00CF;", // LATIN CAPITAL LETTER I WITH DIAERESIS
-		[0xD0] = "&#x011E;", // LATIN CAPITAL LETTER G WITH BREVE
-		[0xD1] = "&#x00D1;", // LATIN CAPITAL LETTER N WITH TILDE
-		[0xD2] = "&#x00D2;", // LATIN CAPITAL LETTER O WITH GRAVE
-		[0xD3] = "&#x00D3;", // LATIN CAPITAL LETTER O WITH ACUTE
-		[0xD4] = "&#x00D4;", // LATIN CAPITAL LETTER O WITH CIRCUMFLEX
-		[0xD5] = "&#x00D5;", // LATIN CAPITAL LETTER O WITH TILDE
-		[0xD6] = "&#x00D6;", // LATIN CAPITAL LETTER O WITH DIAERESIS
-		[0xD7] = "&#x00D7;", // MULTIPLICATION SIGN
-		[0xD8] = "&#x00D8;", // LATIN CAPITAL LETTER O WITH STROKE
-		[0xD9] = "&#x00D9;", // LATIN CAPITAL LETTER U WITH GRAVE
-		[0xDA] = "&#x00DA;", // LATIN CAPITAL LETTER U WITH ACUTE
-		[0xDB] = "&#x00DB;", // LATIN CAPITAL LETTER U WITH CIRCUMFLEX
-		[0xDC] = "&#x00DC;", // LATIN CAPITAL LETTER U WITH DIAERESIS
-		[0xDD] = "&#x0130;", // LATIN CAPITAL LETTER I WITH DOT ABOVE
-		[0xDE] = "&#x015E;", // LATIN CAPITAL LETTER S WITH CEDILLA
-		[0xDF] = "&#x00DF;", // LATIN SMALL LETTER SHARP S
-		[0xE0] = "&#x00E0;", // LATIN SMALL LETTER A WITH GRAVE
-		[0xE1] = "&#x00E1;", // LATIN SMALL LETTER A WITH ACUTE
-		[0xE2] = "&#x00E2;", // LATIN SMALL LETTER A WITH CIRCUMFLEX
-		[0xE3] = "&#x00E3;", // LATIN SMALL LETTER A WITH TILDE
-		[0xE4] = "&#x00E4;", // LATIN SMALL LETTER A WITH DIAERESIS
-		[0xE5] = "&#x00E5;", // LATIN SMALL LETTER A WITH RING ABOVE
-		[0xE6] = "&#x00E6;", // LATIN SMALL LETTER AE
-		[0xE7] = "&#x00E7;", // LATIN SMALL LETTER C WITH CEDILLA
-		[0xE8] = "&#x00E8;", // LATIN SMALL LETTER E WITH GRAVE
-		[0xE9] = "&#x00E9;", // LATIN SMALL LETTER E WITH ACUTE
-		[0xEA] = "&#x00EA;", // LATIN SMALL LETTER E WITH CIRCUMFLEX
-		[0xEB] = "&#x00EB;", // LATIN SMALL LETTER E WITH DIAERESIS
-		[0xEC] = "&#x00EC;", // LATIN SMALL LETTER I WITH GRAVE
-		[0xED] = "&#x00ED;", // LATIN SMALL LETTER I WITH ACUTE
-		[0xEE] = "&#x00EE;", // LATIN SMALL LETTER I WITH CIRCUMFLEX
-		[0xEF] = "&#x00EF;", // LATIN SMALL LETTER I WITH DIAERESIS
-		[0xF0] = "&#x011F;", // LATIN SMALL LETTER G WITH BREVE
-		[0xF1] = "&#x00F1;", // LATIN SMALL LETTER N WITH TILDE
-		[0xF2] = "&#x00F2;", // LATIN SMALL LETTER O WITH GRAVE
-		[0xF3] = "&#x00F3;", // LATIN SMALL LETTER O WITH ACUTE
-		[0xF4] = "&#x00F4;", // LATIN SMALL LETTER O WITH CIRCUMFLEX
-		[0xF5] = "&#x00F5;", // LATIN SMALL LETTER O WITH TILDE
-		[0xF6] = "&#x00F6;", // LATIN SMALL LETTER O WITH DIAERESIS
-		[0xF7] = "&#x00F7;", // DIVISION SIGN
-		[0xF8] = "&#x00F8;", // LATIN SMALL LETTER O WITH STROKE
-		[0xF9] = "&#x00F9;", // LATIN SMALL LETTER U WITH GRAVE
-		[0xFA] = "&#x00FA;", // LATIN SMALL LETTER U WITH ACUTE
-		[0xFB] = "&#x00FB;", // LATIN SMALL LETTER U WITH CIRCUMFLEX
-		[0xFC] = "&#x00FC;", // LATIN SMALL LETTER U WITH DIAERESIS
-		[0xFD] = "&#x0131;", // LATIN SMALL LETTER DOTLESS I
-		[0xFE] = "&#x015F;", // LATIN SMALL LETTER S WITH CEDILLA
-		[0xFF] = "&#x00FF;", // LATIN SMALL LETTER Y WITH DIAERESIS
-	} /* }}} */
-};
+/* The spec says ISO-6937, but many stations get it wrong and use ISO-8859-1. */
+char *iso6937_encoding = "ISO6937";
 
-/* Quote the xml entities in the string passed in.
- * NB this is returned as a pointer to a string on the heap which will
- * be re-used on the next call to xmlify()
- * Patched by Nick Craig-Wood - nick craig-wood com for more chars with
- * strcat func for tidyness
- */
-char *xmlify(const char *s) {
-	static char *xml = NULL;
-	static unsigned bufsz = 0;
-	char *r;
-	unsigned int table = 0;
-	int max_len = strlen(s) * 10 + 1; /* Max possible expansion of string n * &quot; + NULL */
-		                         /* A little untidy but fast! */
+enum charset { CS_RESERVED, CS_ISO6937, CS_ISO8859, CS_UCS2, CS_UTF8, CS_ICONV };
 
-	/*  Patch by Steve Davies <steve one47 co uk> for better memory management */
-	if (bufsz < max_len || xml == NULL) {
-		xml = realloc(xml, max_len);
-		bufsz = max_len;
-	}
+/* 0xA0-0xFF of table 00 (ISO 6937, with the Euro sign at 0xA4), as UCS-2; {{{
+ * 0 is undefined, and 0xC1-0xCF are the non-spacing diacritics */
+static const uint16_t iso6937_high[96] = {
+	0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x20AC, 0x00A5, 0x0000, 0x00A7,
+	0x00A4, 0x2018, 0x201C, 0x00AB, 0x2190, 0x2191, 0x2192, 0x2193,
+	0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00D7, 0x00B5, 0x00B6, 0x00B7,
+	0x00F7, 0x2019, 0x201D, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x2014, 0x00B9, 0x00AE, 0x00A9, 0x2122, 0x266A, 0x00AC, 0x00A6,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x215B, 0x215C, 0x215D, 0x215E,
+	0x2126, 0x00C6, 0x00D0, 0x00AA, 0x0126, 0x0000, 0x0132, 0x013F,
+	0x0141, 0x00D8, 0x0152, 0x00BA, 0x00DE, 0x0166, 0x014A, 0x0149,
+	0x0138, 0x00E6, 0x0111, 0x00F0, 0x0127, 0x0131, 0x0133, 0x0140,
+	0x0142, 0x00F8, 0x0153, 0x00DF, 0x00FE, 0x0167, 0x014B, 0x00AD,
+}; /* }}} */
+
+/* A diacritic (0xC1-0xCF) followed by a letter (0x40-0x7F) in ISO 6937 {{{ */
+static const uint16_t iso6937_diacritic[15][64] = {
+	[0xC1 - 0xC1] = {
+		0x0000, 0x00C0, 0x0000, 0x0000, 0x0000, 0x00C8, 0x0000, 0x0000,
+		0x0000, 0x00CC, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00D2,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00D9, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x00E0, 0x0000, 0x0000, 0x0000, 0x00E8, 0x0000, 0x0000,
+		0x0000, 0x00EC, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00F2,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00F9, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xC2 - 0xC1] = {
+		0x0000, 0x00C1, 0x0000, 0x0106, 0x0000, 0x00C9, 0x0000, 0x0000,
+		0x0000, 0x00CD, 0x0000, 0x0000, 0x0139, 0x0000, 0x0143, 0x00D3,
+		0x0000, 0x0000, 0x0154, 0x015A, 0x0000, 0x00DA, 0x0000, 0x0000,
+		0x0000, 0x00DD, 0x0179, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x00E1, 0x0000, 0x0107, 0x0000, 0x00E9, 0x0000, 0x0000,
+		0x0000, 0x00ED, 0x0000, 0x0000, 0x013A, 0x0000, 0x0144, 0x00F3,
+		0x0000, 0x0000, 0x0155, 0x015B, 0x0000, 0x00FA, 0x0000, 0x0000,
+		0x0000, 0x00FD, 0x017A, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xC3 - 0xC1] = {
+		0x0000, 0x00C2, 0x0000, 0x0108, 0x0000, 0x00CA, 0x0000, 0x011C,
+		0x0124, 0x00CE, 0x0134, 0x0000, 0x0000, 0x0000, 0x0000, 0x00D4,
+		0x0000, 0x0000, 0x0000, 0x015C, 0x0000, 0x00DB, 0x0000, 0x0174,
+		0x0000, 0x0176, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x00E2, 0x0000, 0x0109, 0x0000, 0x00EA, 0x0000, 0x011D,
+		0x0125, 0x00EE, 0x0135, 0x0000, 0x0000, 0x0000, 0x0000, 0x00F4,
+		0x0000, 0x0000, 0x0000, 0x015D, 0x0000, 0x00FB, 0x0000, 0x0175,
+		0x0000, 0x0177, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xC4 - 0xC1] = {
+		0x0000, 0x00C3, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0128, 0x0000, 0x0000, 0x0000, 0x0000, 0x00D1, 0x00D5,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0168, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x00E3, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0129, 0x0000, 0x0000, 0x0000, 0x0000, 0x00F1, 0x00F5,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0169, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xC5 - 0xC1] = {
+		0x0000, 0x0100, 0x0000, 0x0000, 0x0000, 0x0112, 0x0000, 0x0000,
+		0x0000, 0x012A, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x014C,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x016A, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0101, 0x0000, 0x0000, 0x0000, 0x0113, 0x0000, 0x0000,
+		0x0000, 0x012B, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x014D,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x016B, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xC6 - 0xC1] = {
+		0x0000, 0x0102, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x011E,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x016C, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0103, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x011F,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x016D, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xC7 - 0xC1] = {
+		0x0000, 0x0000, 0x0000, 0x010A, 0x0000, 0x0116, 0x0000, 0x0120,
+		0x0000, 0x0130, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x017B, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x010B, 0x0000, 0x0117, 0x0000, 0x0121,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x017C, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xC8 - 0xC1] = {
+		0x0000, 0x00C4, 0x0000, 0x0000, 0x0000, 0x00CB, 0x0000, 0x0000,
+		0x0000, 0x00CF, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00D6,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00DC, 0x0000, 0x0000,
+		0x0000, 0x0178, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x00E4, 0x0000, 0x0000, 0x0000, 0x00EB, 0x0000, 0x0000,
+		0x0000, 0x00EF, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00F6,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00FC, 0x0000, 0x0000,
+		0x0000, 0x00FF, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xC9 - 0xC1] = {
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xCA - 0xC1] = {
+		0x0000, 0x00C5, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x016E, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x00E5, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x016F, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xCB - 0xC1] = {
+		0x0000, 0x0000, 0x0000, 0x00C7, 0x0000, 0x0000, 0x0000, 0x0122,
+		0x0000, 0x0000, 0x0000, 0x0136, 0x013B, 0x0000, 0x0145, 0x0000,
+		0x0000, 0x0000, 0x0156, 0x015E, 0x0162, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x00E7, 0x0000, 0x0000, 0x0000, 0x0123,
+		0x0000, 0x0000, 0x0000, 0x0137, 0x013C, 0x0000, 0x0146, 0x0000,
+		0x0000, 0x0000, 0x0157, 0x015F, 0x0163, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xCC - 0xC1] = {
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xCD - 0xC1] = {
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0150,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0170, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0151,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0171, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xCE - 0xC1] = {
+		0x0000, 0x0104, 0x0000, 0x0000, 0x0000, 0x0118, 0x0000, 0x0000,
+		0x0000, 0x012E, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0172, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0105, 0x0000, 0x0000, 0x0000, 0x0119, 0x0000, 0x0000,
+		0x0000, 0x012F, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0173, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[0xCF - 0xC1] = {
+		0x0000, 0x0000, 0x0000, 0x010C, 0x010E, 0x011A, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x013D, 0x0000, 0x0147, 0x0000,
+		0x0000, 0x0000, 0x0158, 0x0160, 0x0164, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x017D, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x010D, 0x010F, 0x011B, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x013E, 0x0000, 0x0148, 0x0000,
+		0x0000, 0x0000, 0x0159, 0x0161, 0x0165, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x017E, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+}; /* }}} */
+
+/* 0xA0-0xFF of ISO 8859-1 to -15, as UCS-2; 0 is undefined {{{ */
+static const uint16_t iso8859_high[16][96] = {
+	[1] = {
+		0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+		0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+		0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+		0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+		0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+		0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+		0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+		0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+		0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+		0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+		0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+		0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF,
+	},
+	[2] = {
+		0x00A0, 0x0104, 0x02D8, 0x0141, 0x00A4, 0x013D, 0x015A, 0x00A7,
+		0x00A8, 0x0160, 0x015E, 0x0164, 0x0179, 0x00AD, 0x017D, 0x017B,
+		0x00B0, 0x0105, 0x02DB, 0x0142, 0x00B4, 0x013E, 0x015B, 0x02C7,
+		0x00B8, 0x0161, 0x015F, 0x0165, 0x017A, 0x02DD, 0x017E, 0x017C,
+		0x0154, 0x00C1, 0x00C2, 0x0102, 0x00C4, 0x0139, 0x0106, 0x00C7,
+		0x010C, 0x00C9, 0x0118, 0x00CB, 0x011A, 0x00CD, 0x00CE, 0x010E,
+		0x0110, 0x0143, 0x0147, 0x00D3, 0x00D4, 0x0150, 0x00D6, 0x00D7,
+		0x0158, 0x016E, 0x00DA, 0x0170, 0x00DC, 0x00DD, 0x0162, 0x00DF,
+		0x0155, 0x00E1, 0x00E2, 0x0103, 0x00E4, 0x013A, 0x0107, 0x00E7,
+		0x010D, 0x00E9, 0x0119, 0x00EB, 0x011B, 0x00ED, 0x00EE, 0x010F,
+		0x0111, 0x0144, 0x0148, 0x00F3, 0x00F4, 0x0151, 0x00F6, 0x00F7,
+		0x0159, 0x016F, 0x00FA, 0x0171, 0x00FC, 0x00FD, 0x0163, 0x02D9,
+	},
+	[3] = {
+		0x00A0, 0x0126, 0x02D8, 0x00A3, 0x00A4, 0x0000, 0x0124, 0x00A7,
+		0x00A8, 0x0130, 0x015E, 0x011E, 0x0134, 0x00AD, 0x0000, 0x017B,
+		0x00B0, 0x0127, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x0125, 0x00B7,
+		0x00B8, 0x0131, 0x015F, 0x011F, 0x0135, 0x00BD, 0x0000, 0x017C,
+		0x00C0, 0x00C1, 0x00C2, 0x0000, 0x00C4, 0x010A, 0x0108, 0x00C7,
+		0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+		0x0000, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x0120, 0x00D6, 0x00D7,
+		0x011C, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x016C, 0x015C, 0x00DF,
+		0x00E0, 0x00E1, 0x00E2, 0x0000, 0x00E4, 0x010B, 0x0109, 0x00E7,
+		0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+		0x0000, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x0121, 0x00F6, 0x00F7,
+		0x011D, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x016D, 0x015D, 0x02D9,
+	},
+	[4] = {
+		0x00A0, 0x0104, 0x0138, 0x0156, 0x00A4, 0x0128, 0x013B, 0x00A7,
+		0x00A8, 0x0160, 0x0112, 0x0122, 0x0166, 0x00AD, 0x017D, 0x00AF,
+		0x00B0, 0x0105, 0x02DB, 0x0157, 0x00B4, 0x0129, 0x013C, 0x02C7,
+		0x00B8, 0x0161, 0x0113, 0x0123, 0x0167, 0x014A, 0x017E, 0x014B,
+		0x0100, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x012E,
+		0x010C, 0x00C9, 0x0118, 0x00CB, 0x0116, 0x00CD, 0x00CE, 0x012A,
+		0x0110, 0x0145, 0x014C, 0x0136, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+		0x00D8, 0x0172, 0x00DA, 0x00DB, 0x00DC, 0x0168, 0x016A, 0x00DF,
+		0x0101, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x012F,
+		0x010D, 0x00E9, 0x0119, 0x00EB, 0x0117, 0x00ED, 0x00EE, 0x012B,
+		0x0111, 0x0146, 0x014D, 0x0137, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+		0x00F8, 0x0173, 0x00FA, 0x00FB, 0x00FC, 0x0169, 0x016B, 0x02D9,
+	},
+	[5] = {
+		0x00A0, 0x0401, 0x0402, 0x0403, 0x0404, 0x0405, 0x0406, 0x0407,
+		0x0408, 0x0409, 0x040A, 0x040B, 0x040C, 0x00AD, 0x040E, 0x040F,
+		0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+		0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+		0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427,
+		0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+		0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+		0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+		0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+		0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+		0x2116, 0x0451, 0x0452, 0x0453, 0x0454, 0x0455, 0x0456, 0x0457,
+		0x0458, 0x0459, 0x045A, 0x045B, 0x045C, 0x00A7, 0x045E, 0x045F,
+	},
+	[6] = {
+		0x00A0, 0x0000, 0x0000, 0x0000, 0x00A4, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x060C, 0x00AD, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x061B, 0x0000, 0x0000, 0x0000, 0x061F,
+		0x0000, 0x0621, 0x0622, 0x0623, 0x0624, 0x0625, 0x0626, 0x0627,
+		0x0628, 0x0629, 0x062A, 0x062B, 0x062C, 0x062D, 0x062E, 0x062F,
+		0x0630, 0x0631, 0x0632, 0x0633, 0x0634, 0x0635, 0x0636, 0x0637,
+		0x0638, 0x0639, 0x063A, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0640, 0x0641, 0x0642, 0x0643, 0x0644, 0x0645, 0x0646, 0x0647,
+		0x0648, 0x0649, 0x064A, 0x064B, 0x064C, 0x064D, 0x064E, 0x064F,
+		0x0650, 0x0651, 0x0652, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[7] = {
+		0x00A0, 0x2018, 0x2019, 0x00A3, 0x20AC, 0x20AF, 0x00A6, 0x00A7,
+		0x00A8, 0x00A9, 0x037A, 0x00AB, 0x00AC, 0x00AD, 0x0000, 0x2015,
+		0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x0384, 0x0385, 0x0386, 0x00B7,
+		0x0388, 0x0389, 0x038A, 0x00BB, 0x038C, 0x00BD, 0x038E, 0x038F,
+		0x0390, 0x0391, 0x0392, 0x0393, 0x0394, 0x0395, 0x0396, 0x0397,
+		0x0398, 0x0399, 0x039A, 0x039B, 0x039C, 0x039D, 0x039E, 0x039F,
+		0x03A0, 0x03A1, 0x0000, 0x03A3, 0x03A4, 0x03A5, 0x03A6, 0x03A7,
+		0x03A8, 0x03A9, 0x03AA, 0x03AB, 0x03AC, 0x03AD, 0x03AE, 0x03AF,
+		0x03B0, 0x03B1, 0x03B2, 0x03B3, 0x03B4, 0x03B5, 0x03B6, 0x03B7,
+		0x03B8, 0x03B9, 0x03BA, 0x03BB, 0x03BC, 0x03BD, 0x03BE, 0x03BF,
+		0x03C0, 0x03C1, 0x03C2, 0x03C3, 0x03C4, 0x03C5, 0x03C6, 0x03C7,
+		0x03C8, 0x03C9, 0x03CA, 0x03CB, 0x03CC, 0x03CD, 0x03CE, 0x0000,
+	},
+	[8] = {
+		0x00A0, 0x0000, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+		0x00A8, 0x00A9, 0x00D7, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+		0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+		0x00B8, 0x00B9, 0x00F7, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x2017,
+		0x05D0, 0x05D1, 0x05D2, 0x05D3, 0x05D4, 0x05D5, 0x05D6, 0x05D7,
+		0x05D8, 0x05D9, 0x05DA, 0x05DB, 0x05DC, 0x05DD, 0x05DE, 0x05DF,
+		0x05E0, 0x05E1, 0x05E2, 0x05E3, 0x05E4, 0x05E5, 0x05E6, 0x05E7,
+		0x05E8, 0x05E9, 0x05EA, 0x0000, 0x0000, 0x200E, 0x200F, 0x0000,
+	},
+	[9] = {
+		0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+		0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+		0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+		0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+		0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+		0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+		0x011E, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+		0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x0130, 0x015E, 0x00DF,
+		0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+		0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+		0x011F, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+		0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x0131, 0x015F, 0x00FF,
+	},
+	[10] = {
+		0x00A0, 0x0104, 0x0112, 0x0122, 0x012A, 0x0128, 0x0136, 0x00A7,
+		0x013B, 0x0110, 0x0160, 0x0166, 0x017D, 0x00AD, 0x016A, 0x014A,
+		0x00B0, 0x0105, 0x0113, 0x0123, 0x012B, 0x0129, 0x0137, 0x00B7,
+		0x013C, 0x0111, 0x0161, 0x0167, 0x017E, 0x2015, 0x016B, 0x014B,
+		0x0100, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x012E,
+		0x010C, 0x00C9, 0x0118, 0x00CB, 0x0116, 0x00CD, 0x00CE, 0x00CF,
+		0x00D0, 0x0145, 0x014C, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x0168,
+		0x00D8, 0x0172, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+		0x0101, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x012F,
+		0x010D, 0x00E9, 0x0119, 0x00EB, 0x0117, 0x00ED, 0x00EE, 0x00EF,
+		0x00F0, 0x0146, 0x014D, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x0169,
+		0x00F8, 0x0173, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x0138,
+	},
+	[11] = {
+		0x00A0, 0x0E01, 0x0E02, 0x0E03, 0x0E04, 0x0E05, 0x0E06, 0x0E07,
+		0x0E08, 0x0E09, 0x0E0A, 0x0E0B, 0x0E0C, 0x0E0D, 0x0E0E, 0x0E0F,
+		0x0E10, 0x0E11, 0x0E12, 0x0E13, 0x0E14, 0x0E15, 0x0E16, 0x0E17,
+		0x0E18, 0x0E19, 0x0E1A, 0x0E1B, 0x0E1C, 0x0E1D, 0x0E1E, 0x0E1F,
+		0x0E20, 0x0E21, 0x0E22, 0x0E23, 0x0E24, 0x0E25, 0x0E26, 0x0E27,
+		0x0E28, 0x0E29, 0x0E2A, 0x0E2B, 0x0E2C, 0x0E2D, 0x0E2E, 0x0E2F,
+		0x0E30, 0x0E31, 0x0E32, 0x0E33, 0x0E34, 0x0E35, 0x0E36, 0x0E37,
+		0x0E38, 0x0E39, 0x0E3A, 0x0000, 0x0000, 0x0000, 0x0000, 0x0E3F,
+		0x0E40, 0x0E41, 0x0E42, 0x0E43, 0x0E44, 0x0E45, 0x0E46, 0x0E47,
+		0x0E48, 0x0E49, 0x0E4A, 0x0E4B, 0x0E4C, 0x0E4D, 0x0E4E, 0x0E4F,
+		0x0E50, 0x0E51, 0x0E52, 0x0E53, 0x0E54, 0x0E55, 0x0E56, 0x0E57,
+		0x0E58, 0x0E59, 0x0E5A, 0x0E5B, 0x0000, 0x0000, 0x0000, 0x0000,
+	},
+	[13] = {
+		0x00A0, 0x201D, 0x00A2, 0x00A3, 0x00A4, 0x201E, 0x00A6, 0x00A7,
+		0x00D8, 0x00A9, 0x0156, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00C6,
+		0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x201C, 0x00B5, 0x00B6, 0x00B7,
+		0x00F8, 0x00B9, 0x0157, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00E6,
+		0x0104, 0x012E, 0x0100, 0x0106, 0x00C4, 0x00C5, 0x0118, 0x0112,
+		0x010C, 0x00C9, 0x0179, 0x0116, 0x0122, 0x0136, 0x012A, 0x013B,
+		0x0160, 0x0143, 0x0145, 0x00D3, 0x014C, 0x00D5, 0x00D6, 0x00D7,
+		0x0172, 0x0141, 0x015A, 0x016A, 0x00DC, 0x017B, 0x017D, 0x00DF,
+		0x0105, 0x012F, 0x0101, 0x0107, 0x00E4, 0x00E5, 0x0119, 0x0113,
+		0x010D, 0x00E9, 0x017A, 0x0117, 0x0123, 0x0137, 0x012B, 0x013C,
+		0x0161, 0x0144, 0x0146, 0x00F3, 0x014D, 0x00F5, 0x00F6, 0x00F7,
+		0x0173, 0x0142, 0x015B, 0x016B, 0x00FC, 0x017C, 0x017E, 0x2019,
+	},
+	[14] = {
+		0x00A0, 0x1E02, 0x1E03, 0x00A3, 0x010A, 0x010B, 0x1E0A, 0x00A7,
+		0x1E80, 0x00A9, 0x1E82, 0x1E0B, 0x1EF2, 0x00AD, 0x00AE, 0x0178,
+		0x1E1E, 0x1E1F, 0x0120, 0x0121, 0x1E40, 0x1E41, 0x00B6, 0x1E56,
+		0x1E81, 0x1E57, 0x1E83, 0x1E60, 0x1EF3, 0x1E84, 0x1E85, 0x1E61,
+		0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+		0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+		0x0174, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x1E6A,
+		0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x0176, 0x00DF,
+		0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+		0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+		0x0175, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x1E6B,
+		0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x0177, 0x00FF,
+	},
+	[15] = {
+		0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x20AC, 0x00A5, 0x0160, 0x00A7,
+		0x0161, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+		0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x017D, 0x00B5, 0x00B6, 0x00B7,
+		0x017E, 0x00B9, 0x00BA, 0x00BB, 0x0152, 0x0153, 0x0178, 0x00BF,
+		0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+		0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+		0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+		0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+		0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+		0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+		0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+		0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF,
+	},
+}; /* }}} */
 
-	switch ((unsigned char)*s) {
-		case 0x20 ... 0xFF: // if the first byte of the text field has a value in the range of "0x20" to "0xFF" then this and all subsequent bytes in the text item are coded using the default coding table (table 00 - Latin alphabet) of figure A.1
-			table = 0;
+/* Select the character table of a text field from its first byte(s), {{{
+ * skipping them. For CS_ISO8859, *part is the part of ISO 8859; for CS_ICONV,
+ * *name is the iconv name of the encoding. */
+static enum charset select_charset(const unsigned char **s, size_t *len, int *part, const char **name) {
+	const unsigned char *p = *s;
+	int n;
+
+	if (*len == 0 || p[0] >= 0x20) {
+		// no selector: the default, or whatever -e says it is
+		const char *e = iso6937_encoding;
+		if (!strcasecmp(e, "ISO6937") || !strcasecmp(e, "ISO_6937") || !strcasecmp(e, "ISO-6937"))
+			return CS_ISO6937;
+		n = 0;
+		if (!strncasecmp(e, "ISO-8859-", 9) || !strncasecmp(e, "ISO_8859-", 9))
+			n = atoi(e + 9);
+		else if (!strncasecmp(e, "ISO8859-", 8))
+			n = atoi(e + 8);
+		if (n >= 1 && n <= 15 && n != 12) {
+			*part = n;
+			return CS_ISO8859;
+		}
+		if (!strcasecmp(e, "UTF-8") || !strcasecmp(e, "UTF8"))
+			return CS_UTF8;
+		*name = e;
+		return CS_ICONV;
+	}
+	switch (p[0]) {
+		case 0x01 ... 0x07: // ISO 8859-5 to -11
+		case 0x09 ... 0x0B: // ISO 8859-13 to -15 (0x08, which would be -12, is reserved)
+			*part = p[0] + 4;
+			*s += 1;
+			*len -= 1;
+			return CS_ISO8859;
+		case 0x10: // ISO 8859, part given by the next two bytes
+			if (*len < 3)
+				return CS_RESERVED;
+			n = (p[1] << 8) | p[2];
+			*s += 3;
+			*len -= 3;
+			if (n < 1 || n > 15 || n == 12) {
+				fprintf(stderr, "Unhandled encoding ISO 8859-%d\n", n);
+				return CS_RESERVED;
+			}
+			*part = n;
+			return CS_ISO8859;
+		case 0x11: // Basic Multilingual Plane of ISO/IEC 10646
+			*s += 1;
+			*len -= 1;
+			return CS_UCS2;
+		case 0x12: // KS X 1001 (Korean)
+			*name = "EUC-KR";
+			break;
+		case 0x13: // GB-2312-1980 (Simplified Chinese)
+			*name = "GB2312";
 			break;
-		case 0x01 ... 0x05: // if the first byte of the text field is in the range "0x01" to "0x05" then the remaining bytes in the text item are coded in accordance with character coding table 01 to 05 respectively, which are given in figures A.2 to A.6 respectively
-			table = *s++;
+		case 0x14: // Big5 (Traditional Chinese)
+			*name = "BIG5";
 			break;
-		case 0x10: // if the first byte of the text field has a value "0x10" then the following two bytes carry a 16-bit value (uimsbf) N to indicate that the remaining data of the text field is coded using the character code table specified by ISO Standard 8859, Parts 1 to 9.
-			fprintf(stderr, "Unhandled encoding ISO 8859-%02x%02x\n", s[1], s[2]);
-			s += 3;
-			return NULL;
-		case 0x11: // if the first byte of the text field has a value "0x11" then the ramaining bytes in the text item are coded in pairs in accordance with the Basic Multilingual Plane of ISO/IEC 10646-1
-			fprintf(stderr, "Unhandled encoding ISO 10646-1\n");
-			return NULL;
-		case 0x06 ... 0x0F: case 0x12 ... 0x1F: // Values for the first byte of "0x00", "0x06" to "0x0F", and "0x12" to "0x1F" are reserved for future use.
-			fprintf(stderr, "Reserved encoding: %02x\n", s[0]);
-			return NULL;
-		case 0x00: // empty string
-			return "";
+		case 0x15: // UTF-8
+			*s += 1;
+			*len -= 1;
+			return CS_UTF8;
+		default:
+			fprintf(stderr, "Reserved encoding: %02x\n", p[0]);
+			return CS_RESERVED;
 	}
+	*s += 1;
+	*len -= 1;
+	return CS_ICONV;
+} /*}}}*/
 
-	for (r = xml; *s != '\0'; s++) {
-		unsigned int i = (unsigned char)*s;
-		const char *entity = codeset[table][i];
-		if (!entity[0]) {
-			static char buf[10];
-			snprintf(buf, 10, "<!--%02x-->", i);
-			entity = buf;
+/* Append one ASCII character, as an entity if it must be escaped. {{{
+ * If there isn't room for all of it, nothing is written. */
+static inline char *put_ascii(char *o, char *end, unsigned int c, int escape) {
+	const char *entity;
+	size_t n;
+
+	if (escape && (c == '&' || c == '<' || c == '>')) {
+		entity = (c == '&') ? "&amp;" : (c == '<') ? "&lt;" : "&gt;";
+		n = (c == '&') ? 5 : 4;
+		if ((size_t)(end - o) >= n) {
+			memcpy(o, entity, n);
+			o += n;
+		}
+	} else if (o < end)
+		*o++ = c;
+	return o;
+} /*}}}*/
+
+/* Append a character as UTF-8, if there's room for it. {{{
+ * The control codes of the single-byte tables, and their equivalents
+ * (U+E080-U+E09F) in the multi-byte ones, are dropped, apart from the CR/LF
+ * code, which becomes a newline; so are C0 controls, which XML forbids. */
+static inline char *put_utf8(char *o, char *end, unsigned int c, int escape) {
+	if (c >= 0xE080 && c <= 0xE09F)
+		c -= 0xE000;
+	if (c < 0x20 || (c >= 0x7F && c <= 0x9F)) {
+		if (c != 0x8A)
+			return o;
+		c = '\n';
+	}
+	if (c < 0x80)
+		o = put_ascii(o, end, c, escape);
+	else if (c < 0x800) {
+		if (o + 1 < end) {
+			*o++ = 0xC0 | (c >> 6);
+			*o++ = 0x80 | (c & 0x3F);
 		}
-		while (*entity)
-			*r++ = *entity++;
+	} else if (c < 0x10000) {
+		if (o + 2 < end) {
+			*o++ = 0xE0 | (c >> 12);
+			*o++ = 0x80 | ((c >> 6) & 0x3F);
+			*o++ = 0x80 | (c & 0x3F);
+		}
+	} else if (o + 3 < end) {
+		*o++ = 0xF0 | (c >> 18);
+		*o++ = 0x80 | ((c >> 12) & 0x3F);
+		*o++ = 0x80 | ((c >> 6) & 0x3F);
+		*o++ = 0x80 | (c & 0x3F);
+	}
+	return o;
+} /*}}}*/
+
+/* Scanning for runs of text which can be copied as it is. {{{
+ * Most text (and nearly all of a long description) is printable ASCII, or
+ * UTF-8 with nothing to escape, so the scan looks at 32 or 16 bytes at a time
+ * where the CPU allows and the run is then copied in one go. The run stops at
+ * a control character, at anything which needs escaping if CLEAN_ESCAPE is
+ * given, and at a byte with the top bit set unless CLEAN_HIGH is given. */
+#define CLEAN_HIGH 1
+#define CLEAN_ESCAPE 2
+
+static size_t clean_scalar(const unsigned char *s, size_t len, int flags);
+static size_t (*clean_run)(const unsigned char *s, size_t len, int flags) = clean_scalar;
+
+static size_t clean_scalar(const unsigned char *s, size_t len, int flags) {
+	size_t n;
+
+	for (n = 0; n < len; n++) {
+		if (s[n] < 0x20 || s[n] == 0x7F)
+			break;
+		if (s[n] > 0x7F && !(flags & CLEAN_HIGH))
+			break;
+		if ((flags & CLEAN_ESCAPE) && (s[n] == '&' || s[n] == '<' || s[n] == '>'))
+			break;
+	}
+	return n;
+}
+
+#ifdef __SSE2__
+static size_t clean_sse2(const unsigned char *s, size_t len, int flags) {
+	const __m128i lo = _mm_set1_epi8(0x1F), hi = _mm_set1_epi8(0x7F), zero = _mm_setzero_si128();
+	const __m128i amp = _mm_set1_epi8('&'), lt = _mm_set1_epi8('<'), gt = _mm_set1_epi8('>');
+	size_t n = 0;
+
+	while (n + 16 <= len) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(s + n));
+		// bytes with the top bit set compare as negative, so fail both
+		__m128i ok = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+		if (flags & CLEAN_HIGH)
+			ok = _mm_or_si128(ok, _mm_cmplt_epi8(v, zero));
+		if (flags & CLEAN_ESCAPE)
+			ok = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(v, amp),
+				_mm_or_si128(_mm_cmpeq_epi8(v, lt), _mm_cmpeq_epi8(v, gt))), ok);
+		unsigned int mask = _mm_movemask_epi8(ok);
+		if (mask != 0xFFFF)
+			return n + __builtin_ctz(~mask);
+		n += 16;
+	}
+	return n + clean_scalar(s + n, len - n, flags);
+}
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CLEAN_AVX2 1
+__attribute__((target("avx2")))
+static size_t clean_avx2(const unsigned char *s, size_t len, int flags) {
+	const __m256i lo = _mm256_set1_epi8(0x1F), hi = _mm256_set1_epi8(0x7F), zero = _mm256_setzero_si256();
+	const __m256i amp = _mm256_set1_epi8('&'), lt = _mm256_set1_epi8('<'), gt = _mm256_set1_epi8('>');
+	size_t n = 0;
+
+	while (n + 32 <= len) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(s + n));
+		__m256i ok = _mm256_and_si256(_mm256_cmpgt_epi8(v, lo), _mm256_cmpgt_epi8(hi, v));
+		if (flags & CLEAN_HIGH)
+			ok = _mm256_or_si256(ok, _mm256_cmpgt_epi8(zero, v));
+		if (flags & CLEAN_ESCAPE)
+			ok = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, amp),
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, lt), _mm256_cmpeq_epi8(v, gt))), ok);
+		unsigned int mask = _mm256_movemask_epi8(ok);
+		if (mask != 0xFFFFFFFF)
+			return n + __builtin_ctz(~mask);
+		n += 32;
 	}
-	*r = '\0';
-	return xml;
+	return n + clean_scalar(s + n, len - n, flags);
 }
+#endif
+
+// Pick an implementation once, at startup, before any thread can be
+// decoding: clean_run is never changed afterwards
+__attribute__((constructor))
+static void clean_select(void) {
+#if defined(__SSE2__)
+	clean_run = clean_sse2;
+#endif
+#ifdef CLEAN_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		clean_run = clean_avx2;
+#endif
+} /*}}}*/
+
+/* Copy the run of printable ASCII at the start of s, returning its length. {{{
+ * Latin text is mostly ASCII, and this is the same in every single-byte
+ * table. If escaping, the run stops at the first character which needs it. */
+static inline size_t copy_ascii(const unsigned char *s, size_t len, char *o, char *end, int escape) {
+	size_t n;
+
+	if ((size_t)(end - o) < len)
+		len = end - o;
+	n = clean_run(s, len, escape ? CLEAN_ESCAPE : 0);
+	memcpy(o, s, n);
+	return n;
+} /*}}}*/
+
+/* Copy UTF-8 text, returning the number of bytes of it used. {{{
+ * C0 controls other than newline are dropped, and the output never ends
+ * partway through a sequence. */
+static size_t copy_utf8(const unsigned char *s, size_t len, char **op, char *end, int escape) {
+	const unsigned char *start = s;
+	char *o = *op, *p;
+	size_t n;
+
+	while (len) {
+		n = clean_run(s, len, CLEAN_HIGH | (escape ? CLEAN_ESCAPE : 0));
+		if (n > (size_t)(end - o)) {
+			// out of room: stop at the start of a sequence
+			n = end - o;
+			while (n && (s[n] & 0xC0) == 0x80)
+				n--;
+			memcpy(o, s, n);
+			o += n;
+			s += n;
+			break;
+		}
+		memcpy(o, s, n);
+		s += n;
+		len -= n;
+		o += n;
+		if (!len)
+			break;
+		if (*s >= 0x20 || *s == '\n') {
+			if ((p = put_ascii(o, end, *s, escape)) == o)
+				break;
+			o = p;
+		}
+		s++;
+		len--;
+	}
+	*op = o;
+	return s - start;
+} /*}}}*/
+
+/* Convert with iconv, for the encodings not handled here. {{{
+ * This goes through a small buffer, so that the result can be filtered and
+ * escaped just as UTF-8 text is. Returns NULL, with errno set, if iconv
+ * can't convert from the encoding. */
+static char *decode_iconv(const char *name, const unsigned char *s, size_t len, char *o, char *end, int escape) {
+	char tmp[256];
+	char *inbuf = (char *)s, *t;
+	size_t inbytesleft = len, tmpleft, n;
+	iconv_t cd;
+
+	cd = iconv_open("UTF-8", name);
+	if (cd == (iconv_t)-1)
+		return NULL;
+	while (inbytesleft && o < end) {
+		t = tmp;
+		tmpleft = sizeof(tmp);
+		if (iconv(cd, &inbuf, &inbytesleft, &t, &tmpleft) == (size_t)-1) {
+			if (errno == EILSEQ) {
+				// skip anything which can't be converted
+				inbuf++;
+				inbytesleft--;
+			} else if (errno != E2BIG)
+				inbytesleft = 0;
+		}
+		n = t - tmp;
+		if (copy_utf8((const unsigned char *)tmp, n, &o, end, escape) < n)
+			break;
+	}
+	iconv_close(cd);
+	return o;
+} /*}}}*/
+
+/* Decode len bytes of DVB text into UTF-8, optionally escaping it for XML. {{{
+ * At most size - 1 bytes are written to out, followed by a NUL, and the
+ * number of bytes written (not counting the NUL) is returned; if the text's
+ * encoding can't be converted, out is left empty and (size_t)-1 is returned,
+ * with errno set. */
+static size_t decode(const char *text, size_t len, char *out, size_t size, int escape) {
+	const unsigned char *s = (const unsigned char *)text;
+	const uint16_t *high = NULL;
+	const char *name = NULL;
+	char *o = out, *end;
+	int part = 0;
+	unsigned int c;
+
+	if (size == 0)
+		return 0;
+	end = out + size - 1;
+	switch (select_charset(&s, &len, &part, &name)) {
+		case CS_RESERVED:
+			break;
+		case CS_ISO6937:
+			high = iso6937_high;
+			// fall through
+		case CS_ISO8859:
+			if (high == NULL)
+				high = iso8859_high[part];
+			while (len && o < end) {
+				size_t n = copy_ascii(s, len, o, end, escape);
+				s += n;
+				len -= n;
+				o += n;
+				if (!len || o >= end)
+					break;
+				c = *s++;
+				len--;
+				if (c >= 0xA0) {
+					if (high == iso6937_high && c >= 0xC1 && c <= 0xCF) {
+						// a non-spacing diacritic, which applies to the next letter
+						if (!len)
+							break;
+						if (*s >= 0x40 && *s < 0x80 && iso6937_diacritic[c - 0xC1][*s - 0x40]) {
+							c = iso6937_diacritic[c - 0xC1][*s - 0x40];
+							s++;
+							len--;
+						} else
+							continue;
+					} else
+						c = high[c - 0xA0];
+					if (!c)
+						continue;
+				}
+				o = put_utf8(o, end, c, escape);
+			}
+			break;
+		case CS_UCS2:
+			// UTF-16 in practice: a surrogate pair is one character, and
+			// a surrogate without its other half becomes U+FFFD
+			for ( ; len >= 2 && o < end; s += 2, len -= 2) {
+				c = (s[0] << 8) | s[1];
+				if (c >= 0xD800 && c <= 0xDBFF && len >= 4 && s[2] >= 0xDC && s[2] <= 0xDF) {
+					c = 0x10000 + ((c - 0xD800) << 10) + (((s[2] << 8) | s[3]) - 0xDC00);
+					s += 2;
+					len -= 2;
+				} else if (c >= 0xD800 && c <= 0xDFFF)
+					c = 0xFFFD;
+				o = put_utf8(o, end, c, escape);
+			}
+			break;
+		case CS_UTF8:
+			copy_utf8(s, len, &o, end, escape);
+			break;
+		case CS_ICONV:
+			if ((o = decode_iconv(name, s, len, o, end, escape)) == NULL) {
+				*out = '\0';
+				return (size_t)-1;
+			}
+			break;
+	}
+	*o = '\0';
+	return o - out;
+} /*}}}*/
+
+/* Decode len bytes of DVB text into UTF-8. {{{ */
+size_t dvb_text_decode(const char *text, size_t len, char *out, size_t size) {
+	return decode(text, len, out, size, 0);
+} /*}}}*/
+
+/* Decode len bytes of DVB text into UTF-8, quoting the xml entities. {{{
+ * As dvb_text_decode(), this writes into the buffer it's given and can be
+ * used from more than one thread; the output can be up to six times the size
+ * of the input. */
+size_t xmlify_r(const char *text, size_t len, char *out, size_t size) {
+	return decode(text, len, out, size, 1);
+} /*}}}*/
+
+/* Quote the xml entities in the string passed in.
+ * NB this is returned as a pointer to a static buffer which will be re-used
+ * on the next call to xmlify()
+ */
+char *xmlify(const char *s) {
+	xmlify_r(s, strlen(s), result, sizeof(result));
+	return result;
+} // xmlify
 
 #ifdef MAIN
 int main(int argc, char **argv) {
 	if (argc > 1)
 		printf("%s\n%s\n", argv[1], xmlify(argv[1]));
 	return 0;
-}
+} // main
 #endif
 // vim: foldmethod=marker
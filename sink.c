@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "sink.h"
+
+#include "tv_grab_dvb.h"
+
+#define SINK_DEFAULT_SIZE               (256 * 1024)
+
+/* Write out every byte described by iov, or record the error */
+static int
+sink_writev(sink_t *sink, struct iovec *iov, int iovcnt)
+{
+	ssize_t r;
+
+	while(iovcnt)
+	{
+		if(-1 == (r = writev(sink->fd, iov, iovcnt)))
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			if(!sink->error)
+			{
+				sink->error = errno;
+			}
+			return -1;
+		}
+		while(iovcnt && (size_t) r >= iov->iov_len)
+		{
+			r -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if(iovcnt)
+		{
+			iov->iov_base = (char *) iov->iov_base + r;
+			iov->iov_len -= r;
+		}
+	}
+	return 0;
+}
+
+/* Prepare a sink writing to fd (or to memory, if fd is -1), with a buffer of
+ * size bytes, or a default size if zero
+ */
+int
+sink_init(sink_t *sink, int fd, size_t size)
+{
+	memset(sink, 0, sizeof(sink_t));
+	sink->fd = fd;
+	if(!size)
+	{
+		size = SINK_DEFAULT_SIZE;
+	}
+	if(NULL == (sink->buf = malloc(size)))
+	{
+		return -1;
+	}
+	sink->size = size;
+	return 0;
+}
+
+/* Flush and free the buffer (the file descriptor is left open); returns -1
+ * if any write to the sink failed.
+ */
+int
+sink_close(sink_t *sink)
+{
+	sink_flush(sink);
+	free(sink->buf);
+	sink->buf = NULL;
+	sink->len = sink->size = 0;
+	if(sink->error)
+	{
+		errno = sink->error;
+		return -1;
+	}
+	return 0;
+}
+
+int
+sink_flush(sink_t *sink)
+{
+	struct iovec iov;
+	int r;
+
+	if(sink->fd == -1 || !sink->len)
+	{
+		return 0;
+	}
+	iov.iov_base = sink->buf;
+	iov.iov_len = sink->len;
+	r = sink_writev(sink, &iov, 1);
+	sink->flushed += sink->len;
+	sink->len = 0;
+	return r;
+}
+
+/* Return a pointer to at least len bytes of space at the end of the buffer,
+ * flushing or growing it as needed; once something has been written there,
+ * sink_commit() adds it to the output.
+ */
+char *
+sink_reserve(sink_t *sink, size_t len)
+{
+	size_t size;
+	char *p;
+
+	if(sink->size - sink->len >= len)
+	{
+		return sink->buf + sink->len;
+	}
+	if(sink->fd != -1)
+	{
+		sink_flush(sink);
+		if(sink->size >= len)
+		{
+			return sink->buf;
+		}
+	}
+	for(size = (sink->size ? sink->size : SINK_DEFAULT_SIZE); size - sink->len < len; size *= 2);
+	if(NULL == (p = realloc(sink->buf, size)))
+	{
+		if(!sink->error)
+		{
+			sink->error = errno;
+		}
+		return NULL;
+	}
+	sink->buf = p;
+	sink->size = size;
+	return sink->buf + sink->len;
+}
+
+void
+sink_commit(sink_t *sink, size_t len)
+{
+	sink->len += len;
+}
+
+/* Return the position of the end of the output, which can be passed to
+ * sink_rewind() to take back anything written after it
+ */
+size_t
+sink_mark(sink_t *sink)
+{
+	return sink->flushed + sink->len;
+}
+
+/* Discard the output written since mark was taken; returns -1 if some of it
+ * has already been written out, which sink_reserve() can be used beforehand
+ * to avoid.
+ */
+int
+sink_rewind(sink_t *sink, size_t mark)
+{
+	if(mark < sink->flushed || mark > sink->flushed + sink->len)
+	{
+		return -1;
+	}
+	sink->len = mark - sink->flushed;
+	return 0;
+}
+
+int
+sink_write(sink_t *sink, const void *data, size_t len)
+{
+	struct iovec iov[2];
+	char *p;
+	int r;
+
+	if(sink->size - sink->len >= len)
+	{
+		memcpy(sink->buf + sink->len, data, len);
+		sink->len += len;
+		return 0;
+	}
+	if(sink->fd != -1 && len >= sink->size)
+	{
+		/* Not worth copying: write it out along with the buffer */
+		iov[0].iov_base = sink->buf;
+		iov[0].iov_len = sink->len;
+		iov[1].iov_base = (void *) data;
+		iov[1].iov_len = len;
+		r = sink_writev(sink, iov, 2);
+		sink->flushed += sink->len + len;
+		sink->len = 0;
+		return r;
+	}
+	if(NULL == (p = sink_reserve(sink, len)))
+	{
+		return -1;
+	}
+	memcpy(p, data, len);
+	sink->len += len;
+	return 0;
+}
+
+int
+sink_puts(sink_t *sink, const char *s)
+{
+	return sink_write(sink, s, strlen(s));
+}
+
+/* Format straight into the buffer; only if the output doesn't fit in the
+ * space left is it formatted a second time, once there's room.
+ */
+int
+sink_printf(sink_t *sink, const char *format, ...)
+{
+	va_list ap;
+	size_t avail;
+	char *p;
+	int n;
+
+	avail = sink->size - sink->len;
+	va_start(ap, format);
+	n = vsnprintf(sink->buf + sink->len, avail, format, ap);
+	va_end(ap);
+	if(n < 0)
+	{
+		return -1;
+	}
+	if((size_t) n >= avail)
+	{
+		if(NULL == (p = sink_reserve(sink, n + 1)))
+		{
+			return -1;
+		}
+		va_start(ap, format);
+		vsnprintf(p, n + 1, format, ap);
+		va_end(ap);
+	}
+	sink->len += n;
+	return 0;
+}
+
+/* Decode len bytes of DVB text and write it quoted for XML, without any
+ * intermediate copy; returns -1, having written nothing, if the text can't
+ * be decoded
+ */
+int
+sink_xmlify(sink_t *sink, const char *s, size_t len)
+{
+	char *p;
+	size_t n;
+
+	if(NULL == (p = sink_reserve(sink, len * 6 + 1)))
+	{
+		return -1;
+	}
+	if((size_t) -1 == (n = xmlify_r(s, len, p, len * 6 + 1)))
+	{
+		return -1;
+	}
+	sink->len += n;
+	return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef SINK_H_
+# define SINK_H_                        1
+
+# include <stddef.h>
+
+typedef struct sink_struct sink_t;
+
+/* A buffered output stream: output is accumulated in one large buffer and
+ * written out with write() when it fills, rather than going through stdio.
+ * A sink with an fd of -1 never flushes, and grows its buffer instead, so
+ * that output can be assembled in memory.
+ */
+struct sink_struct
+{
+	int fd;
+	char *buf;
+	size_t len;
+	size_t size;
+	/* The number of bytes written out so far */
+	size_t flushed;
+	/* The errno of the first failed write, or 0 */
+	int error;
+};
+
+int sink_init(sink_t *sink, int fd, size_t size);
+int sink_close(sink_t *sink);
+int sink_flush(sink_t *sink);
+char *sink_reserve(sink_t *sink, size_t len);
+void sink_commit(sink_t *sink, size_t len);
+size_t sink_mark(sink_t *sink);
+int sink_rewind(sink_t *sink, size_t mark);
+int sink_write(sink_t *sink, const void *data, size_t len);
+int sink_puts(sink_t *sink, const char *s);
+int sink_printf(sink_t *sink, const char *format, ...) __attribute__((format(printf, 2, 3)));
+int sink_xmlify(sink_t *sink, const char *s, size_t len);
+
+#endif /*!SINK_H_ */
@@ -0,0 +1,63 @@
+/*
+ * Check that each spelling of an ISO 8859 part accepted by -e selects the
+ * same character table for text without a selector, and the decoding of
+ * text which starts with one.
+ *
+ * Usage: texttest (exits non-zero if any check fails)
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tv_grab_dvb.h"
+
+static const struct {
+	const char *encoding;
+	const char *text;
+	const char *expect;
+} checks[] = {
+	{ "ISO-8859-1", "Caf\xe9", "Caf\xc3\xa9" },
+	{ "ISO_8859-1", "Caf\xe9", "Caf\xc3\xa9" },
+	{ "ISO8859-1", "Caf\xe9", "Caf\xc3\xa9" },
+	{ "iso-8859-7", "\xe1\xe2", "\xce\xb1\xce\xb2" },
+	{ "ISO_8859-7", "\xe1\xe2", "\xce\xb1\xce\xb2" },
+	{ "ISO8859-7", "\xe1\xe2", "\xce\xb1\xce\xb2" },
+};
+
+static const struct {
+	const char *text;
+	size_t len;
+	const char *expect;
+} selected[] = {
+	// UCS-2: a surrogate pair is one character, a lone surrogate is U+FFFD
+	{ "\x11\xd8\x3d\xde\x00", 5, "\xf0\x9f\x98\x80" },
+	{ "\x11\xd8\x3d\x00\x41", 5, "\xef\xbf\xbd" "A" },
+	{ "\x11\xde\x00", 3, "\xef\xbf\xbd" },
+	// 0x08 would be ISO 8859-12, which doesn't exist
+	{ "\x08\xe9", 2, "" },
+};
+
+int main(void) {
+	char out[64];
+	size_t i;
+	int failed = 0;
+
+	for (i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+		iso6937_encoding = (char *)checks[i].encoding;
+		dvb_text_decode(checks[i].text, strlen(checks[i].text), out, sizeof(out));
+		if (strcmp(out, checks[i].expect)) {
+			printf("FAIL: %s\n", checks[i].encoding);
+			failed = 1;
+		}
+	}
+	for (i = 0; i < sizeof(selected) / sizeof(selected[0]); i++) {
+		dvb_text_decode(selected[i].text, selected[i].len, out, sizeof(out));
+		if (strcmp(out, selected[i].expect)) {
+			printf("FAIL: selected text %d\n", (int)i);
+			failed = 1;
+		}
+	}
+	if (!failed)
+		printf("ok\n");
+	return failed;
+}
@@ -33,12 +33,10 @@ const char *id = "@(#) $Id$";
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
-#include <sys/poll.h>
 #include <errno.h>
 #include <getopt.h>
 #include <stdarg.h>
 #include <stdint.h>
-#include <signal.h>
 #include <time.h>
 #include <stdbool.h>
 #include <assert.h>
@@ -47,6 +45,7 @@ const char *id = "@(#) $Id$";
 #include "tv_grab_dvb.h"
 #include "xmltv.h"
 #include "tvanytime.h"
+#include "atom.h"
 
 /* FIXME: put these as options */
 #define CHANNELS_CONF "channels.conf"
@@ -56,10 +55,10 @@ static char *ProgName;
 static char *demux = "/dev/dvb/adapter0/demux0";
 
 int timeout  = 10;
+int debug_level = 0;
 static int packet_count = 0;
 int programme_count = 0;
 int update_count  = 0;
-static int crcerr_count  = 0;
 int time_offset   = 0;
 int invalid_date_count = 0;
 static int chan_filter	     = 0;
@@ -71,16 +70,45 @@ static bool silent = false;
 static int service_scan;
 static int halt_after_service_scan;
 static int generate_atom;
+static bool raw_ts = false;
+static dvb_schedule_t *schedule;
+
+/* The inputs, all serviced by one reactor. Until scan_until, the SI tables
+ * read are parsed into services, which are written to ServiceInformation.xml
+ * once the scan ends; nscan counts the SI filters still being read from a
+ * demux device, and eit_input is the EIT filter which follows them.
+ */
+static dvb_reactor_t *reactor;
+static dvb_demux_t *inputs[3], *eit_input;
+static size_t ninputs, nscan;
+static time_t scan_until;
+static bool scanning;
+static tva_options_t svc_opts;
+static sink_t svc_out;
+static int svc_fd = -1;
+
+/* The outputs: each is written to the file named with -W (or to stdout if
+ * that's "-"), and is off if that's NULL. Each is fed the decoded events.
+ */
+static const char *xmltv_path, *atom_path, *tva_path;
+static sink_t xmltv_out, atom_out, tva_out;
+static int xmltv_fd = -1, atom_fd = -1, tva_fd = -1;
+static xmltv_options_t xmltv_opts;
+static dvb_writer_t xmltv_writer = { "xmltv", NULL, xmltv_write_event, &xmltv_opts, NULL };
+static atom_options_t atom_opts;
+static dvb_writer_t atom_writer = { "atom", NULL, atom_write_event, &atom_opts, NULL };
+static tva_options_t tva_prog_opts;
+static dvb_writer_t tva_prog_writer = { "tva", NULL, tva_write_event, &tva_prog_opts, NULL };
 
 struct lookup_table *channelid_table;
-struct chninfo *channels;
 
 /* Print usage information. {{{ */
 static void usage() {
-	fprintf(stderr, "Usage: %s [-d] [-u] [-c] [-n|m|p] [-s] [-t timeout]\n"
-			"\t[-e encoding] [-o offset] [-i file] [-f file]\n\n"
+	fprintf(stderr, "Usage: %s [-d] [-u] [-c] [-n|m|p] [-s] [-T] [-t timeout]\n"
+			"\t[-e encoding] [-o offset] [-i file] [-f file] [-W format:file]\n\n"
 			"\t-i file - Read from file/device instead of %s\n"
 			"\t-f file - Write output to file instead of stdout\n"
+			"\t-T - input is a raw MPEG transport stream rather than sections\n"
 			"\t-t timeout - Stop after timeout seconds of no new data\n"
 			"\t-o offset  - time offset in hours from -12 to 12\n"
 			"\t-c - Use Channel Identifiers from file 'chanidents'\n"
@@ -96,6 +124,8 @@ static void usage() {
 			"\t-H - halt after performing service scan\n"
 			"\t-a - generate an Atom feed instead of XMLTV\n"
 			"\t-A - generate an Atom feed per service in current directory\n"
+			"\t-W format:file - Also write format (xmltv, atom or tva) to file, from the same scan\n"
+			"\t-D level - Set debug level to level (0 = none, 9 = highest)\n"
 		"\n", ProgName, demux);
 	_exit(1);
 } /*}}}*/
@@ -103,8 +133,8 @@ static void usage() {
 /* Print progress indicator. {{{ */
 static void status() {
 	if (!silent) {
-		fprintf(stderr, "\r Status: %d pkts, %d prgms, %d updates, %d invalid, %d CRC err\n",
-				packet_count, programme_count, update_count, invalid_date_count, crcerr_count);
+		fprintf(stderr, "\r Status: %d pkts, %d prgms, %d updates, %d invalid\n",
+				packet_count, programme_count, update_count, invalid_date_count);
 	}
 } /*}}}*/
 
@@ -114,13 +144,15 @@ static int do_options(int arg_count, char **arg_strings) {
 		{"help", 0, 0, 'h'},
 		{"timeout", 1, 0, 't'},
 		{"chanidents", 1, 0, 'c'},
+		{"debug", 1, 0, 'D'},
 		{0, 0, 0, 0}
 	};
 	int Option_Index = 0;
 	int fd;
+	char buf[8];
 
 	while (1) {
-		int c = getopt_long(arg_count, arg_strings, "udscmpnht:o:f:i:e:S:HaA", Long_Options, &Option_Index);
+		int c = getopt_long(arg_count, arg_strings, "udscmpnhTt:o:f:i:e:S:HaAW:D:", Long_Options, &Option_Index);
 		if (c == EOF)
 			break;
 		switch (c) {
@@ -173,6 +205,9 @@ static int do_options(int arg_count, char **arg_strings) {
 		case 's':
 			silent = true;
 			break;
+		case 'T':
+			raw_ts = true;
+			break;
 		case 'S':
 			service_scan = atoi(optarg);
 			if (0 == service_scan) {
@@ -182,15 +217,36 @@ static int do_options(int arg_count, char **arg_strings) {
 			break;			
 		case 'e':
 			iso6937_encoding = optarg;
+			if (dvb_text_decode("A", 1, buf, sizeof(buf)) == (size_t)-1) {
+				fprintf(stderr, "%s: Unsupported encoding '%s'\n", ProgName, optarg);
+				usage();
+			}
 			break;
 		case 'H':
 			halt_after_service_scan = 1;
 			break;
 		case 'a':
 			generate_atom = 1;
+			atom_path = "-";
 			break;
 		case 'A':
 			generate_atom = 2;
+			atom_opts.dir = ".";
+			break;
+		case 'W':
+			if (!strncmp(optarg, "xmltv:", 6) && optarg[6])
+				xmltv_path = optarg + 6;
+			else if (!strncmp(optarg, "atom:", 5) && optarg[5])
+				atom_path = optarg + 5;
+			else if (!strncmp(optarg, "tva:", 4) && optarg[4])
+				tva_path = optarg + 4;
+			else {
+				fprintf(stderr, "%s: Invalid output '%s'\n", ProgName, optarg);
+				usage();
+			}
+			break;
+		case 'D':
+			debug_level = atoi(optarg);
 			break;
 		case 'h':
 		case '?':
@@ -218,164 +274,214 @@ char *get_channelident(int chanid) {
 	return returnstring;
 } /*}}}*/
 
+/* Open an output file, or stdout if path is "-". {{{ */
+static sink_t *openOutput(const char *path, sink_t *sink, int *fd) {
+	if (!strcmp(path, "-"))
+		*fd = STDOUT_FILENO;
+	else if ((*fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0666)) < 0) {
+		fprintf(stderr, "%s: Can't write file %s\n", ProgName, path);
+		exit(1);
+	}
+	if (sink_init(sink, *fd, 0)) {
+		perror("sink_init");
+		exit(1);
+	}
+	return sink;
+} /*}}}*/
+
+/* Flush and close an output. {{{ */
+static void closeOutput(const char *path, sink_t *sink, int fd) {
+	if (sink_close(sink))
+		perror(strcmp(path, "-") ? path : "write");
+	if (fd != STDOUT_FILENO)
+		close(fd);
+} /*}}}*/
+
+/* Flush and close every output which was opened. {{{ */
+static void closeOutputs() {
+	if (xmltv_opts.out)
+		closeOutput(xmltv_path, &xmltv_out, xmltv_fd);
+	if (atom_opts.out)
+		closeOutput(atom_path, &atom_out, atom_fd);
+	if (tva_prog_opts.out)
+		closeOutput(tva_path, &tva_out, tva_fd);
+} /*}}}*/
+
 /* Exit hook: close xml tags. {{{ */
 static void finish_up() {
 	if (!silent)
 		fprintf(stderr, "\n");
-	printf("</tv>\n");
+	if (xmltv_opts.out)
+		xmltv_postamble(&xmltv_opts);
+	if (atom_path || atom_opts.dir)
+		atom_postamble(&atom_opts);
+	if (tva_prog_opts.out)
+		tva_postamble_programme(&tva_prog_opts);
+	closeOutputs();
 	exit(0);
 } /*}}}*/
 
-static void dummy_alarm() {
-}
-
-/* Read EIT segments from DVB-demuxer or file. {{{ */
-static void readEventTables(int fd, void *handler, time_t until, dvb_callbacks_t *callbacks) {
-	int r, n = 0;
-	char buf[1<<12], *bhead = buf;
-	int (*handlerfn)(void *data, size_t len, dvb_callbacks_t *callbacks);
-	
-	handlerfn = handler;
-	/* The dvb demultiplexer simply outputs individual whole packets (good),
-	 * but reading captured data from a file needs re-chunking. (bad). */
-	do {
-		if (n < sizeof(struct si_tab))
-		{
-			fprintf(stderr, "Table is too small\n");	   
-			goto read_more;
-		}
-		struct si_tab *tab = (struct si_tab *)bhead;
-/*		if (GetTableId(tab) == 0)
-		{
-			fprintf(stderr, "Table ID = 0x%02x\n", GetTableId(tab));
-			goto read_more;
-			}*/
-		size_t l = sizeof(struct si_tab) + GetSectionLength(tab);
-		if (n < l)
-			goto read_more;
-		packet_count++;
-		if (_dvb_crc32((uint8_t *)bhead, l) != 0) {
-			/* data or length is wrong. skip bytewise. */
-			//l = 1; // FIXME
-			crcerr_count++;
-		} else {
-			fprintf(stderr, "calling handler\n");
-			if(handlerfn(bhead, l, callbacks) != 0)
-			{
-				break;
+/* End the service scan, writing out the services found. {{{ */
+static void endServiceScan() {
+	if (!scanning)
+		return;
+	scanning = false;
+	service_foreach(tva_write_service, &svc_opts);
+	tva_postamble_service(&svc_opts);
+	if (sink_close(&svc_out))
+		perror("ServiceInformation.xml");
+	close(svc_fd);
+} /*}}}*/
+
+/* Expect a schedule from each service whose SDT entry says it has one. {{{ */
+static int expectSchedule(service_t *svc, void *data) {
+	int onid, tsid, sid;
+
+	if (service_eit_schedule(svc) && !service_dvb(svc, &onid, &tsid, &sid))
+		dvb_schedule_expect(data, onid, tsid, sid);
+	return 0;
+} /*}}}*/
+
+/* Parse an EIT section, stopping once every schedule announced is complete. {{{ */
+static int parseEITSchedule(void *data, size_t len, dvb_callbacks_t *callbacks) {
+	parseEIT(data, len, callbacks);
+	if (dvb_schedule_add(schedule, data) == 1) {
+		if (!silent)
+			fprintf(stderr, "\nschedule complete");
+		return 1;
+	}
+	return 0;
+} /*}}}*/
+
+/* Handle a table read from one of the inputs. {{{
+ * The NIT and SDTs are parsed until the service scan ends, and each section
+ * of an EIT is parsed as an event table; returning non-zero detaches the
+ * input the table was read from. The reactor passes a NULL table once an
+ * input has expired. */
+static int readTable(dvb_demux_t *ctx, dvb_table_t *table, void *data) {
+	dvb_callbacks_t *callbacks = data;
+	size_t i;
+
+	if (table == NULL) {
+		/* The EIT filter isn't started until every SI filter has expired */
+		if (ctx != eit_input && nscan && --nscan == 0) {
+			endServiceScan();
+			if (eit_input && dvb_reactor_add(reactor, eit_input, 0, readTable, callbacks)) {
+				perror("dvb_reactor_add");
+				exit(1);
 			}
 		}
-		status();
-		/* remove packet */
-		n -= l;
-		bhead += l;
-		continue;
-read_more:
-		/* move remaining data to front of buffer */
-		if (n > 0)
-			memmove(buf, bhead, n);
-		/* fill with fresh data */
-		do
-		{
-			r = read(fd, buf+n, sizeof(buf)-n);
-		}
-		while((!until || time(NULL) < until) && r == -1 && errno == EINTR);		
-		if(until && time(NULL) >= until)
-		{
-			fprintf(stderr, "--- Timer reached --\n");
-			break;
-		}
-		if(r == -1)
-		{
-			perror("read error");
-			break;
+		return 0;
+	}
+	if (scanning && time(NULL) >= scan_until)
+		endServiceScan();
+	packet_count += table->nsections;
+	if (table->table_id >= 0x4e && table->table_id <= 0x6f) {
+		if (halt_after_service_scan)
+			return 0;
+		if (chan_filter_mask && (table->table_id & chan_filter_mask) != chan_filter)
+			return 0;
+		for (i = 0; i < table->nsections; i++) {
+			if (table->sections[i] == NULL)
+				continue;
+			if (parseEITSchedule(table->sections[i], GetSectionLength(table->sections[i]) + sizeof(si_tab_t), callbacks))
+				return 1;
 		}
-		fprintf(stderr, "read %d bytes\n", r);
-		bhead = buf;
-		n += r;
-	} while (r > 0);
+		status();
+		return 0;
+	}
+	if (scanning && (table->table_id == 0x40 || table->table_id == 0x42 || table->table_id == 0x46))
+		dvb_parse_si(table, callbacks);
+	status();
+	return 0;
 } /*}}}*/
 
-/* Setup demuxer or open file as STDIN. {{{ */
-static int openInput(int pid) {
-	int fd_epg, to;
-	struct stat stat_buf;
-	struct dmx_sct_filter_params sctFilterParams = {
-		.pid = pid,
-		.timeout = 0,
-		.flags =  DMX_IMMEDIATE_START,
-		.filter = {
-			.filter[0] = 0,
-			.mask[0] = 0,
-		},
-	};
-	if(pid == 0x0012)
-	{
-		/* EIT PID */
+/* Open a demux device with a section filter. {{{ */
+static dvb_demux_t *openFilter(int pid, int first_table_id, int last_table_id) {
+	struct dmx_sct_filter_params sctFilterParams;
+	dvb_demux_t *ctx;
+
+	dvb_filter_tables(&sctFilterParams, pid, first_table_id, last_table_id);
+	if (pid == 0x0012 && chan_filter_mask) {
+		/* EIT PID, restricted to now/next */
 		sctFilterParams.filter.filter[0] = chan_filter;
 		sctFilterParams.filter.mask[0] = chan_filter_mask;
 	}
-
-	if (demux == NULL)
-		return 0; // Read from STDIN, which is open al
-
-	if ((fd_epg = dvb_demux_open_path(demux, &sctFilterParams, NULL, NULL)) < 0) {
-		perror("fd_epg DEVICE: ");
-		return -1;
+	sctFilterParams.flags |= DMX_IMMEDIATE_START;
+	if ((ctx = dvb_demux_open_path(demux, &sctFilterParams, NULL, 0)) == NULL) {
+		perror(demux);
+		exit(1);
 	}
+	dvb_demux_set_timeout(ctx, timeout);
+	return ctx;
+} /*}}}*/
 
-	if (fstat(fd_epg, &stat_buf) < 0) {
-		perror("fd_epg DEVICE: ");
-		return -1;
-	}
-	if (S_ISCHR(stat_buf.st_mode)) {
-		bool found = false;
-
-		for (to = timeout; to > 0; to--) {
-			int res;
-			struct pollfd ufd = {
-				.fd = fd_epg,
-				.events = POLLIN,
-			};
-
-			res = poll(&ufd, 1, 1000);
-			if (0 == res) {
-				fprintf(stderr, ".");
-				fflush(stderr);
+/* Setup demuxer or open file, or STDIN, and attach it to the reactor. {{{
+ * A demux device gets a context for each of the NIT, SDT and EIT PIDs, and
+ * the EIT isn't read until the service scan has finished; anything else is
+ * read once, from start to finish, as a single context which yields every
+ * table (from the SI PIDs, if it's a transport stream). */
+static void openInput(dvb_callbacks_t *callbacks) {
+	struct stat stat_buf;
+	dvb_demux_t *ctx;
+	int pids[3], npids = 0;
+
+	if (demux && !raw_ts && stat(demux, &stat_buf) == 0 && S_ISCHR(stat_buf.st_mode)) {
+		if (service_scan) {
+			inputs[ninputs++] = openFilter(0x0010, 0x40, 0x40);
+			inputs[ninputs++] = openFilter(0x0011, 0x42, 0x46);
+			nscan = ninputs;
+		}
+		if (!halt_after_service_scan)
+			inputs[ninputs++] = eit_input = openFilter(0x0012, 0x4e, 0x6f);
+		for (size_t i = 0; i < ninputs; i++) {
+			if (inputs[i] == eit_input && nscan)
 				continue;
+			if (dvb_reactor_add(reactor, inputs[i], inputs[i] == eit_input ? 0 : scan_until, readTable, callbacks)) {
+				perror("dvb_reactor_add");
+				exit(1);
 			}
-			if (1 == res) {
-				found = true;
-				break;
-			}
-			fprintf(stderr, "error polling for data\n");
-			close(fd_epg);
-			return -1;
 		}
-		fprintf(stdout, "\n");
-		if (!found) {
-			fprintf(stderr, "timeout - try tuning to a multiplex?\n");
-			close(fd_epg);
-			return -1;
+		return;
+	}
+	if (demux == NULL) {
+		fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+		ctx = dvb_demux_open_fd(STDIN_FILENO, NULL, NULL, 0);
+	} else {
+		ctx = dvb_demux_open_path(demux, NULL, NULL, 0);
+	}
+	if (ctx == NULL) {
+		perror(demux ? demux : "stdin");
+		exit(1);
+	}
+	if (fstat(dvb_demux_fd(ctx), &stat_buf) == 0 && S_ISCHR(stat_buf.st_mode))
+		dvb_demux_set_timeout(ctx, timeout);
+	if (raw_ts) {
+		/* Filter the SI PIDs ourselves */
+		if (service_scan) {
+			pids[npids++] = 0x0010;
+			pids[npids++] = 0x0011;
 		}
-		
-		if(pid == 0x0012)
-		{
-			signal(SIGALRM, finish_up);
-			alarm(timeout);
+		if (!halt_after_service_scan)
+			pids[npids++] = 0x0012;
+		if (dvb_demux_set_ts(ctx, pids, npids)) {
+			perror("dvb_demux_set_ts");
+			exit(1);
 		}
-	} else {
-		// disable alarm timeout for normal files
-		timeout = 0;
 	}
-
-	return fd_epg;
+	inputs[ninputs++] = ctx;
+	if (dvb_reactor_add(reactor, ctx, halt_after_service_scan ? scan_until : 0, readTable, callbacks)) {
+		perror("dvb_reactor_add");
+		exit(1);
+	}
 } /*}}}*/
 
 /* Read [cst]zap channels.conf file and print as XMLTV channel info. {{{ */
 static void readZapInfo() {
 	FILE *fd_zap;
 	char buf[256];
+	if (xmltv_opts.out == NULL)
+		return;
 	if ((fd_zap = fopen(CHANNELS_CONF, "r")) == NULL) {
 		fprintf(stderr, "No [cst]zap channels.conf to produce channel info\n");
 		return;
@@ -394,9 +500,10 @@ static void readZapInfo() {
 		if (id && *id) {
 			int chanid = atoi(id);
             if (chanid) { 
-                printf("<channel id=\"%s\">\n", get_channelident(chanid));
-                printf("\t<display-name>%s</display-name>\n", xmlify(buf));
-                printf("</channel>\n");
+                sink_printf(xmltv_opts.out, "<channel id=\"%s\">\n", get_channelident(chanid));
+                sink_puts(xmltv_opts.out, "\t<display-name>");
+                sink_xmlify(xmltv_opts.out, buf, strlen(buf));
+                sink_puts(xmltv_opts.out, "</display-name>\n</channel>\n");
             }
 		}
 	}
@@ -406,9 +513,8 @@ static void readZapInfo() {
 
 /* Main function. {{{ */
 int main(int argc, char **argv) {
-	int fd;
-	time_t start_time;
-	tva_options_t tva_opts;
+	int nstdout;
+	size_t i;
 	dvb_callbacks_t callbacks;
 
 	memset(&callbacks, 0, sizeof(callbacks));
@@ -420,6 +526,22 @@ int main(int argc, char **argv) {
 		ProgName++;
 	/* Process command line arguments */
 	do_options(argc, argv);
+	/* XMLTV is written to stdout unless an Atom feed has been asked for */
+	if (!xmltv_path && !generate_atom)
+		xmltv_path = "-";
+	nstdout = (xmltv_path && !strcmp(xmltv_path, "-")) +
+		(atom_path && !strcmp(atom_path, "-")) +
+		(tva_path && !strcmp(tva_path, "-"));
+	if (nstdout > 1) {
+		fprintf(stderr, "%s: Only one output can be written to stdout\n", ProgName);
+		exit(1);
+	}
+	if (xmltv_path)
+		xmltv_opts.out = openOutput(xmltv_path, &xmltv_out, &xmltv_fd);
+	if (atom_path)
+		atom_opts.out = openOutput(atom_path, &atom_out, &atom_fd);
+	if (tva_path)
+		tva_prog_opts.out = openOutput(tva_path, &tva_out, &tva_fd);
 	/* Load lookup tables. */
 	if (use_chanidents && load_lookup(&channelid_table, CHANIDENTS))
 		fprintf(stderr, "Error loading %s, continuing.\n", CHANIDENTS);
@@ -427,57 +549,71 @@ int main(int argc, char **argv) {
 		fprintf(stderr, "\n");
 
 	readZapInfo();
+	if (!service_scan)
+		halt_after_service_scan = 0;
 	if(service_scan)
 	{
-		start_time = time(NULL);
-		if ((fd = openInput(0x0010)) < 0) {
-			fprintf(stderr, "Unable to open demultiplex interface to read SDT\n");
+		/* Write TV-Anytime service information once the scan is over */
+		if ((svc_fd = open("ServiceInformation.xml", O_CREAT | O_TRUNC | O_WRONLY, 0666)) < 0 ||
+			sink_init(&svc_out, svc_fd, 0)) {
+			perror("ServiceInformation.xml");
 			exit(1);
 		}
-		signal(SIGALRM, dummy_alarm);		
-		alarm(service_scan);
-		/* Write TV-Anytime */
-		tva_opts.out = fopen("ServiceInformation.xml", "w");
-		tva_preamble_service(&tva_opts);
-		callbacks.service = tva_write_service;
-		callbacks.service_data = &tva_opts;
-		readEventTables(fd, parse_dvb_si, start_time + service_scan, &callbacks);
-		tva_postamble_service(&tva_opts);
-		fclose(tva_opts.out);
-		if(fd)
+		svc_opts.out = &svc_out;
+		tva_preamble_service(&svc_opts);
+		scan_until = time(NULL) + service_scan;
+		scanning = true;
+	}
+	if(!halt_after_service_scan)
+	{
+		/* Every output is written from the same pass over the EIT */
+		if(xmltv_opts.out)
 		{
-			close(fd);
+			xmltv_preamble(&xmltv_opts);
+			dvb_callbacks_add_writer(&callbacks, &xmltv_writer);
 		}
-		if(halt_after_service_scan)
+		if(atom_path || atom_opts.dir)
 		{
-			return 0;
-		}	
-	}
-	if(generate_atom == 1)
-	{
-		printf("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
-		printf("<feed>\n");
-		printf("\t<title>Event Information Table</title>\n");		
-	}
-	else if(!generate_atom)
-	{
-		printf("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
-		printf("<!DOCTYPE tv SYSTEM \"xmltv.dtd\">\n");
-		printf("<tv generator-info-name=\"dvb-epg-gen\">\n");
+			atom_preamble(&atom_opts);
+			dvb_callbacks_add_writer(&callbacks, &atom_writer);
+		}
+		if(tva_prog_opts.out)
+		{
+			if(tva_preamble_programme(&tva_prog_opts))
+			{
+				perror(tva_path);
+				exit(1);
+			}
+			dvb_callbacks_add_writer(&callbacks, &tva_prog_writer);
+		}
+		if ((schedule = dvb_schedule_new()) == NULL) {
+			perror("dvb_schedule_new");
+			exit(1);
+		}
+		callbacks.service = expectSchedule;
+		callbacks.service_data = schedule;
 	}
 
-	if ((fd = openInput(0x0012)) < 0) {
-		fprintf(stderr, "Unable to get event data from multiplex.\n");
+	if ((reactor = dvb_reactor_new()) == NULL) {
+		perror("dvb_reactor_new");
 		exit(1);
 	}
-/*	readEventTables(fd, parseEIT, 0, &callbacks); */
-	if(fd)
+	openInput(&callbacks);
+	if (dvb_reactor_run(reactor))
+		perror("dvb_reactor_run");
+	endServiceScan();
+	dvb_reactor_delete(reactor);
+	for (i = 0; i < ninputs; i++)
+		dvb_demux_close(inputs[i]);
+	if(halt_after_service_scan)
 	{
-		close(fd);
+		/* Nothing but the channels has been written to the outputs */
+		closeOutputs();
+		return 0;
 	}
+	dvb_schedule_delete(schedule);
 	finish_up();
 
 	return 0;
 } /*}}}*/
 // vim: foldmethod=marker ts=4 sw=4
-
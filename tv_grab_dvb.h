@@ -6,6 +6,7 @@
 #include <stdbool.h>
 
 #include "dvb/dvb.h"
+#include "xmltv.h"
 
 /* lookup.c */
 union lookup_key {
@@ -29,21 +30,13 @@ extern const struct lookup_table crid_type_table[];
 /* langidents.c */
 extern const struct lookup_table languageid_table[];
 
-/* crc32.c */
-extern uint32_t _dvb_crc32(const uint8_t *data, size_t len);
-
 /* dvb_text.c */
+extern size_t dvb_text_decode(const char *s, size_t len, char *out, size_t size);
+extern size_t xmlify_r(const char *s, size_t len, char *out, size_t size);
 extern char *xmlify(const char *s);
 extern char *iso6937_encoding;
 
 /* tv_grab_dvb.c */
-typedef struct chninfo {
-	struct chninfo *next;
-	int sid;
-	int eid;
-	int ver;
-} chninfo_t;
-
 extern int timeout;
 extern int programme_count;
 extern int update_count;
@@ -53,14 +46,10 @@ extern bool ignore_bad_dates;
 extern bool ignore_updates;
 
 extern struct lookup_table *channelid_table;
-extern struct chninfo *channels;
 
 char *get_channelident(int chanid);
 
 /* dvb-eit.c */
 extern int parseEIT(void *data, size_t len, dvb_callbacks_t *callbacks);
 
-/* dvb-si.c */
-extern int parse_dvb_si(void *data, size_t len, dvb_callbacks_t *callbacks);
-
 #endif
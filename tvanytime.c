@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <sys/time.h>
 #include <time.h>
@@ -9,32 +10,89 @@
 #include "dvb/dvb.h"
 
 typedef struct tva_service_struct tva_service_t;
+typedef struct tva_location_struct tva_location_t;
 
 struct tva_service_struct
 {
 	char serviceid[64];
-	FILE *cr; /* Content referencing table */
-	FILE *pi; /* Programme information table */
-	FILE *pl; /* Programme location table */
 };
 
+/* The Schedule for a service */
+struct tva_schedule_struct
+{
+	tva_schedule_t *next;
+	char serviceid[64];
+	size_t nevents;
+	size_t alloc;
+	tva_location_t **events;
+};
+
+/* A ScheduleEvent, which is replaced by any later version of its event */
+struct tva_location_struct
+{
+	/* The serviceId and the event's identifier */
+	char *key;
+	char *crid;
+	char *uri;
+	time_t start;
+	long duration;
+};
+
+/* Derive the serviceId of a service: its name, with anything other than
+ * letters and digits removed, or failing that "dvb" followed by the last part
+ * of its URI. Returns 1 if the name was used.
+ */
+static int
+tva_service_id(service_t *service, char *buf, size_t size)
+{
+	const char *s, *p;
+	size_t c;
+
+	buf[0] = 0;
+	if((s = service_name(service)))
+	{
+		c = 0;
+		for(p = s; c < size - 1 && *p; p++)
+		{
+			if(isalnum((unsigned char) *p))
+			{
+				buf[c] = *p;
+				c++;
+			}
+		}
+		buf[c] = 0;
+	}
+	if(buf[0])
+	{
+		return 1;
+	}
+	s = service_uri(service);
+	p = strrchr(s, '.');
+	if(p)
+	{
+		p++;
+		snprintf(buf, size, "dvb%s", p);
+	}
+	return 0;
+}
+
 void
 tva_preamble_service(tva_options_t *options)
 {
-	fprintf(options->out,
-			"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
-			"<TVAMain xmlns=\"urn:tva:metadata:2005\" xmlns:mpeg7=\"urn:tva:mpeg7:2005\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">\n"
-			"\t<ProgramDescription>\n"
-			"\t\t<ServiceInformationTable>\n");
+	sink_puts(options->out,
+			  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			  "<TVAMain xmlns=\"urn:tva:metadata:2005\" xmlns:mpeg7=\"urn:tva:mpeg7:2005\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">\n"
+			  "\t<ProgramDescription>\n"
+			  "\t\t<ServiceInformationTable>\n");
 }
 
 void
 tva_postamble_service(tva_options_t *options)
 {
-	fprintf(options->out,
-			"\t\t</ServiceInformationTable>\n"
-			"\t</ProgramDescription>\n"
-			"</TVAMain>\n");
+	sink_puts(options->out,
+			  "\t\t</ServiceInformationTable>\n"
+			  "\t</ProgramDescription>\n"
+			  "</TVAMain>\n");
 }
 
 int
@@ -42,9 +100,8 @@ tva_write_service(service_t *service, void *data)
 {
 	service_type_t st;
 	tva_service_t *svc;
-	const char *s, *p;
+	const char *s;
 	tva_options_t *options = data;
-	int c;
 	
 	if(NULL == (svc = calloc(1, sizeof(tva_service_t))))
 	{
@@ -68,52 +125,29 @@ tva_write_service(service_t *service, void *data)
 	default:
 		return 0;
 	}
-	if((s = service_name(service)))
-	{
-		c = 0;
-		for(p = s; c < sizeof(svc->serviceid) - 1 && *p; p++)
-		{
-			if(isalnum(*p))
-			{
-				svc->serviceid[c] = *p;
-				c++;
-			}
-		}
-		svc->serviceid[c] = 0;
-	}
-	if(!svc->serviceid[0])
-	{
-		s = service_uri(service);
-		p = strrchr(s, '.');
-		if(p)
-		{
-			p++;
-			snprintf(svc->serviceid, sizeof(svc->serviceid), "dvb%s", p);
-		}
-		s = NULL;
-	}	
-	fprintf(options->out, "\t\t\t<ServiceInformation serviceId=\"%s\">\n", svc->serviceid);
+	s = (tva_service_id(service, svc->serviceid, sizeof(svc->serviceid)) ? service_name(service) : NULL);
+	sink_printf(options->out, "\t\t\t<ServiceInformation serviceId=\"%s\">\n", svc->serviceid);
 	if(s)
 	{
-		fprintf(options->out, "\t\t\t\t<Name>%s</Name>\n", s);
+		sink_printf(options->out, "\t\t\t\t<Name>%s</Name>\n", s);
 	}
 	if((s = service_provider(service)))
 	{
-		fprintf(options->out, "\t\t\t\t<Owner>%s</Owner>\n", s);
+		sink_printf(options->out, "\t\t\t\t<Owner>%s</Owner>\n", s);
 	}
 	if((s = service_uri(service)))
 	{
-		fprintf(options->out, "\t\t\t\t<ServiceURL>%s</ServiceURL>\n", s);
+		sink_printf(options->out, "\t\t\t\t<ServiceURL>%s</ServiceURL>\n", s);
 	}
 	switch(st)
 	{
 	case ST_TV:
-		fprintf(options->out, "\t\t\t\t<ServiceGenre href=\"urn:tva:metadata:cs:MediaTypeCS:2005:7.1.3\">\n"
+		sink_puts(options->out, "\t\t\t\t<ServiceGenre href=\"urn:tva:metadata:cs:MediaTypeCS:2005:7.1.3\">\n"
 				"\t\t\t\t\t<Name>Audio and video</Name>\n"
 				"\t\t\t\t</ServiceGenre>\n");
 		break;
 	case ST_RADIO:
-		fprintf(options->out, "\t\t\t\t<ServiceGenre href=\"urn:tva:metadata:cs:MediaTypeCS:2005:7.1.3\">\n"
+		sink_puts(options->out, "\t\t\t\t<ServiceGenre href=\"urn:tva:metadata:cs:MediaTypeCS:2005:7.1.3\">\n"
 				"\t\t\t\t\t<Name>Audio only</Name>\n"
 				"\t\t\t\t</ServiceGenre>\n");
 		break;
@@ -121,15 +155,397 @@ tva_write_service(service_t *service, void *data)
 		/*NOTREACHED*/
 		break;
 	}
-	fprintf(options->out, "\t\t\t</ServiceInformation>\n");
+	sink_puts(options->out, "\t\t\t</ServiceInformation>\n");
+	return 0;
+}
+
+/* The serviceId of the Schedule an event belongs in: that of its service, or
+ * if it has none, the channel named by the first part of its identifier
+ */
+static void
+tva_event_service_id(event_t *event, char *buf, size_t size)
+{
+	const char *s;
+	size_t c;
+
+	if(event_service(event))
+	{
+		tva_service_id(event_service(event), buf, size);
+		return;
+	}
+	c = 0;
+	for(s = event_identifier(event); c < size - 1 && *s && *s != '/'; s++)
+	{
+		if(isalnum((unsigned char) *s))
+		{
+			buf[c] = *s;
+			c++;
+		}
+	}
+	buf[c] = 0;
+}
+
+/* Qualify a CRID which lacks an authority with that of the event's service */
+static void
+tva_qual_crid(event_t *event, const char *crid, char *buf, size_t size)
+{
+	const char *authority;
+
+	if(crid[0] != '/')
+	{
+		snprintf(buf, size, "crid://%s", crid);
+		return;
+	}
+	if(!event_service(event) || !(authority = service_authority(event_service(event))))
+	{
+		authority = "undefined";
+	}
+	snprintf(buf, size, "crid://%s%s", authority, crid);
+}
+
+static size_t
+tva_crid_hash(const void *crid)
+{
+	return dvb_hash_str((const char *) crid, strlen((const char *) crid));
+}
+
+static int
+tva_crid_match(const void *entry, const void *crid)
+{
+	return !strcmp((const char *) entry, (const char *) crid);
+}
+
+/* Record that the programme or group with the given CRID has been written,
+ * returning 1 if it had been already. The set holds its own copies of the
+ * CRIDs, which are freed by tva_postamble_programme().
+ */
+static int
+tva_crid_seen(tva_options_t *options, const char *crid)
+{
+	char *p;
+
+	if(dvb_hash_find(&(options->crids), tva_crid_hash(crid), tva_crid_match, crid))
+	{
+		return 1;
+	}
+	if(NULL == (p = strdup(crid)))
+	{
+		return 0;
+	}
+	if(dvb_hash_insert(&(options->crids), p, tva_crid_hash))
+	{
+		free(p);
+	}
+	return 0;
+}
+
+static void
+tva_write_langstrs(sink_t *out, const char *element, const char *attrs, const event_langstr_t **ll, size_t count)
+{
+	size_t i;
+
+	for(i = 0; i < count; i++)
+	{
+		if(ll[i])
+		{
+			sink_printf(out, "\t\t\t\t\t<%s %sxml:lang=\"%s\">", element, attrs, ll[i]->lang);
+			sink_xmlify(out, ll[i]->str, strlen(ll[i]->str));
+			sink_printf(out, "</%s>\n", element);
+		}
+	}
+}
+
+static size_t
+tva_location_hash(const void *entry)
+{
+	const char *key = ((const tva_location_t *) entry)->key;
+
+	return dvb_hash_str(key, strlen(key));
+}
+
+static int
+tva_location_match(const void *entry, const void *key)
+{
+	return !strcmp(((const tva_location_t *) entry)->key, (const char *) key);
+}
+
+/* Locate (or create) the Schedule for a service; there are few enough
+ * services that they're simply searched in turn
+ */
+static tva_schedule_t *
+tva_schedule(tva_options_t *options, const char *serviceid)
+{
+	tva_schedule_t *p;
+
+	for(p = options->schedules; p; p = p->next)
+	{
+		if(!strcmp(p->serviceid, serviceid))
+		{
+			return p;
+		}
+	}
+	if(NULL == (p = (tva_schedule_t *) calloc(1, sizeof(tva_schedule_t))))
+	{
+		return NULL;
+	}
+	strncpy(p->serviceid, serviceid, sizeof(p->serviceid) - 1);
+	*(options->last) = p;
+	options->last = &(p->next);
+	return p;
+}
+
+/* Add a ScheduleEvent to the end of a Schedule */
+static tva_location_t *
+tva_schedule_add(tva_options_t *options, tva_schedule_t *schedule, const char *key)
+{
+	tva_location_t *loc, **p;
+
+	if(schedule->nevents == schedule->alloc)
+	{
+		if(NULL == (p = (tva_location_t **) realloc(schedule->events, sizeof(tva_location_t *) * (schedule->alloc + 64))))
+		{
+			return NULL;
+		}
+		schedule->events = p;
+		schedule->alloc += 64;
+	}
+	if(NULL == (loc = (tva_location_t *) calloc(1, sizeof(tva_location_t))) ||
+	   NULL == (loc->key = strdup(key)) ||
+	   dvb_hash_insert(&(options->locations), loc, tva_location_hash))
+	{
+		if(loc)
+		{
+			free(loc->key);
+			free(loc);
+		}
+		return NULL;
+	}
+	schedule->events[schedule->nevents] = loc;
+	schedule->nevents++;
+	return loc;
+}
+
+static int
+tva_location_compare(const void *a, const void *b)
+{
+	const tva_location_t *la = *(const tva_location_t **) a, *lb = *(const tva_location_t **) b;
+
+	if(la->start != lb->start)
+	{
+		return (la->start < lb->start ? -1 : 1);
+	}
+	return strcmp(la->key, lb->key);
+}
+
+/* Write a Schedule, in order of start time */
+static void
+tva_write_schedule(sink_t *out, tva_schedule_t *schedule)
+{
+	tva_location_t *loc;
+	char startbuf[32];
+	size_t i;
+	long d;
+
+	qsort(schedule->events, schedule->nevents, sizeof(tva_location_t *), tva_location_compare);
+	sink_printf(out, "\t\t\t<Schedule serviceIDRef=\"%s\">\n", schedule->serviceid);
+	for(i = 0; i < schedule->nevents; i++)
+	{
+		loc = schedule->events[i];
+		if(!loc->crid)
+		{
+			continue;
+		}
+		strftime(startbuf, sizeof(startbuf), "%Y-%m-%dT%H:%M:%SZ", gmtime(&(loc->start)));
+		d = loc->duration;
+		sink_puts(out, "\t\t\t\t<ScheduleEvent>\n"
+				  "\t\t\t\t\t<Program crid=\"");
+		sink_xmlify(out, loc->crid, strlen(loc->crid));
+		sink_puts(out, "\"/>\n");
+		if(loc->uri)
+		{
+			sink_puts(out, "\t\t\t\t\t<ProgramURL>");
+			sink_xmlify(out, loc->uri, strlen(loc->uri));
+			sink_puts(out, "</ProgramURL>\n");
+		}
+		sink_printf(out, "\t\t\t\t\t<PublishedStartTime>%s</PublishedStartTime>\n"
+					"\t\t\t\t\t<PublishedDuration>PT%02ldH%02ldM%02ldS</PublishedDuration>\n"
+					"\t\t\t\t</ScheduleEvent>\n",
+					startbuf, d / 3600, (d / 60) % 60, d % 60);
+	}
+	sink_puts(out, "\t\t\t</Schedule>\n");
+}
+
+static void
+tva_free_schedule(tva_schedule_t *schedule)
+{
+	size_t i;
+
+	for(i = 0; i < schedule->nevents; i++)
+	{
+		free(schedule->events[i]->key);
+		free(schedule->events[i]->crid);
+		free(schedule->events[i]->uri);
+		free(schedule->events[i]);
+	}
+	free(schedule->events);
+	free(schedule);
+}
+
+/* Prepare to write events: until tva_postamble_programme(), they're
+ * accumulated in memory, one buffer per table.
+ */
+int
+tva_preamble_programme(tva_options_t *options)
+{
+	options->schedules = NULL;
+	options->last = &(options->schedules);
+	memset(&(options->locations), 0, sizeof(dvb_hash_t));
+	memset(&(options->crids), 0, sizeof(dvb_hash_t));
+	if(sink_init(&(options->pi), -1, 64 * 1024) ||
+	   sink_init(&(options->gi), -1, 4 * 1024))
+	{
+		return -1;
+	}
 	return 0;
 }
 
+/* Write the tables accumulated so far to the output as a single document */
+void
+tva_postamble_programme(tva_options_t *options)
+{
+	sink_t *out = options->out;
+	tva_schedule_t *p;
+	size_t i;
+
+	sink_puts(out,
+			  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			  "<TVAMain xmlns=\"urn:tva:metadata:2005\" xmlns:mpeg7=\"urn:tva:mpeg7:2005\" xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\">\n"
+			  "\t<ProgramDescription>\n"
+			  "\t\t<ProgramInformationTable>\n");
+	sink_write(out, options->pi.buf, options->pi.len);
+	sink_puts(out, "\t\t</ProgramInformationTable>\n");
+	if(options->gi.len)
+	{
+		sink_puts(out, "\t\t<GroupInformationTable>\n");
+		sink_write(out, options->gi.buf, options->gi.len);
+		sink_puts(out, "\t\t</GroupInformationTable>\n");
+	}
+	sink_puts(out, "\t\t<ProgramLocationTable>\n");
+	while((p = options->schedules))
+	{
+		options->schedules = p->next;
+		tva_write_schedule(out, p);
+		tva_free_schedule(p);
+	}
+	options->last = &(options->schedules);
+	sink_puts(out,
+			  "\t\t</ProgramLocationTable>\n"
+			  "\t</ProgramDescription>\n"
+			  "</TVAMain>\n");
+	sink_close(&(options->pi));
+	sink_close(&(options->gi));
+	dvb_hash_clear(&(options->locations));
+	for(i = 0; i < options->crids.size; i++)
+	{
+		free(options->crids.slots[i]);
+	}
+	dvb_hash_clear(&(options->crids));
+}
+
+/* Each event becomes a ScheduleEvent in the Schedule for its service, which
+ * refers to a ProgramInformation by the event's programme CRID (or, if it has
+ * none, its transport URI); the ProgramInformation, and the GroupInformation
+ * of any series it's part of, are only written the first time they're seen,
+ * so that a programme shown more than once is only described once. A later
+ * version of an event replaces its ScheduleEvent, rather than adding another.
+ */
 int
 tva_write_event(event_t *event, void *data)
 {
-	(void) event;
-	(void) data;
-	
+	tva_options_t *options = data;
+	const event_langstr_t **ll;
+	tva_schedule_t *schedule;
+	tva_location_t *loc;
+	char crid[256], scrid[256], serviceid[64], key[512];
+	const char *s;
+	size_t count;
+
+	if(event_pcrid(event))
+	{
+		event_qual_pcrid(event, crid, sizeof(crid));
+	}
+	else if((s = event_transport_uri(event)))
+	{
+		snprintf(crid, sizeof(crid), "%s", s);
+	}
+	else
+	{
+		return 0;
+	}
+	scrid[0] = 0;
+	if((s = event_scrid(event)))
+	{
+		tva_qual_crid(event, s, scrid, sizeof(scrid));
+	}
+	if(!tva_crid_seen(options, crid))
+	{
+		sink_puts(&(options->pi), "\t\t\t<ProgramInformation programId=\"");
+		sink_xmlify(&(options->pi), crid, strlen(crid));
+		sink_puts(&(options->pi), "\">\n"
+				  "\t\t\t\t<BasicDescription>\n");
+		if((ll = event_titles(event, &count)))
+		{
+			tva_write_langstrs(&(options->pi), "Title", "type=\"main\" ", ll, count);
+		}
+		if((ll = event_subtitles(event, &count)))
+		{
+			tva_write_langstrs(&(options->pi), "Synopsis", "length=\"short\" ", ll, count);
+		}
+		if((ll = event_descriptions(event, &count)))
+		{
+			tva_write_langstrs(&(options->pi), "Synopsis", "length=\"long\" ", ll, count);
+		}
+		sink_puts(&(options->pi), "\t\t\t\t</BasicDescription>\n");
+		if(scrid[0])
+		{
+			sink_puts(&(options->pi), "\t\t\t\t<MemberOf xsi:type=\"MemberOfType\" crid=\"");
+			sink_xmlify(&(options->pi), scrid, strlen(scrid));
+			sink_puts(&(options->pi), "\"/>\n");
+		}
+		sink_puts(&(options->pi), "\t\t\t</ProgramInformation>\n");
+	}
+	if(scrid[0] && !tva_crid_seen(options, scrid))
+	{
+		sink_puts(&(options->gi), "\t\t\t<GroupInformation groupId=\"");
+		sink_xmlify(&(options->gi), scrid, strlen(scrid));
+		sink_puts(&(options->gi), "\">\n"
+				  "\t\t\t\t<GroupType xsi:type=\"ProgramGroupTypeType\" value=\"series\"/>\n"
+				  "\t\t\t</GroupInformation>\n");
+	}
+	/* A later version of an event replaces its ScheduleEvent */
+	tva_event_service_id(event, serviceid, sizeof(serviceid));
+	if(!(s = event_identifier(event)) && !(s = event_transport_uri(event)))
+	{
+		s = crid;
+	}
+	snprintf(key, sizeof(key), "%s %s", serviceid, s);
+	if(NULL == (loc = (tva_location_t *) dvb_hash_find(&(options->locations), dvb_hash_str(key, strlen(key)), tva_location_match, key)))
+	{
+		if(NULL == (schedule = tva_schedule(options, serviceid)) ||
+		   NULL == (loc = tva_schedule_add(options, schedule, key)))
+		{
+			return -1;
+		}
+	}
+	free(loc->crid);
+	free(loc->uri);
+	loc->crid = strdup(crid);
+	loc->uri = ((s = event_transport_uri(event)) ? strdup(s) : NULL);
+	loc->start = event_start(event);
+	loc->duration = (long) event_duration(event);
+	if(!loc->crid)
+	{
+		return -1;
+	}
 	return 0;
 }
@@ -4,17 +4,37 @@
 # include <stdio.h>
 
 # include "dvb/dvb.h"
+# include "sink.h"
 
 typedef struct tva_options_struct tva_options_t;
+typedef struct tva_schedule_struct tva_schedule_t;
 
 struct tva_options_struct
 {
-	FILE *out;
+	sink_t *out;
+	/* Events are written into these tables as they arrive, and the tables
+	 * are written to out as a single document by tva_postamble_programme()
+	 */
+	sink_t pi; /* ProgramInformationTable */
+	sink_t gi; /* GroupInformationTable */
+	/* The ProgramLocationTable is only written out at the end, as one
+	 * Schedule per service (in the order the services were first seen)
+	 * holding the latest version of each of its events
+	 */
+	tva_schedule_t *schedules;
+	tva_schedule_t **last;
+	/* The ScheduleEvents of all of the Schedules, by service and event */
+	dvb_hash_t locations;
+	/* The CRIDs of the programmes and groups written so far */
+	dvb_hash_t crids;
 };
 
 void tva_preamble_service(tva_options_t *options);
 void tva_postamble_service(tva_options_t *options);
 int tva_write_service(service_t *service, void *data);
+
+int tva_preamble_programme(tva_options_t *options);
+void tva_postamble_programme(tva_options_t *options);
 int tva_write_event(event_t *event, void *data);
 
 #endif /*!TVANYTIME_H_ */
@@ -9,64 +9,151 @@
 #include "tv_grab_dvb.h"
 
 void
+xmltv_preamble(xmltv_options_t *options)
+{
+	sink_puts(options->out,
+			  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			  "<!DOCTYPE tv SYSTEM \"xmltv.dtd\">\n"
+			  "<tv generator-info-name=\"dvb-epg-gen\">\n");
+}
+
+void
+xmltv_postamble(xmltv_options_t *options)
+{
+	sink_puts(options->out, "</tv>\n");
+}
+
+/* Write an element with the text of each of a list of langstrs as its
+ * content
+ */
+static void
+xmltv_write_langstrs(sink_t *out, const char *element, const event_langstr_t **ll, size_t count)
+{
+	size_t i;
+
+	for(i = 0; ll && i < count; i++)
+	{
+		if(ll[i])
+		{
+			sink_printf(out, "\t<%s lang=\"%s\">", element, ll[i]->lang);
+			sink_xmlify(out, ll[i]->str, strlen(ll[i]->str));
+			sink_printf(out, "</%s>\n", element);
+		}
+	}
+}
+
+/* Write an event as a programme element; the tags must be output in this
+ * order:
+ *
+ * 'title', 'sub-title', 'desc', 'credits', 'date', 'category', 'language',
+ * 'orig-language', 'length', 'icon', 'url', 'country', 'episode-num',
+ * 'video', 'audio', 'previously-shown', 'premiere', 'last-chance',
+ * 'new', 'subtitles', 'rating', 'star-rating'
+ */
+int
 xmltv_write_event(event_t *event, void *data)
 {
-	char chanbuf[64], startbuf[64], stopbuf[64];
+	xmltv_options_t *options = data;
+	sink_t *out = options->out;
+	char startbuf[64], stopbuf[64], typebuf[32];
 	time_t t;
-	const char *s;
+	const char *s, **langs;
+	const uint8_t *codes;
+	const event_crid_t *crids;
+	const event_descriptor_t *unknown;
+	const event_langstr_t **ll;
 	event_aspect_t aspect;
 	event_audio_t audio;
 	size_t count, i;
-	const event_langstr_t **ll;
-
-	chanbuf[0] = 0;
 
 	t = event_start(event);
 	strftime(startbuf, sizeof(startbuf), "%Y%m%d%H%M%S %z", localtime(&t));
-	
 	t += event_duration(event);
 	strftime(stopbuf, sizeof(stopbuf), "%Y%m%d%H%M%S %z", localtime(&t));
-	
-	printf("\t<programme channel=\"%s\" start=\"%s\" stop=\"%s\">\n",
-		   chanbuf, startbuf, stopbuf);
-    /* Tags should be output in this order:
-	 *
-	 * 'title', 'sub-title', 'desc', 'credits', 'date', 'category', 'language',
-	 * 'orig-language', 'length', 'icon', 'url', 'country', 'episode-num',
-	 * 'video', 'audio', 'previously-shown', 'premiere', 'last-chance',
-	 * 'new', 'subtitles', 'rating', 'star-rating'
-	 */
-	if((ll = event_titles(event, &count)))
+	s = event_channel(event);
+	sink_printf(out, "<programme channel=\"%s\" start=\"%s\" stop=\"%s\">\n",
+				(s ? s : ""), startbuf, stopbuf);
+	ll = event_titles(event, &count);
+	xmltv_write_langstrs(out, "title", ll, count);
+	unknown = event_unknown(event, &count);
+	for(i = 0; i < count; i++)
 	{
-		for(i = 0; i < count; i++)
-		{
-			printf("\t\t<title lang=\"%s\">%s</title>\n", ll[i]->lang, xmlify(ll[i]->str));
-		}
+		sink_printf(out, "\t<!--Unknown_Please_Report ID=\"%x\" Len=\"%d\" -->\n", unknown[i].tag, unknown[i].length);
 	}
-	if((ll = event_subtitles(event, &count)))
+	ll = event_subtitles(event, &count);
+	xmltv_write_langstrs(out, "sub-title", ll, count);
+	ll = event_descriptions(event, &count);
+	xmltv_write_langstrs(out, "desc", ll, count);
+	codes = event_categories(event, &count);
+	for(i = 0; i < count; i++)
 	{
-		for(i = 0; i < count; i++)
+		if((s = lookup(description_table, codes[i])))
 		{
-			printf("\t\t<sub-title lang=\"%s\">%s</sub-title>\n", ll[i]->lang, xmlify(ll[i]->str));
+			if(s[0])
+			{
+				sink_printf(out, "\t<category>%s</category>\n", s);
+			}
+#ifdef CATEGORY_UNKNOWN
+			else
+			{
+				sink_printf(out, "\t<!--category>%s %02X</category-->\n", s + 1, codes[i]);
+			}
+		}
+		else
+		{
+			sink_printf(out, "\t<!--category>%02X</category-->\n", codes[i]);
+#endif
 		}
 	}
-	if((s = event_lang(event)))
+	langs = event_languages(event, &count);
+	for(i = 0; i < count; i++)
 	{
-		printf("\t\t<language>%s</language>\n", s);
+		/* Only one language is allowed */
+		sink_printf(out, (i ? "\t<!--language>%s</language-->\n" : "\t<language>%s</language>\n"), langs[i]);
 	}
 	if(EA_INVALID != (aspect = event_aspect(event)))
 	{
-		printf("\t\t<video>\n"
-			   "\t\t\t<aspect>%s</aspect>\n"
-			   "\t\t</video>\n",
-			   lookup(aspect_table, aspect));
-	}			   
+		sink_printf(out, "\t<video>\n"
+					"\t\t<aspect>%s</aspect>\n"
+					"\t</video>\n",
+					lookup(aspect_table, aspect));
+	}
+	crids = event_crids(event, &count);
+	for(i = 0; i < count; i++)
+	{
+		if(NULL == (s = lookup(crid_type_table, crids[i].type)))
+		{
+			sprintf(typebuf, "0x%2x", crids[i].type);
+			s = typebuf;
+		}
+		sink_printf(out, "\t<crid type='%s'>", s);
+		sink_xmlify(out, crids[i].crid, strlen(crids[i].crid));
+		sink_puts(out, "</crid>\n");
+	}
 	if(EA_INVALID != (audio = event_audio(event)))
 	{
-		printf("\t\t<audio>\n"
-			   "\t\t\t<stereo>%s</stereo>\n"
-			   "\t\t</audio>\n",
-			   lookup(audio_table, audio));
-	}			   	
-	printf("\t</programme>\n");
+		sink_printf(out, "\t<audio>\n"
+					"\t\t<stereo>%s</stereo>\n"
+					"\t</audio>\n",
+					lookup(audio_table, audio));
+	}
+	langs = event_subtitling(event, &count);
+	for(i = 0; i < count; i++)
+	{
+		sink_printf(out, "\t<subtitles type=\"teletext\">\n"
+					"\t\t<language>%s</language>\n"
+					"\t</subtitles>\n",
+					langs[i]);
+	}
+	codes = event_ratings(event, &count);
+	for(i = 0; i < count; i++)
+	{
+		/* The minimum age is the rating plus three */
+		sink_printf(out, "\t<rating system=\"dvb\">\n"
+					"\t\t<value>%d</value>\n"
+					"\t</rating>\n",
+					codes[i] + 3);
+	}
+	sink_puts(out, "</programme>\n");
+	return 0;
 }
@@ -2,7 +2,17 @@
 # define XMLTV_H_                       1
 
 # include "dvb/dvb.h"
+# include "sink.h"
 
-void xmltv_write_event(event_t *event, void *data);
+typedef struct xmltv_options_struct xmltv_options_t;
+
+struct xmltv_options_struct
+{
+	sink_t *out;
+};
+
+void xmltv_preamble(xmltv_options_t *options);
+void xmltv_postamble(xmltv_options_t *options);
+int xmltv_write_event(event_t *event, void *data);
 
 #endif /*!XMLTV_H_ */